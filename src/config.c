@@ -25,44 +25,72 @@ struct settingkey_t settings[NUM_CONFIGVARS] =
     {"KEY_WIDESCREEN", 0},
     {"KEY_SYNCHRONOUS", 1},
     {"KEY_INSTANT_INPUT", 0},
-    {"KEY_REMOVE_BLACK_BARS", 0}
+    {"KEY_REMOVE_BLACK_BARS", 0},
+    {"KEY_SHADER_PASS_FUSION", 0},
+    {"KEY_PNG_COMPRESSION", 6},
+    {"KEY_PNG_FILTER", 5},
+    {"KEY_SCREENSHOT_FORMAT", 0},
+    {"KEY_RDP_DUMP_FRAMES", 0}
 };
 
+struct settingstring_t string_settings[NUM_CONFIGSTRINGS] =
+{
+    {"KEY_SHADER_PRESET", ""}
+};
+
+static void config_read()
+{
+	for (int i = 0; i < NUM_CONFIGVARS; i++)
+    {
+        int value = -1;
+        bool ret = ini_get_value(settings[i].name, &value);
+        if (ret)
+        {
+            settings[i].val = value;
+        }
+    }
+
+    for (int i = 0; i < NUM_CONFIGSTRINGS; i++)
+    {
+        ini_get_string(string_settings[i].name, string_settings[i].val, sizeof(string_settings[i].val));
+    }
+}
+
 void config_init()
 {
 	// initialize ini parser
 	ini_init();
 
-	FILE* file = fopen(ini_file, "r");
-    if (file == NULL)
+    if (!ini_load())
     { // file doesn't exist, create it
         config_save();
     }
     else
     { // file exists, read it
-        config_load();
-        fclose(file);
+        config_read();
     }
 }
 
 void config_save()
 {
+	// reread first so keys written by others since the last load survive
+	ini_load();
+
 	for (int i = 0; i < NUM_CONFIGVARS; i++) 
     {
         ini_set_value(settings[i].name, settings[i].val);
     }
-}
 
-void config_load()
-{
-	for (int i = 0; i < NUM_CONFIGVARS; i++)
+    for (int i = 0; i < NUM_CONFIGSTRINGS; i++)
     {
-        int value = -1;
-        bool ret = ini_get_value(settings[i].name, &value);
-        if (ret)
-        {
-            settings[i].val = value;
-        }
+        ini_set_string(string_settings[i].name, string_settings[i].val);
     }
+
+    ini_save();
 }
 
+void config_load()
+{
+	ini_load();
+	config_read();
+}
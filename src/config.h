@@ -23,7 +23,17 @@
 #define KEY_SYNCHRONOUS 19
 #define KEY_INSTANT_INPUT 20
 #define KEY_REMOVE_BLACK_BARS 21
-#define NUM_CONFIGVARS 22
+#define KEY_SHADER_PASS_FUSION 22
+#define KEY_PNG_COMPRESSION 23
+#define KEY_PNG_FILTER 24
+#define KEY_SCREENSHOT_FORMAT 25
+#define KEY_RDP_DUMP_FRAMES 26
+#define NUM_CONFIGVARS 27
+
+#define SKEY_SHADER_PRESET 0
+#define NUM_CONFIGSTRINGS 1
+
+#define CONFIG_STRING_MAX 260
 
 struct settingkey_t
 {
@@ -31,11 +41,18 @@ struct settingkey_t
 	int val;
 };
 
+struct settingstring_t
+{
+	char name[255];
+	char val[CONFIG_STRING_MAX];
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 	extern struct settingkey_t settings[NUM_CONFIGVARS];
+	extern struct settingstring_t string_settings[NUM_CONFIGSTRINGS];
 
 	extern void config_init(void);
 	extern void config_save(void);
@@ -29,20 +29,24 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "gfx_1.3.h"
 #include "parallel_imp.h"
 #include "ini.h"
 #include "config_gui.h"
 #include "config.h"
+#include "profile.h"
+#include "rdp_capture.h"
+#include "screenshot/screenshot.h"
 #include "queue_executor.h"
+#include "retroarch/shader_cache.h"
 
 #include "git.h"
 
 #include <optional>
 #include <string>
 
-static bool m_romopened = false;
 static bool warn_hle = false;
 GFX_INFO gfx;
 uint32_t rdram_size;
@@ -128,22 +132,54 @@ void plugin_close(void)
 {
 }
 
+// The internal name from the ROM header, trailing spaces removed.
+static void rom_name(char romname[21])
+{
+    for (int i = 0; i < 20; ++i)
+        romname[i] = gfx.HEADER[(32 + i) ^ 3];
+    romname[20] = 0;
+
+    while (romname[0] && romname[strlen(romname) - 1] == ' ')
+        romname[strlen(romname) - 1] = 0;
+}
+
 EXPORT void CALL CaptureScreen(char* directory)
 {
     std::string directory_str(directory);
     sExecutor.async([directory_str]() {
         char romname[21];
-        for (int i = 0; i < 20; ++i)
-            romname[i] = gfx.HEADER[(32 + i) ^ 3];
-        romname[20] = 0;
-
-        while (romname[strlen(romname) - 1] == ' ')
-            romname[strlen(romname) - 1] = 0;
-
+        rom_name(romname);
         retro_video_capture_screen(directory_str.c_str(), romname);
     });
 }
 
+// KEY_RDP_DUMP_FRAMES > 0 records that many frames of RDP commands, RDRAM and VI
+// registers next to the config, for replaying with pj64-parallel-rdp-replay.
+// The setting is one-shot, it is saved back as 0 once the recording starts.
+static void rdp_dump_start()
+{
+    int frames = settings[KEY_RDP_DUMP_FRAMES].val;
+    if (frames <= 0 || RDP::capture_active())
+        return;
+
+    char romname[21], stamp[32], path[INI_PATH_MAX];
+    time_t now = time(NULL);
+    rom_name(romname);
+    ScreenshotSanitizeName(romname);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(path, sizeof(path), "%s\\ParaLLEl_%s_%s.rdp", ini_dir, romname, stamp);
+
+    if (!RDP::capture_begin(path, gfx.RDRAM, rdram_size, unsigned(frames)))
+    {
+        msg_debug("paraLLEl: could not create the RDP dump");
+        return;
+    }
+
+    msg_debug("paraLLEl: recording %d frames of RDP commands next to cfg.ini", frames);
+    settings[KEY_RDP_DUMP_FRAMES].val = 0;
+    config_save();
+}
+
 EXPORT void CALL GetDllInfo(PLUGIN_INFO* PluginInfo)
 {
     PluginInfo->Version = 0x0103;
@@ -159,6 +195,9 @@ EXPORT BOOL CALL InitiateGFX(GFX_INFO Gfx_Info)
     // initialize config
     config_init();
 
+    // compiled pipelines and shader metadata are cached next to the config
+    shader_cache_set_dir(ini_dir);
+
     gfx = Gfx_Info;
     hStatusBar = gfx.hStatusBar;
     plugin_init();
@@ -196,21 +235,22 @@ static bool m_fullscreen = false;
 static int m_width, m_height;
 static void xconfig_init()
 {
-    RDP::upscaling = settings[KEY_UPSCALING].val;
-    RDP::super_sampled_read_back = settings[KEY_SSREADBACKS].val;
-    RDP::super_sampled_dither = settings[KEY_SSDITHER].val;
+    // Per game profiles take precedence over the global settings.
+    RDP::upscaling = profile_value(KEY_UPSCALING);
+    RDP::super_sampled_read_back = profile_value(KEY_SSREADBACKS);
+    RDP::super_sampled_dither = profile_value(KEY_SSDITHER);
 
     RDP::overscan = settings[KEY_OVERSCANCROP].val;
-    RDP::native_texture_lod = settings[KEY_NATIVETEXTLOD].val;
-    RDP::native_tex_rect = settings[KEY_NATIVETEXTRECT].val;
-    RDP::divot_filter = settings[KEY_DIVOT].val;
-    RDP::gamma_dither = settings[KEY_GAMMADITHER].val;
-    RDP::dither_filter = settings[KEY_VIDITHER].val;
-    RDP::interlacing = settings[KEY_DEINTERLACE].val;
-    RDP::vi_aa = settings[KEY_AA].val;
-    RDP::vi_scale = settings[KEY_VIBILERP].val;
-    RDP::downscaling_steps = settings[KEY_DOWNSCALING].val;
-    RDP::synchronous = settings[KEY_SYNCHRONOUS].val;
+    RDP::native_texture_lod = profile_value(KEY_NATIVETEXTLOD);
+    RDP::native_tex_rect = profile_value(KEY_NATIVETEXTRECT);
+    RDP::divot_filter = profile_value(KEY_DIVOT);
+    RDP::gamma_dither = profile_value(KEY_GAMMADITHER);
+    RDP::dither_filter = profile_value(KEY_VIDITHER);
+    RDP::interlacing = profile_value(KEY_DEINTERLACE);
+    RDP::vi_aa = profile_value(KEY_AA);
+    RDP::vi_scale = profile_value(KEY_VIBILERP);
+    RDP::downscaling_steps = profile_value(KEY_DOWNSCALING);
+    RDP::synchronous = profile_value(KEY_SYNCHRONOUS);
 
     RDP::instant_input = settings[KEY_INSTANT_INPUT].val;
     RDP::remove_black_bars = settings[KEY_REMOVE_BLACK_BARS].val;
@@ -228,23 +268,43 @@ static void rom_open_init()
     retro_init(m_fullscreen, m_width, m_height, 320 * RDP::upscaling, 240 * RDP::upscaling);
 }
 
+// Applies changed settings to the running video driver without tearing it down.
+// Window, fullscreen and vsync only recreate the swapchain, VI options are picked up
+// by the next scanout and only the processor flags require a new CommandProcessor.
+static void xconfig_apply()
+{
+    const unsigned old_upscaling = RDP::upscaling;
+    const bool old_ss_read_back = RDP::super_sampled_read_back;
+    const bool old_ss_dither = RDP::super_sampled_dither;
+
+    xconfig_init();
+
+    if (!retro_reconfigure(m_fullscreen, m_width, m_height, 320 * RDP::upscaling, 240 * RDP::upscaling))
+    {
+        retro_deinit();
+        rom_open_init();
+        return;
+    }
+
+    if (old_upscaling != RDP::upscaling
+        || old_ss_read_back != RDP::super_sampled_read_back
+        || old_ss_dither != RDP::super_sampled_dither)
+    {
+        // The current processor keeps rendering until the new one is swapped in at SyncFull.
+        RDP::begin_frontend_rebuild();
+    }
+
+    // A frame count set since the last recording starts one right away.
+    rdp_dump_start();
+}
+
 EXPORT void CALL DllConfig(HWND hParent)
 {
     config_gui_open(hParent);
     sExecutor.async([]()
         {
-            if (m_romopened)
-            {
-                config_load();
-                xconfig_init();
-            }
-            else
-            {
-                retro_deinit();
-                config_load();
-                xconfig_init();
-                rom_open_init();
-            }
+            config_load();
+            xconfig_apply();
         });
 }
 
@@ -254,8 +314,10 @@ EXPORT void CALL RomOpen(void)
 	// tryDisableHLEGraphics();
     sExecutor.start(true /*same thread exec*/);
     sExecutor.sync([]() {
+        profile_select(gfx.HEADER);
         xconfig_init();
         rom_open_init();
+        rdp_dump_start();
     });
 }
 
@@ -269,7 +331,10 @@ EXPORT void CALL ReadScreen(void **dest, long *width, long *height)
 
 EXPORT void CALL RomClosed(void)
 {
-    sExecutor.async(retro_deinit);
+    sExecutor.async([]() {
+        RDP::capture_end();
+        retro_deinit();
+    });
     sExecutor.stop();
 }
 
@@ -294,6 +359,7 @@ EXPORT void CALL ShowCFB(void)
     };
 
     sExecutor.async([regs]() {
+        RDP::capture_frame(regs);
         RDP::complete_frame(regs);
         RDP::profile_refresh_begin();
         retro_video_refresh(RETRO_HW_FRAME_BUFFER_VALID, RDP::width, RDP::height, 0);
@@ -381,9 +447,7 @@ static void screen_toggle_fullscreen()
         // restore window size and position
         SetWindowPlacement(gfx.hWnd, &old_pos);
     }
-    retro_deinit();
-    xconfig_init();
-    rom_open_init();
+    xconfig_apply();
 }
 
 EXPORT void CALL ChangeWindow(void)
@@ -19,7 +19,17 @@ the plugin
 #ifndef _GFX_H_INCLUDED__
 #define _GFX_H_INCLUDED__
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+/* The headless build has no windows, only the types are needed. */
+#include <stdint.h>
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef void* HWND;
+#endif
 
 #if defined(__cplusplus)
 extern "C" {
@@ -28,8 +38,13 @@ extern "C" {
 /* Plugin types */
 #define PLUGIN_TYPE_GFX             2
 
+#ifdef _WIN32
 #define EXPORT                      __declspec(dllexport)
 #define CALL                        _cdecl
+#else
+#define EXPORT                      __attribute__((visibility("default")))
+#define CALL
+#endif
 
 /***** Structures *****/
 typedef struct {
@@ -0,0 +1,427 @@
+#include "headless_vulkan.h"
+#include "../parallel_imp.h"
+#include "../retroarch/video_driver.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+static void headless_log(enum retro_log_level level, const char *fmt, ...)
+{
+	static const char *const prefixes[] = { "[DEBUG] ", "[INFO] ", "[WARN] ", "[ERROR] " };
+	va_list va;
+
+	fputs(prefixes[std::min<unsigned>(level, RETRO_LOG_ERROR)], stderr);
+	va_start(va, fmt);
+	vfprintf(stderr, fmt, va);
+	va_end(va);
+}
+
+extern "C"
+{
+retro_log_printf_t log_cb = headless_log;
+}
+
+namespace Headless
+{
+// Same as the plugin's video driver with max swapchain images at 2.
+static constexpr unsigned num_sync_frames = 2;
+
+struct FrameSlot
+{
+	VkCommandBuffer cmd = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	bool submitted = false;
+
+	// The offscreen target, host visible so frames can be read back.
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	void *mapped = nullptr;
+	unsigned width = 0;
+	unsigned height = 0;
+};
+
+static VkInstance instance;
+static VkPhysicalDevice gpu;
+static VkDevice device;
+static VkQueue queue;
+static uint32_t queue_family;
+static VkCommandPool command_pool;
+static FrameSlot slots[num_sync_frames];
+static unsigned sync_index;
+static int last_slot = -1;
+static std::mutex queue_lock;
+
+static retro_hw_render_callback hw_render;
+static const retro_hw_render_context_negotiation_interface_vulkan *negotiation;
+static retro_hw_render_interface_vulkan iface;
+static retro_vulkan_image current_image;
+static bool has_image;
+
+static void set_image(void *, const retro_vulkan_image *image, uint32_t, const VkSemaphore *, uint32_t)
+{
+	current_image = *image;
+	has_image = true;
+}
+
+static uint32_t get_sync_index(void *)
+{
+	return sync_index;
+}
+
+static uint32_t get_sync_index_mask(void *)
+{
+	return (1u << num_sync_frames) - 1;
+}
+
+static void set_command_buffers(void *, uint32_t, const VkCommandBuffer *)
+{
+}
+
+static void wait_slot(FrameSlot &slot)
+{
+	if (slot.submitted)
+	{
+		vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+		slot.submitted = false;
+	}
+}
+
+static void wait_sync_index(void *)
+{
+	wait_slot(slots[sync_index]);
+}
+
+static void lock_queue(void *)
+{
+	queue_lock.lock();
+}
+
+static void unlock_queue(void *)
+{
+	queue_lock.unlock();
+}
+
+static void set_signal_semaphore(void *, VkSemaphore)
+{
+}
+
+static bool find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags flags, uint32_t *type)
+{
+	VkPhysicalDeviceMemoryProperties props;
+	vkGetPhysicalDeviceMemoryProperties(gpu, &props);
+
+	for (uint32_t i = 0; i < props.memoryTypeCount; i++)
+	{
+		if ((type_bits & (1u << i)) && (props.memoryTypes[i].propertyFlags & flags) == flags)
+		{
+			*type = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void destroy_buffer(FrameSlot &slot)
+{
+	if (slot.mapped)
+		vkUnmapMemory(device, slot.memory);
+	if (slot.buffer)
+		vkDestroyBuffer(device, slot.buffer, nullptr);
+	if (slot.memory)
+		vkFreeMemory(device, slot.memory, nullptr);
+
+	slot.mapped = nullptr;
+	slot.buffer = VK_NULL_HANDLE;
+	slot.memory = VK_NULL_HANDLE;
+	slot.size = 0;
+}
+
+static bool ensure_buffer(FrameSlot &slot, VkDeviceSize size)
+{
+	if (slot.size >= size)
+		return true;
+
+	destroy_buffer(slot);
+
+	VkBufferCreateInfo info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	info.size = size;
+	info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &info, nullptr, &slot.buffer) != VK_SUCCESS)
+		return false;
+
+	VkMemoryRequirements reqs;
+	vkGetBufferMemoryRequirements(device, slot.buffer, &reqs);
+
+	// Cached memory reads back much faster, coherent keeps it simple.
+	VkMemoryAllocateInfo alloc = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	alloc.allocationSize = reqs.size;
+	if (!find_memory_type(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+	                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+	                      &alloc.memoryTypeIndex) &&
+	    !find_memory_type(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+	                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &alloc.memoryTypeIndex))
+	{
+		destroy_buffer(slot);
+		return false;
+	}
+
+	if (vkAllocateMemory(device, &alloc, nullptr, &slot.memory) != VK_SUCCESS ||
+	    vkBindBufferMemory(device, slot.buffer, slot.memory, 0) != VK_SUCCESS ||
+	    vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.mapped) != VK_SUCCESS)
+	{
+		destroy_buffer(slot);
+		return false;
+	}
+
+	slot.size = size;
+	return true;
+}
+
+static void record_copy(FrameSlot &slot, unsigned width, unsigned height)
+{
+	VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = current_image.image_layout;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = current_image.create_info.image;
+	barrier.subresourceRange = current_image.create_info.subresourceRange;
+
+	// The core's submissions come first on the same queue, as with the
+	// plugin's video driver no semaphores are passed.
+	vkCmdPipelineBarrier(slot.cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent.width = width;
+	region.imageExtent.height = height;
+	region.imageExtent.depth = 1;
+	vkCmdCopyImageToBuffer(slot.cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+	// Hand the image back in the layout the core left it in.
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = current_image.image_layout;
+
+	VkMemoryBarrier host = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+	vkCmdPipelineBarrier(slot.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+	                     0, 1, &host, 0, nullptr, 1, &barrier);
+
+	slot.width = width;
+	slot.height = height;
+}
+
+void present()
+{
+	FrameSlot &slot = slots[sync_index];
+	wait_slot(slot);
+
+	VkCommandBufferBeginInfo begin = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkResetCommandBuffer(slot.cmd, 0);
+	vkBeginCommandBuffer(slot.cmd, &begin);
+
+	slot.width = 0;
+	slot.height = 0;
+	if (has_image && RDP::width && RDP::height)
+	{
+		if (ensure_buffer(slot, VkDeviceSize(RDP::width) * RDP::height * 4))
+			record_copy(slot, RDP::width, RDP::height);
+		else
+			log_cb(RETRO_LOG_ERROR, "Headless: failed to allocate a %ux%u frame buffer.\n", RDP::width, RDP::height);
+	}
+	vkEndCommandBuffer(slot.cmd);
+
+	VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submit.commandBufferCount = 1;
+	submit.pCommandBuffers = &slot.cmd;
+
+	vkResetFences(device, 1, &slot.fence);
+	{
+		std::lock_guard<std::mutex> lock(queue_lock);
+		vkQueueSubmit(queue, 1, &submit, slot.fence);
+	}
+	slot.submitted = true;
+
+	last_slot = slot.width ? int(sync_index) : -1;
+	has_image = false;
+	sync_index = (sync_index + 1) % num_sync_frames;
+}
+
+const uint8_t *read_frame(unsigned *width, unsigned *height)
+{
+	if (last_slot < 0)
+		return nullptr;
+
+	FrameSlot &slot = slots[last_slot];
+	wait_slot(slot);
+	*width = slot.width;
+	*height = slot.height;
+	return static_cast<const uint8_t *>(slot.mapped);
+}
+
+bool init(unsigned gpu_index)
+{
+	if (volkInitialize() != VK_SUCCESS)
+	{
+		log_cb(RETRO_LOG_ERROR, "Headless: no Vulkan loader found.\n");
+		return false;
+	}
+
+	// Registers the core's callbacks and negotiation interface below.
+	if (!parallel_retro_init_vulkan() || !negotiation)
+		return false;
+
+	VkApplicationInfo app = *negotiation->get_application_info();
+	VkInstanceCreateInfo info = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+	info.pApplicationInfo = &app;
+	if (vkCreateInstance(&info, nullptr, &instance) != VK_SUCCESS)
+	{
+		log_cb(RETRO_LOG_ERROR, "Headless: failed to create a Vulkan instance.\n");
+		return false;
+	}
+	volkLoadInstance(instance);
+
+	uint32_t count = 0;
+	vkEnumeratePhysicalDevices(instance, &count, nullptr);
+	std::vector<VkPhysicalDevice> gpus(count);
+	vkEnumeratePhysicalDevices(instance, &count, gpus.data());
+	if (gpu_index >= count)
+	{
+		log_cb(RETRO_LOG_ERROR, "Headless: GPU %u requested, %u found.\n", gpu_index, count);
+		deinit();
+		return false;
+	}
+	gpu = gpus[gpu_index];
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(gpu, &props);
+	log_cb(RETRO_LOG_INFO, "Headless: using GPU %u, %s.\n", gpu_index, props.deviceName);
+
+	// No surface, the core only asks for what it needs itself.
+	retro_vulkan_context context = {};
+	if (!negotiation->create_device(&context, instance, gpu, VK_NULL_HANDLE, vkGetInstanceProcAddr,
+	                                nullptr, 0, nullptr, 0, nullptr))
+	{
+		log_cb(RETRO_LOG_ERROR, "Headless: the core failed to create a device.\n");
+		deinit();
+		return false;
+	}
+	device = context.device;
+	queue = context.queue;
+	queue_family = context.queue_family_index;
+	volkLoadDevice(device);
+
+	VkCommandPoolCreateInfo pool_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_info.queueFamilyIndex = queue_family;
+	vkCreateCommandPool(device, &pool_info, nullptr, &command_pool);
+
+	for (FrameSlot &slot : slots)
+	{
+		VkCommandBufferAllocateInfo alloc = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		alloc.commandPool = command_pool;
+		alloc.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		alloc.commandBufferCount = 1;
+		vkAllocateCommandBuffers(device, &alloc, &slot.cmd);
+
+		VkFenceCreateInfo fence_info = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+		vkCreateFence(device, &fence_info, nullptr, &slot.fence);
+	}
+
+	iface.interface_type = RETRO_HW_RENDER_INTERFACE_VULKAN;
+	iface.interface_version = 5;
+	iface.handle = &iface;
+	iface.instance = instance;
+	iface.gpu = gpu;
+	iface.device = device;
+	iface.get_device_proc_addr = vkGetDeviceProcAddr;
+	iface.get_instance_proc_addr = vkGetInstanceProcAddr;
+	iface.queue = queue;
+	iface.queue_index = queue_family;
+	iface.set_image = set_image;
+	iface.get_sync_index = get_sync_index;
+	iface.get_sync_index_mask = get_sync_index_mask;
+	iface.set_command_buffers = set_command_buffers;
+	iface.wait_sync_index = wait_sync_index;
+	iface.lock_queue = lock_queue;
+	iface.unlock_queue = unlock_queue;
+	iface.set_signal_semaphore = set_signal_semaphore;
+
+	sync_index = 0;
+	last_slot = -1;
+	hw_render.context_reset();
+	return RDP::vulkan != nullptr;
+}
+
+void deinit()
+{
+	if (device)
+		vkDeviceWaitIdle(device);
+
+	if (device && hw_render.context_destroy)
+		hw_render.context_destroy();
+
+	for (FrameSlot &slot : slots)
+	{
+		if (device)
+		{
+			destroy_buffer(slot);
+			if (slot.fence)
+				vkDestroyFence(device, slot.fence, nullptr);
+		}
+		slot = FrameSlot();
+	}
+
+	if (command_pool)
+		vkDestroyCommandPool(device, command_pool, nullptr);
+	if (device)
+		vkDestroyDevice(device, nullptr);
+	if (instance)
+		vkDestroyInstance(instance, nullptr);
+
+	command_pool = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+	instance = VK_NULL_HANDLE;
+	gpu = VK_NULL_HANDLE;
+	negotiation = nullptr;
+	has_image = false;
+	last_slot = -1;
+}
+}
+
+// What the core expects from RetroArch, see retroarch.c for the plugin's.
+extern "C" void *retro_get_hw_render_interface(void)
+{
+	return Headless::device ? &Headless::iface : nullptr;
+}
+
+extern "C" bool retro_set_hw_render(void *data)
+{
+	if (!data)
+		return false;
+
+	Headless::hw_render = *static_cast<const retro_hw_render_callback *>(data);
+	return true;
+}
+
+extern "C" bool retro_set_hw_render_context_negotiation_interface(void *data)
+{
+	Headless::negotiation = static_cast<const retro_hw_render_context_negotiation_interface_vulkan *>(data);
+	return true;
+}
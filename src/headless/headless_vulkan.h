@@ -0,0 +1,28 @@
+#ifndef HEADLESS_VULKAN_H
+#define HEADLESS_VULKAN_H
+
+#include <stdint.h>
+
+// Stands in for the RetroArch Vulkan driver when the core runs without a
+// window. Presenting copies the scanout image into a host visible buffer
+// instead of a swapchain, so frames cost about what a real present does
+// and can still be read back.
+
+namespace Headless
+{
+// Creates the instance and lets parallel_imp create the device through the
+// context negotiation interface, as the plugin's video driver does, then
+// runs the core's context_reset. @gpu_index picks the physical device.
+bool init(unsigned gpu_index);
+void deinit();
+
+// Called after RDP::complete_frame, hands the image the core set to the
+// offscreen target and moves to the next sync index.
+void present();
+
+// The last presented frame as R8G8B8A8 rows, tightly packed. Waits for the
+// copy to land. Returns nullptr before the first frame.
+const uint8_t *read_frame(unsigned *width, unsigned *height);
+}
+
+#endif
@@ -0,0 +1,319 @@
+/*  pj64-parallel-rdp-replay - replays an RDP dump through the plugin core
+ *  without a window.
+ *
+ *  Usage: pj64-parallel-rdp-replay [-g gpu] [-u upscaling] [-d downscaling steps]
+ *                                  [-s] [-a] [-n frames] [-o prefix] dump.rdp
+ *
+ *  Dumps are the RDPDUMP2 files rdp_dump_write.cpp writes: RDRAM updates,
+ *  RDP commands and VI registers. Commands are fed to RDP::process_commands
+ *  through DMEM, the way ProcessRDPList does, and every frame ends in
+ *  RDP::complete_frame and a present into an offscreen buffer, both on a
+ *  QueueExecutor like in the plugin. So the timings cover the same path.
+ *
+ *  -s enables super sampled read back, -a turns synchronous RDP off. With
+ *  -o every frame is also read back and written to <prefix>_00000.qoi and
+ *  on. Runs on any Vulkan 1.1 device, lavapipe included.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../gfx_1.3.h"
+#include "../gfxstructdefs.h"
+#include "../parallel_imp.h"
+#include "../queue_executor.h"
+#include "../screenshot/qoi_writer.h"
+#include "headless_vulkan.h"
+
+// What gfx_1.3.cpp provides in the plugin.
+GFX_INFO gfx;
+uint32_t rdram_size;
+
+enum DumpCmd : uint32_t
+{
+	DUMP_CMD_UPDATE_DRAM = 1,
+	DUMP_CMD_RDP_COMMAND = 2,
+	DUMP_CMD_SET_VI_REGISTER = 3,
+	DUMP_CMD_END_FRAME = 4,
+	DUMP_CMD_SIGNAL_COMPLETE = 5,
+	DUMP_CMD_EOF = 6,
+	DUMP_CMD_UPDATE_DRAM_FLUSH = 7,
+	DUMP_CMD_UPDATE_HIDDEN_DRAM = 8,
+	DUMP_CMD_UPDATE_HIDDEN_DRAM_FLUSH = 9,
+};
+
+#define DMEM_SIZE 0x1000
+
+static uint8_t dmem[DMEM_SIZE];
+static uint8_t imem[DMEM_SIZE];
+static uint8_t header[0x40];
+static DWORD mi_intr_reg;
+static DWORD dpc_regs[8];
+static DWORD vi_regs[14];
+
+static void check_interrupts()
+{
+}
+
+static bool read_u32(FILE *file, uint32_t &value)
+{
+	return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+static void set_vi_register(RDP::VIRegsSample &regs, uint32_t reg, uint32_t value)
+{
+	switch (RDP::VIRegister(reg))
+	{
+	case RDP::VIRegister::Control: regs.VI_STATUS = value; break;
+	case RDP::VIRegister::Origin: regs.VI_ORIGIN = value; break;
+	case RDP::VIRegister::Width: regs.VI_WIDTH = value; break;
+	case RDP::VIRegister::Intr: regs.VI_INTR = value; break;
+	case RDP::VIRegister::VCurrentLine: regs.VI_V_CURRENT_LINE = value; break;
+	case RDP::VIRegister::Timing: regs.VI_TIMING = value; break;
+	case RDP::VIRegister::VSync: regs.VI_V_SYNC = value; break;
+	case RDP::VIRegister::HSync: regs.VI_H_SYNC = value; break;
+	case RDP::VIRegister::Leap: regs.VI_LEAP = value; break;
+	case RDP::VIRegister::HStart: regs.VI_H_START = value; break;
+	case RDP::VIRegister::VStart: regs.VI_V_START = value; break;
+	case RDP::VIRegister::VBurst: regs.VI_V_BURST = value; break;
+	case RDP::VIRegister::XScale: regs.VI_X_SCALE = value; break;
+	case RDP::VIRegister::YScale: regs.VI_Y_SCALE = value; break;
+	default: break;
+	}
+}
+
+static void write_frame(const std::string &prefix, unsigned frame)
+{
+	unsigned width, height;
+	const uint8_t *rgba = Headless::read_frame(&width, &height);
+	if (!rgba)
+		return;
+
+	std::vector<uint8_t> bgr(size_t(width) * height * 3);
+	for (size_t i = 0, n = size_t(width) * height; i < n; i++)
+	{
+		bgr[3 * i + 0] = rgba[4 * i + 2];
+		bgr[3 * i + 1] = rgba[4 * i + 1];
+		bgr[3 * i + 2] = rgba[4 * i + 0];
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "_%05u.qoi", frame);
+	if (!qoi_writer_save_bgr24((prefix + name).c_str(), int(width), int(height), bgr.data(), int(width * 3)))
+		fprintf(stderr, "Failed to write %s%s.\n", prefix.c_str(), name);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned gpu_index = 0;
+	unsigned max_frames = ~0u;
+	const char *prefix = nullptr;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-s"))
+			RDP::super_sampled_read_back = true;
+		else if (!strcmp(argv[i], "-a"))
+			RDP::synchronous = false;
+		else if (i + 1 >= argc)
+			break;
+		else if (!strcmp(argv[i], "-g"))
+			gpu_index = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-u"))
+			RDP::upscaling = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-d"))
+			RDP::downscaling_steps = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-n"))
+			max_frames = unsigned(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-o"))
+			prefix = argv[++i];
+		else
+			break;
+	}
+
+	if (i + 1 != argc)
+	{
+		fprintf(stderr, "Usage: %s [-g gpu] [-u upscaling] [-d downscaling steps] [-s] [-a] "
+		                "[-n frames] [-o prefix] dump.rdp\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(argv[i], "rb");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open %s.\n", argv[i]);
+		return 1;
+	}
+	setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+	char magic[8];
+	uint32_t dram_size = 0, hidden_dram_size = 0;
+	if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, "RDPDUMP2", sizeof(magic)) ||
+	    !read_u32(file, dram_size) || !read_u32(file, hidden_dram_size) ||
+	    (dram_size != 0x400000 && dram_size != 0x800000))
+	{
+		fprintf(stderr, "%s is not an RDP dump.\n", argv[i]);
+		fclose(file);
+		return 1;
+	}
+
+	// Imported host memory wants RDRAM 64 KiB aligned, as the emulator does.
+	std::vector<uint8_t> rdram_storage(dram_size + 0x10000);
+	uint8_t *rdram = reinterpret_cast<uint8_t *>(
+		(reinterpret_cast<uintptr_t>(rdram_storage.data()) + 0xffff) & ~uintptr_t(0xffff));
+
+	rdram_size = dram_size;
+	gfx.HEADER = header;
+	gfx.RDRAM = rdram;
+	gfx.DMEM = dmem;
+	gfx.IMEM = imem;
+	gfx.MI_INTR_REG = &mi_intr_reg;
+	gfx.DPC_START_REG = &dpc_regs[0];
+	gfx.DPC_END_REG = &dpc_regs[1];
+	gfx.DPC_CURRENT_REG = &dpc_regs[2];
+	gfx.DPC_STATUS_REG = &dpc_regs[3];
+	gfx.DPC_CLOCK_REG = &dpc_regs[4];
+	gfx.DPC_BUFBUSY_REG = &dpc_regs[5];
+	gfx.DPC_PIPEBUSY_REG = &dpc_regs[6];
+	gfx.DPC_TMEM_REG = &dpc_regs[7];
+	DWORD **vi_ptrs[] = {
+		&gfx.VI_STATUS_REG, &gfx.VI_ORIGIN_REG, &gfx.VI_WIDTH_REG, &gfx.VI_INTR_REG,
+		&gfx.VI_V_CURRENT_LINE_REG, &gfx.VI_TIMING_REG, &gfx.VI_V_SYNC_REG, &gfx.VI_H_SYNC_REG,
+		&gfx.VI_LEAP_REG, &gfx.VI_H_START_REG, &gfx.VI_V_START_REG, &gfx.VI_V_BURST_REG,
+		&gfx.VI_X_SCALE_REG, &gfx.VI_Y_SCALE_REG,
+	};
+	for (unsigned r = 0; r < sizeof(vi_ptrs) / sizeof(vi_ptrs[0]); r++)
+		*vi_ptrs[r] = &vi_regs[r];
+	gfx.CheckInterrupts = check_interrupts;
+
+	QueueExecutor executor;
+	bool ok = false;
+	executor.start(true /*same thread exec*/);
+	executor.sync([&]() { ok = Headless::init(gpu_index); });
+	if (!ok)
+	{
+		executor.sync([]() { Headless::deinit(); });
+		executor.stop();
+		fclose(file);
+		return 1;
+	}
+
+	// Commands are gathered in DMEM and handed over in one go, as the RSP
+	// does with XBUS transfers.
+	size_t dmem_used = 0;
+	auto flush_commands = [&]() {
+		if (!dmem_used)
+			return;
+		*gfx.DPC_CURRENT_REG = 0;
+		*gfx.DPC_END_REG = DWORD(dmem_used);
+		*gfx.DPC_STATUS_REG = DP_STATUS_XBUS_DMA;
+		executor.sync([]() {
+			RDP::begin_frame();
+			RDP::process_commands();
+		});
+		dmem_used = 0;
+	};
+
+	RDP::VIRegsSample regs = {};
+	std::vector<uint32_t> words;
+	unsigned frames = 0;
+	bool valid = true;
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t cmd; frames < max_frames && valid && read_u32(file, cmd) && cmd != DUMP_CMD_EOF;)
+	{
+		switch (cmd)
+		{
+		case DUMP_CMD_RDP_COMMAND:
+		{
+			uint32_t command, num_words;
+			valid = read_u32(file, command) && read_u32(file, num_words) && num_words && num_words * 4 <= DMEM_SIZE;
+			if (!valid)
+				break;
+
+			words.resize(num_words);
+			valid = fread(words.data(), sizeof(uint32_t), num_words, file) == num_words;
+			if (dmem_used + num_words * 4 > DMEM_SIZE)
+				flush_commands();
+			memcpy(dmem + dmem_used, words.data(), num_words * 4);
+			dmem_used += num_words * 4;
+			break;
+		}
+
+		case DUMP_CMD_UPDATE_DRAM:
+		case DUMP_CMD_UPDATE_HIDDEN_DRAM:
+		{
+			uint32_t offset, size;
+			valid = read_u32(file, offset) && read_u32(file, size);
+			if (!valid)
+				break;
+
+			// Commands already queued read the memory as it was.
+			flush_commands();
+
+			// Hidden RDRAM is not something the plugin ever sees.
+			if (cmd == DUMP_CMD_UPDATE_DRAM && offset <= dram_size && size <= dram_size - offset)
+				valid = fread(rdram + offset, 1, size, file) == size;
+			else
+				valid = fseek(file, long(size), SEEK_CUR) == 0;
+			break;
+		}
+
+		case DUMP_CMD_SET_VI_REGISTER:
+		{
+			uint32_t reg, value;
+			valid = read_u32(file, reg) && read_u32(file, value);
+			set_vi_register(regs, reg, value);
+			break;
+		}
+
+		case DUMP_CMD_END_FRAME:
+		{
+			flush_commands();
+			unsigned frame = frames++;
+			std::string out = prefix ? prefix : "";
+			executor.async([regs, frame, out]() {
+				RDP::complete_frame(regs);
+				Headless::present();
+				if (!out.empty())
+					write_frame(out, frame);
+			});
+			break;
+		}
+
+		case DUMP_CMD_SIGNAL_COMPLETE:
+		case DUMP_CMD_UPDATE_DRAM_FLUSH:
+		case DUMP_CMD_UPDATE_HIDDEN_DRAM_FLUSH:
+			flush_commands();
+			break;
+
+		default:
+			fprintf(stderr, "Unknown dump command %u.\n", cmd);
+			valid = false;
+			break;
+		}
+	}
+
+	flush_commands();
+	executor.sync([]() {
+		unsigned width, height;
+		Headless::read_frame(&width, &height);
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	executor.sync([]() { Headless::deinit(); });
+	executor.stop();
+	fclose(file);
+
+	printf("%u frames in %.3f s, %.2f fps.\n", frames, seconds, seconds > 0.0 ? frames / seconds : 0.0);
+	if (!valid)
+		fprintf(stderr, "The dump ends early or is corrupt.\n");
+	return valid ? 0 : 1;
+}
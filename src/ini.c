@@ -1,15 +1,44 @@
 #include "ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
 #include <fcntl.h>
 #include <Shlobj.h>
 #include <shlwapi.h>
 #include <windows.h>
-#include <stdbool.h>
-
-extern char gPluginConfigDir[MAX_PATH];
-char ini_file[MAX_PATH] = { 0 };
 
 #pragma comment(lib, "Shlwapi.lib")
+#else
+#include <sys/stat.h>
+#endif
+
+extern char gPluginConfigDir[INI_PATH_MAX];
+char ini_file[INI_PATH_MAX] = { 0 };
+char ini_dir[INI_PATH_MAX] = { 0 };
+
+// Every setting lives in this section, keys elsewhere are kept but not read.
+#define INI_SECTION "Settings"
+
+// One line of the file. Only key=value lines have a key and value, text
+// holds the line as read and is dropped once the value is changed, so
+// comments and untouched lines are written back exactly as they were.
+struct ini_line
+{
+	char* text;
+	char* key;
+	char* value;
+	bool in_section; // Under [Settings], its own header line included
+};
+
+static struct ini_line* ini_lines;
+static size_t ini_count;
+static size_t ini_capacity;
+static bool ini_dirty;
 
+#ifdef _WIN32
 void ini_init()
 {
 	if ('\0' != *ini_file)
@@ -30,27 +59,328 @@ void ini_init()
 
 	PathAppend(ini_file, "LParallel");
 	CreateDirectory(ini_file, NULL); // can fail, ignore errors
+	strncpy_s(ini_dir, sizeof(ini_dir), ini_file, MAX_PATH);
 	PathAppend(ini_file, "cfg.ini");
 }
+#else
+void ini_init()
+{
+	const char* base = getenv("XDG_CONFIG_HOME");
+	int len;
+
+	if ('\0' != *ini_file)
+		return;
+
+	if (*gPluginConfigDir)
+		len = snprintf(ini_dir, sizeof(ini_dir), "%s/LParallel", gPluginConfigDir);
+	else if (base && *base)
+		len = snprintf(ini_dir, sizeof(ini_dir), "%s/LParallel", base);
+	else
+		len = snprintf(ini_dir, sizeof(ini_dir), "%s/.config/LParallel", getenv("HOME") ? getenv("HOME") : ".");
+
+	// A truncated path names some other file. Leave both empty, so loading
+	// and saving fail and the defaults are used.
+	if (len < 0 || len >= (int)sizeof(ini_dir))
+	{
+		ini_dir[0] = '\0';
+		return;
+	}
+
+	mkdir(ini_dir, 0755); // can fail, ignore errors
+	len = snprintf(ini_file, sizeof(ini_file), "%s/cfg.ini", ini_dir);
+	if (len < 0 || len >= (int)sizeof(ini_file))
+		ini_file[0] = '\0';
+}
+#endif
+
+static bool ini_equal(const char* a, const char* b)
+{
+	// Keys and sections are case insensitive, as with the profile API.
+	for (; *a && *b; a++, b++)
+	{
+		char ca = *a, cb = *b;
+		if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+		if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+		if (ca != cb)
+			return false;
+	}
+	return *a == *b;
+}
+
+static char* ini_strndup(const char* str, size_t len)
+{
+	char* copy = (char*)malloc(len + 1);
+	if (copy)
+	{
+		memcpy(copy, str, len);
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+static void ini_trim(const char** begin, const char** end)
+{
+	while (*begin < *end && (**begin == ' ' || **begin == '\t'))
+		(*begin)++;
+	while (*end > *begin && ((*end)[-1] == ' ' || (*end)[-1] == '\t'))
+		(*end)--;
+}
+
+static void ini_clear(void)
+{
+	for (size_t i = 0; i < ini_count; i++)
+	{
+		free(ini_lines[i].text);
+		free(ini_lines[i].key);
+		free(ini_lines[i].value);
+	}
+	ini_count = 0;
+	ini_dirty = false;
+}
+
+static struct ini_line* ini_insert(size_t pos)
+{
+	if (ini_count == ini_capacity)
+	{
+		size_t capacity = ini_capacity ? ini_capacity * 2 : 64;
+		struct ini_line* lines = (struct ini_line*)realloc(ini_lines, capacity * sizeof(*lines));
+		if (!lines)
+			return NULL;
+		ini_lines = lines;
+		ini_capacity = capacity;
+	}
+
+	memmove(ini_lines + pos + 1, ini_lines + pos, (ini_count - pos) * sizeof(*ini_lines));
+	ini_count++;
+	memset(ini_lines + pos, 0, sizeof(*ini_lines));
+	return ini_lines + pos;
+}
+
+static void ini_parse(const char* data, size_t size)
+{
+	const char* end = data + size;
+	bool in_section = false;
+
+	// Skip a UTF-8 BOM, editors like to add one.
+	if (size >= 3 && !memcmp(data, "\xEF\xBB\xBF", 3))
+		data += 3;
+
+	while (data < end)
+	{
+		const char* eol = memchr(data, '\n', end - data);
+		const char* next = eol ? eol + 1 : end;
+		const char* text_end = eol ? eol : end;
+		struct ini_line* line;
+
+		if (text_end > data && text_end[-1] == '\r')
+			text_end--;
+
+		line = ini_insert(ini_count);
+		if (!line)
+			return;
+		line->text = ini_strndup(data, text_end - data);
+
+		const char* begin = data;
+		const char* finish = text_end;
+		ini_trim(&begin, &finish);
+
+		if (begin < finish && *begin == '[')
+		{
+			const char* close = memchr(begin, ']', finish - begin);
+			const char* name = begin + 1;
+			const char* name_end = close ? close : finish;
+			ini_trim(&name, &name_end);
+
+			char* section = ini_strndup(name, name_end - name);
+			in_section = section && ini_equal(section, INI_SECTION);
+			free(section);
+		}
+		else if (begin < finish && *begin != ';' && *begin != '#')
+		{
+			const char* eq = memchr(begin, '=', finish - begin);
+			if (eq)
+			{
+				const char* key_end = eq;
+				const char* value = eq + 1;
+				const char* value_end = finish;
+
+				ini_trim(&begin, &key_end);
+				ini_trim(&value, &value_end);
+
+				// Quoted values lose their quotes, as with the profile API.
+				if (value_end - value >= 2 && (*value == '"' || *value == '\'') && value_end[-1] == *value)
+				{
+					value++;
+					value_end--;
+				}
+
+				line->key = ini_strndup(begin, key_end - begin);
+				line->value = ini_strndup(value, value_end - value);
+			}
+		}
+
+		line->in_section = in_section;
+		data = next;
+	}
+}
+
+bool ini_load()
+{
+	FILE* file;
+	char* data;
+	long size;
+	bool ok;
+
+	ini_clear();
+
+	file = fopen(ini_file, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = size > 0 ? (char*)malloc(size) : NULL;
+	ok = size == 0 || (data && fread(data, 1, size, file) == (size_t)size);
+	if (ok && data)
+		ini_parse(data, size);
+
+	free(data);
+	fclose(file);
+	return ok;
+}
+
+bool ini_save()
+{
+	char tmp_file[INI_PATH_MAX + 4];
+	FILE* file;
+	bool ok = true;
+
+	if (!ini_dirty)
+		return true;
+	if ('\0' == *ini_file)
+		return false;
+
+	// Written next to the config and moved over it, so a crash halfway
+	// leaves the old file rather than a truncated one.
+	snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", ini_file);
+	file = fopen(tmp_file, "wb");
+	if (!file)
+		return false;
+
+	for (size_t i = 0; ok && i < ini_count; i++)
+	{
+		const struct ini_line* line = ini_lines + i;
+		if (line->text)
+			ok = fprintf(file, "%s\r\n", line->text) >= 0;
+		else
+			ok = fprintf(file, "%s=%s\r\n", line->key, line->value) >= 0;
+	}
+
+	ok = (fclose(file) == 0) && ok;
+#ifdef _WIN32
+	ok = ok && MoveFileExA(tmp_file, ini_file, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	ok = ok && rename(tmp_file, ini_file) == 0;
+#endif
+
+	if (!ok)
+		remove(tmp_file);
+	else
+		ini_dirty = false;
+	return ok;
+}
+
+static struct ini_line* ini_find(const char* key)
+{
+	for (size_t i = 0; i < ini_count; i++)
+	{
+		if (ini_lines[i].in_section && ini_lines[i].key && ini_equal(ini_lines[i].key, key))
+			return ini_lines + i;
+	}
+	return NULL;
+}
+
+bool ini_set_string(const char* key, const char* value)
+{
+	struct ini_line* line = ini_find(key);
+	char* copy;
+
+	if (line && !strcmp(line->value, value))
+		return true;
+
+	copy = ini_strndup(value, strlen(value));
+	if (!copy)
+		return false;
+
+	if (!line)
+	{
+		// New keys go after the last line of the section, which is
+		// started at the end of the file when there is none yet.
+		size_t pos = ini_count;
+		while (pos > 0 && !ini_lines[pos - 1].in_section)
+			pos--;
+
+		if (pos == 0)
+		{
+			line = ini_insert(ini_count);
+			if (!line)
+			{
+				free(copy);
+				return false;
+			}
+			line->text = ini_strndup("[" INI_SECTION "]", strlen(INI_SECTION) + 2);
+			line->in_section = true;
+			pos = ini_count;
+		}
+
+		line = ini_insert(pos);
+		if (!line)
+		{
+			free(copy);
+			return false;
+		}
+		line->key = ini_strndup(key, strlen(key));
+		line->in_section = true;
+	}
+
+	free(line->text);
+	free(line->value);
+	line->text = NULL;
+	line->value = copy;
+	ini_dirty = true;
+	return line->key != NULL;
+}
+
+bool ini_get_string(const char* key, char* value, size_t size)
+{
+	// missing keys read back as empty, which every string setting treats as unset
+	const struct ini_line* line = ini_find(key);
+
+	if (!size)
+		return false;
+
+	snprintf(value, size, "%s", line ? line->value : "");
+	return *value != '\0';
+}
 
 bool ini_set_value(const char* key, int value)
 {
-	char num_str[10];
-	itoa(value, num_str, 10);
-    return WritePrivateProfileStringA("Settings", key, num_str, ini_file);
+	char num_str[16];
+	snprintf(num_str, sizeof(num_str), "%d", value);
+	return ini_set_string(key, num_str);
 }
 
 bool ini_get_value(const char* key, int* value)
 {
-    char buf[MAX_PATH];
-    GetPrivateProfileStringA("Settings", key, NULL, buf, MAX_PATH, ini_file);
-    if (buf == NULL)
-    {
-    	*value = 0;
-        return false;
-    }
+	const struct ini_line* line = ini_find(key);
+	if (!line)
+	{
+		*value = 0;
+		return false;
+	}
 
-    *value = atoi(buf);
-    return true;
+	*value = atoi(line->value);
+	return true;
 }
-
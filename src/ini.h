@@ -2,12 +2,28 @@
 #define INI_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _WIN32
 #include <windows.h>
+#define INI_PATH_MAX MAX_PATH
+#else
+#define INI_PATH_MAX 260
+#endif
 
-extern char ini_file[MAX_PATH];
+extern char ini_file[INI_PATH_MAX];
+extern char ini_dir[INI_PATH_MAX];
 
 extern void ini_init(void);
+
+// The file is parsed once by ini_load, the getters and setters below only
+// touch that copy in memory and ini_save writes it back in one go.
+extern bool ini_load(void);
+extern bool ini_save(void);
+
 extern bool ini_set_value(const char* key, int value);
 extern bool ini_get_value(const char* key, int* value);
+extern bool ini_set_string(const char* key, const char* value);
+extern bool ini_get_string(const char* key, char* value, size_t size);
 
 #endif // INI_H
@@ -48,8 +48,14 @@ set(PARALLEL_RDP_INCLUDE_DIRS
 )
 
 set(PARALLEL_RDP_DEFS NOMINMAX GRANITE_VULKAN_MT)
-set(PARALLEL_RDP_LIBS winmm)
-list(APPEND PARALLEL_RDP_DEFS VK_USE_PLATFORM_WIN32_KHR)
+if(WIN32)
+    set(PARALLEL_RDP_LIBS winmm)
+    list(APPEND PARALLEL_RDP_DEFS VK_USE_PLATFORM_WIN32_KHR)
+else()
+    # volk loads libvulkan at runtime, the headless build needs no WSI.
+    find_package(Threads REQUIRED)
+    set(PARALLEL_RDP_LIBS ${CMAKE_DL_LIBS} Threads::Threads)
+endif()
 
 add_library(parallel-rdp-standalone STATIC ${PARALLEL_RDP_SRC_FILES})
 target_link_libraries(parallel-rdp-standalone PUBLIC ${PARALLEL_RDP_LIBS})
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Calls fn(i) for every i below count, spread over up to one thread per core.
+// Indices are handed out one at a time, so slow items don't hold up the rest.
+// The calling thread works too, and finishes alone if no thread can be started.
+template <typename Fn>
+static inline void parallel_for(unsigned count, Fn&& fn)
+{
+	unsigned num_workers = std::min<unsigned>(
+		std::max(1u, std::thread::hardware_concurrency()), count);
+	std::atomic<unsigned> next(0);
+	std::vector<std::thread> workers;
+
+	auto worker = [&]() {
+		unsigned index;
+		while ((index = next++) < count)
+			fn(index);
+	};
+
+	try
+	{
+		for (unsigned i = 1; i < num_workers; i++)
+			workers.emplace_back(worker);
+	}
+	catch (const std::system_error&)
+	{
+		// Out of threads, the ones already running share the rest.
+	}
+	worker();
+
+	for (auto& thread : workers)
+		thread.join();
+}
@@ -1,10 +1,16 @@
 #include "parallel_imp.h"
+#include "rdp_capture.h"
 #include "gfx_1.3.h"
 #include "gfxstructdefs.h"
 #include "retroarch/video_driver.h"
 #include "retroarch/retroarch.h"
 
+#include "thread_id.hpp"
+
 #include <assert.h>
+#include <chrono>
+#include <deque>
+#include <future>
 
 using namespace Vulkan;
 using namespace std;
@@ -13,6 +19,7 @@ extern "C" retro_log_printf_t log_cb;
 extern "C" retro_environment_t environ_cb;
 extern "C" uint32_t rdram_size;
 extern "C" GFX_INFO gfx;
+extern "C" unsigned video_driver_get_history_size(void);
 
 namespace RDP
 {
@@ -26,12 +33,14 @@ static uint32_t cmd_data[0x00040000 >> 2];
 static uint64_t pending_timeline_value, timeline_value;
 
 static unique_ptr<CommandProcessor> frontend;
+static future<unique_ptr<CommandProcessor>> pending_frontend;
 static unique_ptr<Device> device;
 static unique_ptr<Context> context;
 static QueryPoolHandle begin_ts, end_ts;
 
 static vector<retro_vulkan_image> retro_images;
 static vector<ImageHandle> retro_image_handles;
+static deque<ImageHandle> history_image_handles;
 unsigned width, height;
 unsigned overscan;
 unsigned upscaling = 1;
@@ -45,6 +54,31 @@ bool instant_input = false, remove_black_bars = false;
 
 static uint32_t sCachedColorAddress = 0;
 
+// The background rebuild allocates from the device on a thread of its own, so it
+// gets a thread index no other thread uses and command pools of its own.
+#define REBUILD_THREAD_INDEX 2
+
+// Called on SyncFull, where the RDP holds no state the new processor would miss.
+static void swap_pending_frontend()
+{
+	if (!pending_frontend.valid() ||
+	    pending_frontend.wait_for(chrono::seconds(0)) != future_status::ready)
+		return;
+
+	unique_ptr<CommandProcessor> processor = pending_frontend.get();
+	if (!processor)
+	{
+		log_cb(RETRO_LOG_ERROR, "paraLLEl-RDP: Background rebuild failed, keeping the current command processor.\n");
+		return;
+	}
+
+	if (frontend)
+		frontend->wait_for_timeline(frontend->signal_timeline());
+	frontend = std::move(processor);
+	timeline_value = 0;
+	pending_timeline_value = 0;
+}
+
 static const unsigned cmd_len_lut[64] = {
 	1, 1, 1, 1, 1, 1, 1, 1, 4, 6, 12, 14, 12, 14, 20, 22,
 	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  1,  1,  1,  1,  1,
@@ -111,16 +145,24 @@ void process_commands()
 			return;
 		}
 
-		if (command >= 8 && frontend)
-			frontend->enqueue_command(cmd_length * 2, &cmd_data[2 * cmd_cur]);
+		if (command >= 8)
+		{
+			if (frontend)
+				frontend->enqueue_command(cmd_length * 2, &cmd_data[2 * cmd_cur]);
+			capture_command(command, &cmd_data[2 * cmd_cur], cmd_length * 2);
+		}
 
 		if (RDP::Op(command) == RDP::Op::SyncFull)
 		{
+			capture_sync_full();
+
 			// For synchronous RDP:
 			if (synchronous && frontend)
 				frontend->wait_for_timeline(frontend->signal_timeline());
 			*gfx.MI_INTR_REG |= DP_INTERRUPT;
 			gfx.CheckInterrupts();
+
+			swap_pending_frontend();
 		}
 		if (RDP::Op(command) == RDP::Op::SetColorImage)
 		{
@@ -174,34 +216,9 @@ void begin_frame()
 	//pending_timeline_value = timeline_value;
 }
 
-bool init()
+static unique_ptr<CommandProcessor> create_frontend(unsigned scale, bool ss_read_back, bool ss_dither,
+		bool texture_lod, bool tex_rect)
 {
-	if (!context || !vulkan)
-		return false;
-
-	unsigned mask = vulkan->get_sync_index_mask(vulkan->handle);
-	unsigned num_frames = 0;
-	unsigned num_sync_frames = 0;
-	for (unsigned i = 0; i < 32; i++)
-	{
-		if (mask & (1u << i))
-		{
-			num_frames = i + 1;
-			num_sync_frames++;
-		}
-	}
-
-	retro_images.resize(num_frames);
-	retro_image_handles.resize(num_frames);
-
-	device.reset(new Device);
-	device->set_context(*context);
-	device->init_frame_contexts(num_sync_frames);
-	log_cb(RETRO_LOG_INFO, "Using %u sync frames for parallel-RDP.\n", num_sync_frames);
-	device->set_queue_lock(
-			[]() { vulkan->lock_queue(vulkan->handle); },
-			[]() { vulkan->unlock_queue(vulkan->handle); });
-
 	uintptr_t aligned_rdram = reinterpret_cast<uintptr_t>(gfx.RDRAM);
 	uintptr_t offset = 0;
 
@@ -214,7 +231,7 @@ bool init()
 		if (offset)
 		{
 			log_cb(RETRO_LOG_ERROR, "Host RDRAM is not aligned properly! Make sure to use align RDRAM to 64 KiB!\n");
-			return false;
+			return {};
 		}
 		aligned_rdram -= offset;
 	}
@@ -224,11 +241,11 @@ bool init()
 	if (rdram_size == 0)
 	{
 		log_cb(RETRO_LOG_ERROR, "RDRAM size is 0, was graphics initialized too early?\n");
-		return false;
+		return {};
 	}
 
 	CommandProcessorFlags flags = 0;
-	switch (upscaling)
+	switch (scale)
 	{
 		case 2:
 			flags |= COMMAND_PROCESSOR_FLAG_UPSCALING_2X_BIT;
@@ -249,26 +266,72 @@ bool init()
 			break;
 	}
 
-	if (upscaling > 1 && super_sampled_read_back)
+	if (scale > 1 && ss_read_back)
 		flags |= COMMAND_PROCESSOR_FLAG_SUPER_SAMPLED_READ_BACK_BIT;
-	if (super_sampled_dither)
+	if (ss_dither)
 		flags |= COMMAND_PROCESSOR_FLAG_SUPER_SAMPLED_DITHER_BIT;
 
 	log_cb(RETRO_LOG_INFO, "paraLLEl-RDP: Using RDRAM size of %u bytes.\n", rdram_size);
-	frontend.reset(new CommandProcessor(*device, reinterpret_cast<void *>(aligned_rdram),
+	unique_ptr<CommandProcessor> processor(new CommandProcessor(*device, reinterpret_cast<void *>(aligned_rdram),
 				offset, rdram_size, rdram_size / 2, flags));
 
-	if (!frontend->device_is_supported())
+	if (!processor->device_is_supported())
 	{
 		log_cb(RETRO_LOG_ERROR, "This device probably does not support 8/16-bit storage. Make sure you're using up-to-date drivers!\n");
-		frontend.reset();
-		return false;
+		return {};
 	}
 
 	RDP::Quirks quirks;
-	quirks.set_native_texture_lod(native_texture_lod);
-	quirks.set_native_resolution_tex_rect(native_tex_rect);
-	frontend->set_quirks(quirks);
+	quirks.set_native_texture_lod(texture_lod);
+	quirks.set_native_resolution_tex_rect(tex_rect);
+	processor->set_quirks(quirks);
+	return processor;
+}
+
+static bool init_frontend()
+{
+	frontend = create_frontend(upscaling, super_sampled_read_back, super_sampled_dither,
+			native_texture_lod, native_tex_rect);
+	return frontend != nullptr;
+}
+
+static void cancel_frontend_rebuild()
+{
+	// Processor construction cannot be interrupted, wait for it and drop the result.
+	if (pending_frontend.valid())
+		pending_frontend.get();
+}
+
+bool init()
+{
+	if (!context || !vulkan)
+		return false;
+
+	unsigned mask = vulkan->get_sync_index_mask(vulkan->handle);
+	unsigned num_frames = 0;
+	unsigned num_sync_frames = 0;
+	for (unsigned i = 0; i < 32; i++)
+	{
+		if (mask & (1u << i))
+		{
+			num_frames = i + 1;
+			num_sync_frames++;
+		}
+	}
+
+	retro_images.resize(num_frames);
+	retro_image_handles.resize(num_frames);
+
+	device.reset(new Device);
+	device->set_context(*context);
+	device->init_frame_contexts(num_sync_frames);
+	log_cb(RETRO_LOG_INFO, "Using %u sync frames for parallel-RDP.\n", num_sync_frames);
+	device->set_queue_lock(
+			[]() { vulkan->lock_queue(vulkan->handle); },
+			[]() { vulkan->unlock_queue(vulkan->handle); });
+
+	if (!init_frontend())
+		return false;
 
 	timeline_value = 0;
 	pending_timeline_value = 0;
@@ -277,10 +340,50 @@ bool init()
 	return true;
 }
 
+bool reinit_frontend()
+{
+	if (!device)
+		return false;
+
+	cancel_frontend_rebuild();
+
+	// Only the command processor bakes in upscaling and super-sampling flags,
+	// so keep the device and drain the old processor before replacing it.
+	if (frontend)
+		frontend->wait_for_timeline(frontend->signal_timeline());
+	frontend.reset();
+
+	timeline_value = 0;
+	pending_timeline_value = 0;
+	return init_frontend();
+}
+
+void begin_frontend_rebuild()
+{
+	// Nothing is rendering, so there is no frame to keep alive while building.
+	if (!device || !frontend)
+	{
+		reinit_frontend();
+		return;
+	}
+
+	// A rebuild that is still in flight was requested with stale settings.
+	cancel_frontend_rebuild();
+
+	// The settings are copied here, xconfig_init may change them while the worker runs.
+	pending_frontend = async(launch::async, [scale = upscaling, ss_read_back = super_sampled_read_back,
+			ss_dither = super_sampled_dither, texture_lod = native_texture_lod, tex_rect = native_tex_rect]() {
+		Util::register_thread_index(REBUILD_THREAD_INDEX);
+		return create_frontend(scale, ss_read_back, ss_dither, texture_lod, tex_rect);
+	});
+}
+
 void deinit()
 {
+	cancel_frontend_rebuild();
 	begin_ts.reset();
 	end_ts.reset();
+	history_image_handles.clear();
 	retro_image_handles.clear();
 	retro_images.clear();
 	frontend.reset();
@@ -288,6 +391,17 @@ void deinit()
 	context.reset();
 }
 
+static void retain_image(unsigned index, const ImageHandle &image)
+{
+	retro_image_handles[index] = image;
+
+	// Shader presets read earlier frames as OriginalHistory, which the filter chain
+	// binds straight from these images, so the ones it still reaches back to stay too.
+	history_image_handles.push_back(image);
+	while (history_image_handles.size() > video_driver_get_history_size() + 1)
+		history_image_handles.pop_front();
+}
+
 static void complete_frame_error()
 {
 	static const char error_tex[] =
@@ -336,7 +450,7 @@ static void complete_frame_error()
 	vulkan->set_image(vulkan->handle, &retro_images[index], 0, nullptr, VK_QUEUE_FAMILY_IGNORED);
 	width = image->get_width();
 	height = image->get_height();
-	retro_image_handles[index] = image;
+	retain_image(index, image);
 
 	device->flush_frame();
 }
@@ -432,7 +546,7 @@ void complete_frame(const VIRegsSample& regs)
 	vulkan->set_image(vulkan->handle, &retro_images[index], 0, nullptr, VK_QUEUE_FAMILY_IGNORED);
 	width = image->get_width();
 	height = image->get_height();
-	retro_image_handles[index] = image;
+	retain_image(index, image);
 
 	end_ts = device->write_calibrated_timestamp();
 	device->register_time_interval("Emulation", begin_ts, end_ts, "frame");
@@ -461,6 +575,7 @@ bool parallel_create_device(struct retro_vulkan_context *frontend_context, VkIns
 	::Vulkan::Context::SystemHandles handles;
 
 	::RDP::context->set_system_handles(handles);
+	::RDP::context->set_num_thread_indices(REBUILD_THREAD_INDEX + 1);
 
 	if (!::RDP::context->init_device_from_instance(
 				instance, gpu, surface, required_device_extensions, num_required_device_extensions,
@@ -527,7 +642,7 @@ extern "C" bool parallel_retro_init_vulkan(void)
 	hw_context_negotiation.get_application_info = parallel_get_application_info;
 	hw_context_negotiation.create_device = parallel_create_device;
 	hw_context_negotiation.destroy_device = NULL;
-	if (retro_set_hw_render_context_negotiation_interface(&hw_context_negotiation))
+	if (!retro_set_hw_render_context_negotiation_interface(&hw_context_negotiation))
 	{
 		if (log_cb)
 			log_cb(RETRO_LOG_ERROR, "mupen64plus: libretro frontend doesn't have context negotiation support.\n");
@@ -27,6 +27,8 @@ struct VIRegsSample
 };
 
 bool init();
+bool reinit_frontend();
+void begin_frontend_rebuild();
 void deinit();
 void begin_frame();
 
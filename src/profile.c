@@ -0,0 +1,279 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "config.h"
+#include "ini.h"
+#include "profile.h"
+
+#define PROFILE_UNSET INT_MIN
+#define PROFILE_ANY_COUNTRY 0x100
+
+#ifdef _WIN32
+#define PROFILE_PATH_SEP "\\"
+#else
+#define PROFILE_PATH_SEP "/"
+#endif
+
+// Only the settings that make sense per game, window and output options
+// stay global.
+static const int profile_keys[] =
+{
+    KEY_UPSCALING,
+    KEY_SSREADBACKS,
+    KEY_SSDITHER,
+    KEY_DOWNSCALING,
+    KEY_SYNCHRONOUS,
+    KEY_DEINTERLACE,
+    KEY_AA,
+    KEY_DIVOT,
+    KEY_GAMMADITHER,
+    KEY_VIBILERP,
+    KEY_VIDITHER,
+    KEY_NATIVETEXTLOD,
+    KEY_NATIVETEXTRECT,
+};
+
+#define PROFILE_NUM_KEYS (sizeof(profile_keys) / sizeof(profile_keys[0]))
+
+struct profile_entry
+{
+    uint32_t crc1;
+    uint32_t crc2;
+    unsigned country; // PROFILE_ANY_COUNTRY when the section has none
+    bool used;
+    int values[PROFILE_NUM_KEYS];
+};
+
+// Open addressed on the CRCs, at most half full.
+static struct profile_entry* profile_table;
+static size_t profile_mask;
+
+static char profile_file[INI_PATH_MAX];
+static time_t profile_mtime;
+static long long profile_size = -1;
+
+static const struct profile_entry* profile_selected;
+
+static size_t profile_hash(uint32_t crc1, uint32_t crc2, unsigned country)
+{
+    uint64_t h = ((uint64_t)crc1 << 32 | crc2) ^ ((uint64_t)country << 24);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
+static struct profile_entry* profile_slot(uint32_t crc1, uint32_t crc2, unsigned country)
+{
+    size_t i = profile_hash(crc1, crc2, country) & profile_mask;
+
+    while (profile_table[i].used
+        && !(profile_table[i].crc1 == crc1 && profile_table[i].crc2 == crc2 && profile_table[i].country == country))
+        i = (i + 1) & profile_mask;
+
+    return profile_table + i;
+}
+
+static bool profile_key_equal(const char* a, const char* b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        char ca = a[i], cb = b[i];
+        if (ca >= 'a' && ca <= 'z') ca -= 'a' - 'A';
+        if (cb >= 'a' && cb <= 'z') cb -= 'a' - 'A';
+        if (ca != cb || !cb)
+            return false;
+    }
+    return b[len] == '\0';
+}
+
+// Parses "[CRC1-CRC2-C:country]", the closing bracket already checked.
+static bool profile_parse_section(const char* line, uint32_t* crc1, uint32_t* crc2, unsigned* country)
+{
+    unsigned c1, c2, cc;
+    int end = 0;
+
+    if (sscanf(line, "[%8x-%8x-C:%2x]%n", &c1, &c2, &cc, &end) == 3 && end)
+        *country = cc;
+    else if (sscanf(line, "[%8x-%8x]%n", &c1, &c2, &end) == 2 && end)
+        *country = PROFILE_ANY_COUNTRY;
+    else
+        return false;
+
+    *crc1 = c1;
+    *crc2 = c2;
+    return true;
+}
+
+static void profile_clear(void)
+{
+    free(profile_table);
+    profile_table = NULL;
+    profile_mask = 0;
+    profile_selected = NULL;
+}
+
+// Builds the index in two passes over the file, one to size the table and
+// one to fill it. Later sections for the same ROM add to the earlier ones.
+static void profile_build(const char* data)
+{
+    size_t sections = 0, size = 1;
+    struct profile_entry* entry = NULL;
+
+    for (const char* p = data; p; p = strchr(p, '\n'), p = p ? p + 1 : NULL)
+    {
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '[')
+            sections++;
+    }
+
+    while (size < sections * 2)
+        size <<= 1;
+
+    profile_table = (struct profile_entry*)calloc(size, sizeof(*profile_table));
+    if (!profile_table)
+        return;
+    profile_mask = size - 1;
+
+    for (const char* p = data; p; p = strchr(p, '\n'), p = p ? p + 1 : NULL)
+    {
+        const char* eq;
+        const char* key_end;
+
+        while (*p == ' ' || *p == '\t')
+            p++;
+
+        if (*p == '[')
+        {
+            uint32_t crc1, crc2;
+            unsigned country;
+
+            entry = NULL;
+            if (!profile_parse_section(p, &crc1, &crc2, &country))
+                continue;
+
+            entry = profile_slot(crc1, crc2, country);
+            if (!entry->used)
+            {
+                entry->used = true;
+                entry->crc1 = crc1;
+                entry->crc2 = crc2;
+                entry->country = country;
+                for (size_t k = 0; k < PROFILE_NUM_KEYS; k++)
+                    entry->values[k] = PROFILE_UNSET;
+            }
+            continue;
+        }
+
+        if (!entry || *p == ';' || *p == '#')
+            continue;
+
+        eq = strpbrk(p, "=\n");
+        if (!eq || *eq != '=')
+            continue;
+
+        key_end = eq;
+        while (key_end > p && (key_end[-1] == ' ' || key_end[-1] == '\t'))
+            key_end--;
+
+        for (size_t k = 0; k < PROFILE_NUM_KEYS; k++)
+        {
+            if (profile_key_equal(p, settings[profile_keys[k]].name, key_end - p))
+            {
+                entry->values[k] = atoi(eq + 1);
+                break;
+            }
+        }
+    }
+}
+
+// Reparses profiles.ini if it changed since it was last read.
+static void profile_load(void)
+{
+    struct stat st;
+    FILE* file;
+    char* data;
+
+    if (!*profile_file)
+        snprintf(profile_file, sizeof(profile_file), "%s" PROFILE_PATH_SEP "profiles.ini", ini_dir);
+
+    if (stat(profile_file, &st) != 0)
+    {
+        profile_clear();
+        profile_size = -1;
+        return;
+    }
+
+    if (profile_table && st.st_mtime == profile_mtime && (long long)st.st_size == profile_size)
+        return;
+
+    profile_clear();
+    profile_mtime = st.st_mtime;
+    profile_size = (long long)st.st_size;
+
+    file = fopen(profile_file, "rb");
+    if (!file)
+        return;
+
+    data = (char*)malloc((size_t)st.st_size + 1);
+    if (data)
+    {
+        size_t len = fread(data, 1, (size_t)st.st_size, file);
+        data[len] = '\0';
+        profile_build(data);
+        free(data);
+    }
+    fclose(file);
+}
+
+bool profile_select(const uint8_t* header)
+{
+    uint32_t crc1 = 0, crc2 = 0;
+    unsigned country;
+    const struct profile_entry* entry;
+
+    profile_selected = NULL;
+    if (!header)
+        return false;
+
+    profile_load();
+    if (!profile_table)
+        return false;
+
+    // The header is in the emulator's word swapped order, as in CaptureScreen.
+    for (int i = 0; i < 4; i++)
+    {
+        crc1 = crc1 << 8 | header[(0x10 + i) ^ 3];
+        crc2 = crc2 << 8 | header[(0x14 + i) ^ 3];
+    }
+    country = header[0x3E ^ 3];
+
+    entry = profile_slot(crc1, crc2, country);
+    if (!entry->used)
+        entry = profile_slot(crc1, crc2, PROFILE_ANY_COUNTRY);
+    if (!entry->used)
+        return false;
+
+    profile_selected = entry;
+    return true;
+}
+
+int profile_value(int key)
+{
+    if (profile_selected)
+    {
+        for (size_t k = 0; k < PROFILE_NUM_KEYS; k++)
+        {
+            if (profile_keys[k] == key && profile_selected->values[k] != PROFILE_UNSET)
+                return profile_selected->values[k];
+        }
+    }
+
+    return settings[key].val;
+}
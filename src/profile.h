@@ -0,0 +1,32 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Per game overrides of settings[], read from profiles.ini next to cfg.ini.
+	// Sections are named after the ROM as in Project64.rdb, CRC1-CRC2-C:country,
+	// the country part may be left out to match every release. A section
+	// with the country is used as is, it does not fall back to one without:
+	//
+	//   [A7D015F8-2289AA43-C:45]
+	//   KEY_UPSCALING=1
+	//   KEY_SYNCHRONOUS=0
+
+	// Picks the profile for the ROM @header as the emulator passes it in
+	// GFX_INFO. The file is only parsed again when it changed since the last
+	// call. Returns whether a profile matched, NULL clears the selection.
+	extern bool profile_select(const uint8_t* header);
+
+	// settings[key].val, unless the selected profile overrides it.
+	extern int profile_value(int key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROFILE_H
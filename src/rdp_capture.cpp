@@ -0,0 +1,233 @@
+#include "rdp_capture.h"
+#include "rdp_dump_write.hpp"
+
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RDP
+{
+// A frame is recorded as a list of these, each followed by its arguments,
+// and handed to the capture thread in one piece when it ends.
+enum CaptureOp : uint32_t
+{
+	CAPTURE_OP_COMMAND,   // command, number of words, words
+	CAPTURE_OP_SYNC_FULL,
+	CAPTURE_OP_DRAM,      // snapshot index
+	CAPTURE_OP_END_FRAME, // VI registers in VIRegister order
+};
+
+// Two snapshots per frame, so this lets the capture thread fall two frames
+// behind before the emulation thread waits for it.
+#define CAPTURE_NUM_SNAPSHOTS 4
+
+static std::unique_ptr<RDPDumpWriter> capture_writer;
+static std::thread capture_thread;
+static std::mutex capture_lock;
+static std::condition_variable capture_cond;
+static std::deque<std::vector<uint32_t>> capture_queue;
+static bool capture_stop;
+
+static std::unique_ptr<uint8_t[]> capture_snapshots[CAPTURE_NUM_SNAPSHOTS];
+static std::vector<uint32_t> capture_free_snapshots;
+
+// Only touched by the emulation thread.
+static bool capture_running;
+static std::vector<uint32_t> capture_ops;
+static const uint8_t *capture_rdram;
+static uint32_t capture_rdram_size;
+static unsigned capture_frames_left;
+static bool capture_dram_pending;
+
+static void capture_write(const std::vector<uint32_t> &ops)
+{
+	size_t i = 0;
+	while (i < ops.size())
+	{
+		switch (ops[i++])
+		{
+		case CAPTURE_OP_COMMAND:
+			capture_writer->emit_command(ops[i], &ops[i + 2], ops[i + 1]);
+			i += 2 + ops[i + 1];
+			break;
+
+		case CAPTURE_OP_SYNC_FULL:
+			capture_writer->signal_complete();
+			break;
+
+		case CAPTURE_OP_DRAM:
+		{
+			uint32_t index = ops[i++];
+			capture_writer->flush_dram(capture_snapshots[index].get(), capture_rdram_size);
+
+			std::lock_guard<std::mutex> hold(capture_lock);
+			capture_free_snapshots.push_back(index);
+			capture_cond.notify_all();
+			break;
+		}
+
+		case CAPTURE_OP_END_FRAME:
+			for (uint32_t reg = 0; reg < uint32_t(VIRegister::Count); reg++)
+				capture_writer->set_vi_register(reg, ops[i + reg]);
+			i += uint32_t(VIRegister::Count);
+			capture_writer->end_frame();
+			break;
+		}
+	}
+}
+
+static void capture_loop()
+{
+	for (;;)
+	{
+		std::vector<uint32_t> ops;
+		{
+			std::unique_lock<std::mutex> hold(capture_lock);
+			capture_cond.wait(hold, [] { return capture_stop || !capture_queue.empty(); });
+			if (capture_queue.empty())
+				return;
+
+			ops = std::move(capture_queue.front());
+			capture_queue.pop_front();
+		}
+		capture_write(ops);
+	}
+}
+
+static void capture_submit()
+{
+	if (capture_ops.empty())
+		return;
+
+	size_t reserve = capture_ops.size();
+	{
+		std::lock_guard<std::mutex> hold(capture_lock);
+		capture_queue.push_back(std::move(capture_ops));
+		capture_cond.notify_all();
+	}
+	capture_ops.clear();
+	capture_ops.reserve(reserve);
+}
+
+// The dump writer only writes the 4 KiB pages that changed since the last
+// snapshot, but it needs the whole of RDRAM to find them.
+static void capture_snapshot_dram()
+{
+	uint32_t index;
+	{
+		std::unique_lock<std::mutex> hold(capture_lock);
+		capture_cond.wait(hold, [] { return !capture_free_snapshots.empty(); });
+		index = capture_free_snapshots.back();
+		capture_free_snapshots.pop_back();
+	}
+
+	memcpy(capture_snapshots[index].get(), capture_rdram, capture_rdram_size);
+	capture_ops.push_back(CAPTURE_OP_DRAM);
+	capture_ops.push_back(index);
+}
+
+bool capture_begin(const char *path, const uint8_t *rdram, uint32_t rdram_size, unsigned frames)
+{
+	capture_end();
+
+	std::unique_ptr<RDPDumpWriter> writer(new RDPDumpWriter);
+	if (!frames || !writer->init(path, rdram_size, 0))
+		return false;
+
+	capture_free_snapshots.clear();
+	for (uint32_t i = 0; i < CAPTURE_NUM_SNAPSHOTS; i++)
+	{
+		capture_snapshots[i].reset(new uint8_t[rdram_size]);
+		capture_free_snapshots.push_back(i);
+	}
+
+	capture_writer = std::move(writer);
+	capture_rdram = rdram;
+	capture_rdram_size = rdram_size;
+	capture_frames_left = frames;
+	capture_dram_pending = true;
+	capture_stop = false;
+	capture_thread = std::thread(capture_loop);
+	capture_running = true;
+	return true;
+}
+
+void capture_end()
+{
+	if (!capture_running)
+		return;
+
+	capture_submit();
+	{
+		std::lock_guard<std::mutex> hold(capture_lock);
+		capture_stop = true;
+		capture_cond.notify_all();
+	}
+	capture_thread.join();
+
+	// Ends the dump and closes the file.
+	capture_writer.reset();
+	for (auto &snapshot : capture_snapshots)
+		snapshot.reset();
+	capture_running = false;
+}
+
+bool capture_active()
+{
+	return capture_running;
+}
+
+void capture_command(uint32_t command, const uint32_t *words, uint32_t num_words)
+{
+	if (!capture_running)
+		return;
+
+	// Whatever the CPU uploaded since the last frame, textures mostly.
+	if (capture_dram_pending)
+	{
+		capture_snapshot_dram();
+		capture_dram_pending = false;
+	}
+
+	capture_ops.push_back(CAPTURE_OP_COMMAND);
+	capture_ops.push_back(command);
+	capture_ops.push_back(num_words);
+	capture_ops.insert(capture_ops.end(), words, words + num_words);
+}
+
+void capture_sync_full()
+{
+	if (capture_running)
+		capture_ops.push_back(CAPTURE_OP_SYNC_FULL);
+}
+
+void capture_frame(const VIRegsSample &regs)
+{
+	if (!capture_running)
+		return;
+
+	// Scanout may show a frame buffer the CPU drew.
+	capture_snapshot_dram();
+
+	const uint32_t vi[] = {
+		regs.VI_STATUS, regs.VI_ORIGIN, regs.VI_WIDTH, regs.VI_INTR,
+		regs.VI_V_CURRENT_LINE, regs.VI_TIMING, regs.VI_V_SYNC, regs.VI_H_SYNC,
+		regs.VI_LEAP, regs.VI_H_START, regs.VI_V_START, regs.VI_V_BURST,
+		regs.VI_X_SCALE, regs.VI_Y_SCALE,
+	};
+	static_assert(sizeof(vi) / sizeof(vi[0]) == uint32_t(VIRegister::Count), "VI registers out of sync");
+
+	capture_ops.push_back(CAPTURE_OP_END_FRAME);
+	capture_ops.insert(capture_ops.end(), vi, vi + uint32_t(VIRegister::Count));
+	capture_submit();
+	capture_dram_pending = true;
+
+	if (--capture_frames_left == 0)
+		capture_end();
+}
+}
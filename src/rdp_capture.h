@@ -0,0 +1,25 @@
+#ifndef RDP_CAPTURE_H
+#define RDP_CAPTURE_H
+
+#include "parallel_imp.h"
+
+// Records what the plugin hands the RDP to an RDPDUMP2 file, the format
+// rdp_dump_write.cpp writes and pj64-parallel-rdp-replay reads. Everything
+// is called from the emulation thread, which only copies into memory. The
+// file is written by a thread of its own.
+namespace RDP
+{
+// Starts writing to @path and stops by itself after @frames frames. RDRAM is
+// snapshot before the first command of every frame and again at its end.
+bool capture_begin(const char *path, const uint8_t *rdram, uint32_t rdram_size, unsigned frames);
+
+// Waits for everything recorded to be written and closes the file.
+void capture_end();
+bool capture_active();
+
+void capture_command(uint32_t command, const uint32_t *words, uint32_t num_words);
+void capture_sync_full();
+void capture_frame(const VIRegsSample &regs);
+}
+
+#endif
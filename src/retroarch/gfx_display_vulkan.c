@@ -100,7 +100,7 @@ static void gfx_display_vk_draw(gfx_display_ctx_draw_t* draw,
 
     /* Bake interleaved VBO. Kinda ugly, we should probably try to move to
      * an interleaved model to begin with ... */
-    if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->vbo,
+    if (!VULKAN_RING_ALLOC_VBO(vk,
         draw->coords->vertices * sizeof(struct vk_vertex), &range))
         return;
 
@@ -41,6 +41,14 @@
 #include <mmintrin.h>
 #endif
 
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define PIXCONV_X86
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#define PIXCONV_X86
+#endif
+
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -63,7 +71,7 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
@@ -330,10 +338,11 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          r                = _mm_mulhi_epi16(r, mul16_r);
          g                = _mm_mulhi_epi16(g, mul16_g);
          b                = _mm_mulhi_epi16(b, mul16_b);
-         res_lo_bg        = _mm_unpacklo_epi8(b, g);
-         res_hi_bg        = _mm_unpackhi_epi8(b, g);
-         res_lo_ra        = _mm_unpacklo_epi8(r, a);
-         res_hi_ra        = _mm_unpackhi_epi8(r, a);
+         /* ABGR, red goes to the low byte. */
+         res_lo_bg        = _mm_unpacklo_epi8(r, g);
+         res_hi_bg        = _mm_unpackhi_epi8(r, g);
+         res_lo_ra        = _mm_unpacklo_epi8(b, a);
+         res_hi_ra        = _mm_unpackhi_epi8(b, a);
          res_lo           = _mm_or_si128(res_lo_bg,
                _mm_slli_si128(res_lo_ra, 2));
          res_hi           = _mm_or_si128(res_hi_bg,
@@ -365,7 +374,7 @@ void conv_argb8888_rgba4444(void *output_, const void *input_,
    uint16_t *output      = (uint16_t*)output_;
 
    for (h = 0; h < height;
-         h++, output += out_stride >> 2, input += in_stride >> 1)
+         h++, output += out_stride >> 1, input += in_stride >> 2)
    {
       for (w = 0; w < width; w++)
       {
@@ -399,7 +408,8 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
    const __m64 mul16_r    = _mm_set1_pi16(0x0440);
    const __m64 mul16_g    = _mm_set1_pi16(0x1100);
    const __m64 mul16_b    = _mm_set1_pi16(0x1100);
-   const __m64 a          = _mm_set1_pi16(0x00ff);
+   const __m64 pix_mask_a = _mm_set1_pi16(0xf);
+   const __m64 mul16_a    = _mm_set1_pi16(0x11);
 
    int max_width            = width - 3;
 #endif
@@ -414,6 +424,7 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
          __m64 res_lo, res_hi;
          __m64 res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
          const __m64 in = *((__m64*)(input + w));
+         __m64          a = _mm_mullo_pi16(_mm_and_si64(in, pix_mask_a), mul16_a);
          __m64          r = _mm_and_si64(_mm_srli_pi16(in, 2), pix_mask_r);
          __m64          g = _mm_and_si64(in, pix_mask_g);
          __m64          b = _mm_and_si64(_mm_slli_pi16(in, 4), pix_mask_b);
@@ -727,7 +738,7 @@ void conv_bgr24_rgb565(void *output_, const void *input_,
    const uint8_t *input = (const uint8_t*)input_;
    uint16_t *output     = (uint16_t*)output_;
    for (h = 0; h < height;
-         h++, output += out_stride, input += in_stride)
+         h++, output += out_stride >> 1, input += in_stride)
    {
       const uint8_t *inp = input;
       for (w = 0; w < width; w++)
@@ -1048,3 +1059,71 @@ void conv_copy(void *output_, const void *input_,
          h++, output += out_stride, input += in_stride)
       memcpy(output, input, copy_len);
 }
+
+#if defined(PIXCONV_X86) && !defined(SCALER_NO_SIMD)
+static int pixconv_cpu_has_avx2(void)
+{
+   unsigned regs[4] = {0};
+   unsigned long long xcr0;
+
+#ifdef _MSC_VER
+   __cpuid((int*)regs, 0);
+   if (regs[0] < 7)
+      return 0;
+   __cpuid((int*)regs, 1);
+#else
+   if (__get_cpuid_max(0, NULL) < 7)
+      return 0;
+   __get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+
+   /* OSXSAVE and AVX, then the OS has to save the YMM registers. */
+   if ((regs[2] & (1u << 27)) == 0 || (regs[2] & (1u << 28)) == 0)
+      return 0;
+
+#ifdef _MSC_VER
+   xcr0 = _xgetbv(0);
+#else
+   {
+      unsigned lo, hi;
+      __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+      xcr0 = ((unsigned long long)hi << 32) | lo;
+   }
+#endif
+   if ((xcr0 & 6) != 6)
+      return 0;
+
+#ifdef _MSC_VER
+   __cpuidex((int*)regs, 7, 0);
+#else
+   __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+   return (regs[1] & (1u << 5)) != 0;
+}
+#endif
+
+int pixconv_has_avx2(void)
+{
+#if defined(PIXCONV_X86) && !defined(SCALER_NO_SIMD)
+   static int has_avx2 = -1;
+
+   if (has_avx2 < 0)
+      has_avx2 = pixconv_cpu_has_avx2();
+
+   return has_avx2;
+#else
+   return 0;
+#endif
+}
+
+pixconv_fn pixconv_select(pixconv_fn conv)
+{
+   if (pixconv_has_avx2())
+   {
+      pixconv_fn avx2 = pixconv_select_avx2(conv);
+      if (avx2)
+         return avx2;
+   }
+
+   return conv;
+}
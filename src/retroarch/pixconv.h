@@ -23,6 +23,10 @@
 #ifndef __LIBRETRO_SDK_SCALER_PIXCONV_H__
 #define __LIBRETRO_SDK_SCALER_PIXCONV_H__
 
+typedef void (*pixconv_fn)(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride);
+
 void conv_0rgb1555_argb8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
@@ -99,4 +103,15 @@ void conv_copy(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
 
+/* Non-zero when both the CPU and the OS support AVX2. */
+int pixconv_has_avx2(void);
+
+/* Returns the fastest kernel doing the same as @conv on this CPU,
+ * or @conv itself. The result writes exactly the same bytes. */
+pixconv_fn pixconv_select(pixconv_fn conv);
+
+/* AVX2 kernel for @conv, NULL if there is none. Only call this
+ * when pixconv_has_avx2() is true, pixconv_select() checks that. */
+pixconv_fn pixconv_select_avx2(pixconv_fn conv);
+
 #endif
@@ -0,0 +1,780 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (pixconv_avx2.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* AVX2 versions of the converters in pixconv.c. This file is the only
+ * one built with AVX2 enabled, nothing in here may run before
+ * pixconv_select() checked the CPU. Every kernel produces the same
+ * bytes as its counterpart, which also finishes the end of each row. */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "pixconv.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+/* Interleaves 16 pixels worth of 8-bit channels, held in the low byte
+ * of each 16-bit element, into two registers of 8 ARGB8888 pixels. */
+static void pack_argb8888_avx2(__m256i r, __m256i g, __m256i b,
+      __m256i *lo, __m256i *hi)
+{
+   const __m256i a = _mm256_set1_epi16(0x00ff);
+   __m256i bg_lo   = _mm256_unpacklo_epi8(b, g);
+   __m256i bg_hi   = _mm256_unpackhi_epi8(b, g);
+   __m256i ra_lo   = _mm256_unpacklo_epi8(r, a);
+   __m256i ra_hi   = _mm256_unpackhi_epi8(r, a);
+   __m256i res_lo  = _mm256_or_si256(bg_lo, _mm256_slli_si256(ra_lo, 2));
+   __m256i res_hi  = _mm256_or_si256(bg_hi, _mm256_slli_si256(ra_hi, 2));
+
+   /* Unpacking works per 128-bit lane, put the pixels back in order. */
+   *lo = _mm256_permute2x128_si256(res_lo, res_hi, 0x20);
+   *hi = _mm256_permute2x128_si256(res_lo, res_hi, 0x31);
+}
+
+static void expand_0rgb1555_avx2(__m256i in, __m256i *lo, __m256i *hi)
+{
+   const __m256i pix_mask_r  = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_gb = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul15_mid   = _mm256_set1_epi16(0x4200);
+   const __m256i mul15_hi    = _mm256_set1_epi16(0x0210);
+   __m256i r = _mm256_and_si256(in, pix_mask_r);
+   __m256i g = _mm256_and_si256(in, pix_mask_gb);
+   __m256i b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_gb);
+
+   r = _mm256_mulhi_epi16(r, mul15_hi);
+   g = _mm256_mulhi_epi16(g, mul15_mid);
+   b = _mm256_mulhi_epi16(b, mul15_mid);
+
+   pack_argb8888_avx2(r, g, b, lo, hi);
+}
+
+static void expand_rgb565_avx2(__m256i in, int swap_rb,
+      __m256i *lo, __m256i *hi)
+{
+   const __m256i pix_mask_r = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_g = _mm256_set1_epi16(0x3f <<  5);
+   const __m256i pix_mask_b = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul16_r    = _mm256_set1_epi16(0x0210);
+   const __m256i mul16_g    = _mm256_set1_epi16(0x2080);
+   const __m256i mul16_b    = _mm256_set1_epi16(0x4200);
+   __m256i r = _mm256_and_si256(_mm256_srli_epi16(in, 1), pix_mask_r);
+   __m256i g = _mm256_and_si256(in, pix_mask_g);
+   __m256i b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_b);
+
+   r = _mm256_mulhi_epi16(r, mul16_r);
+   g = _mm256_mulhi_epi16(g, mul16_g);
+   b = _mm256_mulhi_epi16(b, mul16_b);
+
+   if (swap_rb)
+      pack_argb8888_avx2(b, g, r, lo, hi);
+   else
+      pack_argb8888_avx2(r, g, b, lo, hi);
+}
+
+/* Packs 8 pixels to two times 12 bytes, picked by @shuffle
+ * in each lane, and moves them to the low 24 bytes. */
+static __m256i pack_24bit_avx2(__m256i c, __m256i shuffle)
+{
+   const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+   return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(c, shuffle), compact);
+}
+
+/* 32 pixels, 96 bytes. Stores overlap, the last one is split
+ * so nothing past the 96th byte gets written. */
+static void store_bgr24_avx2(uint8_t *out, __m256i shuffle,
+      __m256i a, __m256i b, __m256i c, __m256i d)
+{
+   a = pack_24bit_avx2(a, shuffle);
+   b = pack_24bit_avx2(b, shuffle);
+   c = pack_24bit_avx2(c, shuffle);
+   d = pack_24bit_avx2(d, shuffle);
+
+   _mm256_storeu_si256((__m256i*)(out +  0), a);
+   _mm256_storeu_si256((__m256i*)(out + 24), b);
+   _mm256_storeu_si256((__m256i*)(out + 48), c);
+   _mm_storeu_si128((__m128i*)(out + 72), _mm256_castsi256_si128(d));
+   _mm_storel_epi64((__m128i*)(out + 88), _mm256_extracti128_si256(d, 1));
+}
+
+/* Two registers of 8 32-bit values, all below 0x10000, to 16 in order. */
+static __m256i pack_u16_avx2(__m256i lo, __m256i hi)
+{
+   return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi),
+         _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static __m256i shuffle_bgr24_from_argb8888(void)
+{
+   return _mm256_setr_epi8(
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+}
+
+static __m256i shuffle_bgr24_from_abgr8888(void)
+{
+   return _mm256_setr_epi8(
+         2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+         2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+}
+
+static void conv_rgb565_0rgb1555_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   int max_width           = width - 15;
+   const __m256i hi_mask   = _mm256_set1_epi16(0x7fe0);
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 1), hi_mask);
+         __m256i lo = _mm256_and_si256(in, lo_mask);
+         _mm256_storeu_si256((__m256i*)(output + w), _mm256_or_si256(hi, lo));
+      }
+
+      conv_rgb565_0rgb1555(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_rgb565_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   int max_width           = width - 15;
+   const __m256i hi_mask   = _mm256_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+   const __m256i glow_mask = _mm256_set1_epi16(1 << 5);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i rg   = _mm256_and_si256(_mm256_slli_epi16(in, 1), hi_mask);
+         __m256i b    = _mm256_and_si256(in, lo_mask);
+         __m256i glow = _mm256_and_si256(_mm256_srli_epi16(in, 4), glow_mask);
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(rg, _mm256_or_si256(b, glow)));
+      }
+
+      conv_0rgb1555_rgb565(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   int max_width         = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         __m256i lo, hi;
+         expand_0rgb1555_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w)), &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      conv_0rgb1555_argb8888(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_rgb565_8888_avx2(uint32_t *output, const uint16_t *input,
+      int width, int height, int out_stride, int in_stride, int swap_rb)
+{
+   int h;
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         __m256i lo, hi;
+         expand_rgb565_avx2(_mm256_loadu_si256((const __m256i*)(input + w)),
+               swap_rb, &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      if (swap_rb)
+         conv_rgb565_abgr8888(output + w, input + w, width - w, 1,
+               out_stride, in_stride);
+      else
+         conv_rgb565_argb8888(output + w, input + w, width - w, 1,
+               out_stride, in_stride);
+   }
+}
+
+static void conv_rgb565_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_rgb565_8888_avx2((uint32_t*)output_, (const uint16_t*)input_,
+         width, height, out_stride, in_stride, 0);
+}
+
+static void conv_rgb565_abgr8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_rgb565_8888_avx2((uint32_t*)output_, (const uint16_t*)input_,
+         width, height, out_stride, in_stride, 1);
+}
+
+static void conv_argb8888_rgba4444_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   int max_width         = width - 15;
+   const __m256i mask_r  = _mm256_set1_epi32(0xf000);
+   const __m256i mask_g  = _mm256_set1_epi32(0x0f00);
+   const __m256i mask_b  = _mm256_set1_epi32(0x00f0);
+   const __m256i mask_a  = _mm256_set1_epi32(0x000f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         __m256i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m256i in = _mm256_loadu_si256(
+                  (const __m256i*)(input + w + i * 8));
+            __m256i r = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_r);
+            __m256i g = _mm256_and_si256(in, mask_g);
+            __m256i b = _mm256_and_si256(_mm256_slli_epi32(in, 4), mask_b);
+            __m256i a = _mm256_and_si256(_mm256_srli_epi32(in, 24), mask_a);
+            res[i]    = _mm256_or_si256(_mm256_or_si256(r, g),
+                  _mm256_or_si256(b, a));
+         }
+
+         _mm256_storeu_si256((__m256i*)(output + w),
+               pack_u16_avx2(res[0], res[1]));
+      }
+
+      conv_argb8888_rgba4444(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_rgba4444_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   int max_width         = width - 7;
+   const __m256i mask_r  = _mm256_set1_epi32(0x0f << 16);
+   const __m256i mask_g  = _mm256_set1_epi32(0x0f <<  8);
+   const __m256i mask_b  = _mm256_set1_epi32(0x0f <<  0);
+   const __m256i mask_a  = _mm256_set1_epi32(0x0f << 24);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 8)
+      {
+         const __m256i in = _mm256_cvtepu16_epi32(
+               _mm_loadu_si128((const __m128i*)(input + w)));
+         __m256i r = _mm256_and_si256(_mm256_slli_epi32(in, 4), mask_r);
+         __m256i g = _mm256_and_si256(in, mask_g);
+         __m256i b = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_b);
+         __m256i a = _mm256_and_si256(_mm256_slli_epi32(in, 24), mask_a);
+         __m256i c = _mm256_or_si256(_mm256_or_si256(r, g),
+               _mm256_or_si256(b, a));
+
+         /* x * 17 per nibble, the high half is still zero. */
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(c, _mm256_slli_epi32(c, 4)));
+      }
+
+      conv_rgba4444_argb8888(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_rgba4444_rgb565_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   int max_width         = width - 15;
+   const __m256i mask_r  = _mm256_set1_epi16((int16_t)0xf000);
+   const __m256i mask_g  = _mm256_set1_epi16(0x0780);
+   const __m256i mask_b  = _mm256_set1_epi16(0x001e);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i r = _mm256_and_si256(in, mask_r);
+         __m256i g = _mm256_and_si256(_mm256_srli_epi16(in, 1), mask_g);
+         __m256i b = _mm256_and_si256(_mm256_srli_epi16(in, 3), mask_b);
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(r, _mm256_or_si256(g, b)));
+      }
+
+      conv_rgba4444_rgb565(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_0rgb1555_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   int max_width         = width - 31;
+   const __m256i shuffle = shuffle_bgr24_from_argb8888();
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 32)
+      {
+         __m256i a, b, c, d;
+         expand_0rgb1555_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w +  0)), &a, &b);
+         expand_0rgb1555_avx2(
+               _mm256_loadu_si256((const __m256i*)(input + w + 16)), &c, &d);
+         store_bgr24_avx2(output + w * 3, shuffle, a, b, c, d);
+      }
+
+      conv_0rgb1555_bgr24(output + w * 3, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_rgb565_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   int max_width         = width - 31;
+   const __m256i shuffle = shuffle_bgr24_from_argb8888();
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      int w = 0;
+      for (; w < max_width; w += 32)
+      {
+         __m256i a, b, c, d;
+         expand_rgb565_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w +  0)), 0, &a, &b);
+         expand_rgb565_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w + 16)), 0, &c, &d);
+         store_bgr24_avx2(output + w * 3, shuffle, a, b, c, d);
+      }
+
+      conv_rgb565_bgr24(output + w * 3, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+/* 8 pixels of BGR24 to ARGB8888. Reads 4 bytes past the
+ * 24 it converts, callers leave at least 2 pixels behind. */
+static __m256i load_bgr24_avx2(const uint8_t *in)
+{
+   const __m256i shuffle = _mm256_setr_epi8(
+         0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+         0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+   const __m256i alpha   = _mm256_set1_epi32((int)0xff000000);
+   __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_loadu_si128((const __m128i*)(in + 0))),
+         _mm_loadu_si128((const __m128i*)(in + 12)), 1);
+
+   return _mm256_or_si256(_mm256_shuffle_epi8(c, shuffle), alpha);
+}
+
+static void conv_bgr24_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+   int max_width        = width - 9;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride)
+   {
+      int w = 0;
+      for (; w < max_width; w += 8)
+         _mm256_storeu_si256((__m256i*)(output + w),
+               load_bgr24_avx2(input + w * 3));
+
+      conv_bgr24_argb8888(output + w, input + w * 3, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_bgr24_rgb565_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint16_t *output     = (uint16_t*)output_;
+   int max_width        = width - 17;
+   const __m256i mask_r = _mm256_set1_epi32(0xf800);
+   const __m256i mask_g = _mm256_set1_epi32(0x07e0);
+   const __m256i mask_b = _mm256_set1_epi32(0x001f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         __m256i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m256i c = load_bgr24_avx2(input + (w + i * 8) * 3);
+            __m256i r = _mm256_and_si256(_mm256_srli_epi32(c, 8), mask_r);
+            __m256i g = _mm256_and_si256(_mm256_srli_epi32(c, 5), mask_g);
+            __m256i b = _mm256_and_si256(_mm256_srli_epi32(c, 3), mask_b);
+            res[i]    = _mm256_or_si256(r, _mm256_or_si256(g, b));
+         }
+
+         _mm256_storeu_si256((__m256i*)(output + w),
+               pack_u16_avx2(res[0], res[1]));
+      }
+
+      conv_bgr24_rgb565(output + w, input + w * 3, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_argb8888_0rgb1555_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   int max_width         = width - 15;
+   const __m256i mask_r  = _mm256_set1_epi32(0x1f << 10);
+   const __m256i mask_g  = _mm256_set1_epi32(0x1f <<  5);
+   const __m256i mask_b  = _mm256_set1_epi32(0x1f <<  0);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      int w = 0;
+      for (; w < max_width; w += 16)
+      {
+         __m256i res[2];
+         int i;
+
+         for (i = 0; i < 2; i++)
+         {
+            const __m256i in = _mm256_loadu_si256(
+                  (const __m256i*)(input + w + i * 8));
+            __m256i r = _mm256_and_si256(_mm256_srli_epi32(in, 9), mask_r);
+            __m256i g = _mm256_and_si256(_mm256_srli_epi32(in, 6), mask_g);
+            __m256i b = _mm256_and_si256(_mm256_srli_epi32(in, 3), mask_b);
+            res[i]    = _mm256_or_si256(r, _mm256_or_si256(g, b));
+         }
+
+         _mm256_storeu_si256((__m256i*)(output + w),
+               pack_u16_avx2(res[0], res[1]));
+      }
+
+      conv_argb8888_0rgb1555(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_8888_bgr24_avx2(uint8_t *output, const uint32_t *input,
+      int width, int height, int out_stride, int in_stride,
+      __m256i shuffle, pixconv_fn finish)
+{
+   int h;
+   int max_width = width - 31;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      int w = 0;
+      for (; w < max_width; w += 32)
+         store_bgr24_avx2(output + w * 3, shuffle,
+               _mm256_loadu_si256((const __m256i*)(input + w +  0)),
+               _mm256_loadu_si256((const __m256i*)(input + w +  8)),
+               _mm256_loadu_si256((const __m256i*)(input + w + 16)),
+               _mm256_loadu_si256((const __m256i*)(input + w + 24)));
+
+      finish(output + w * 3, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+static void conv_argb8888_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_8888_bgr24_avx2((uint8_t*)output_, (const uint32_t*)input_,
+         width, height, out_stride, in_stride,
+         shuffle_bgr24_from_argb8888(), conv_argb8888_bgr24);
+}
+
+static void conv_abgr8888_bgr24_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   conv_8888_bgr24_avx2((uint8_t*)output_, (const uint32_t*)input_,
+         width, height, out_stride, in_stride,
+         shuffle_bgr24_from_abgr8888(), conv_abgr8888_bgr24);
+}
+
+static void conv_argb8888_abgr8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   int max_width         = width - 7;
+   const __m256i shuffle = _mm256_setr_epi8(
+         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      int w = 0;
+      for (; w < max_width; w += 8)
+         _mm256_storeu_si256((__m256i*)(output + w), _mm256_shuffle_epi8(
+                  _mm256_loadu_si256((const __m256i*)(input + w)), shuffle));
+
+      conv_argb8888_abgr8888(output + w, input + w, width - w, 1,
+            out_stride, in_stride);
+   }
+}
+
+#define YUV_SHIFT 6
+#define YUV_OFFSET (1 << (YUV_SHIFT - 1))
+#define YUV_MAT_Y (1 << 6)
+#define YUV_MAT_U_G (-22)
+#define YUV_MAT_U_B (113)
+#define YUV_MAT_V_R (90)
+#define YUV_MAT_V_G (-46)
+
+static void conv_yuyv_argb8888_avx2(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input        = (const uint8_t*)input_;
+   uint32_t *output            = (uint32_t*)output_;
+   const __m256i mask_y        = _mm256_set1_epi16(0xffu);
+   const __m256i mask_u        = _mm256_set1_epi32(0xffu << 8);
+   const __m256i mask_v        = _mm256_set1_epi32(0xffu << 24);
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset  = _mm256_set1_epi16(YUV_OFFSET);
+   const __m256i yuv_mul       = _mm256_set1_epi16(YUV_MAT_Y);
+   const __m256i u_g_mul       = _mm256_set1_epi16(YUV_MAT_U_G);
+   const __m256i u_b_mul       = _mm256_set1_epi16(YUV_MAT_U_B);
+   const __m256i v_r_mul       = _mm256_set1_epi16(YUV_MAT_V_R);
+   const __m256i v_g_mul       = _mm256_set1_epi16(YUV_MAT_V_G);
+   const __m256i a             = _mm256_set1_epi16(-1);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t      *dst = output;
+      int              w = 0;
+
+      /* The SSE2 loop per 128-bit lane. Lane 0 converts pixels 0-7 and
+       * 16-23, lane 1 pixels 8-15 and 24-31. None of the sums can
+       * saturate, so this matches the scalar code exactly. */
+      for (; w + 32 <= width; w += 32, src += 64, dst += 32)
+      {
+         __m256i u, v, u0_g, u1_g, u0_b, u1_b, v0_r, v1_r, v0_g, v1_g,
+                 r0, g0, b0, r1, g1, b1;
+         __m256i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
+         __m256i res0, res1, res2, res3;
+         __m256i yuv0 = _mm256_loadu_si256((const __m256i*)(src +  0));
+         __m256i yuv1 = _mm256_loadu_si256((const __m256i*)(src + 32));
+
+         __m256i _y0 = _mm256_and_si256(yuv0, mask_y);
+         __m256i u0  = _mm256_and_si256(yuv0, mask_u);
+         __m256i v0  = _mm256_and_si256(yuv0, mask_v);
+         __m256i _y1 = _mm256_and_si256(yuv1, mask_y);
+         __m256i u1  = _mm256_and_si256(yuv1, mask_u);
+         __m256i v1  = _mm256_and_si256(yuv1, mask_v);
+
+         u0 = _mm256_srli_si256(u0, 1);
+         v0 = _mm256_srli_si256(v0, 3);
+         u1 = _mm256_srli_si256(u1, 1);
+         v1 = _mm256_srli_si256(v1, 3);
+         u  = _mm256_packs_epi32(u0, u1);
+         v  = _mm256_packs_epi32(v0, v1);
+
+         u  = _mm256_sub_epi16(u, chroma_offset);
+         v  = _mm256_sub_epi16(v, chroma_offset);
+
+         u0 = _mm256_unpacklo_epi16(u, u);
+         u1 = _mm256_unpackhi_epi16(u, u);
+         v0 = _mm256_unpacklo_epi16(v, v);
+         v1 = _mm256_unpackhi_epi16(v, v);
+
+         _y0  = _mm256_mullo_epi16(_y0, yuv_mul);
+         _y1  = _mm256_mullo_epi16(_y1, yuv_mul);
+         u0_g = _mm256_mullo_epi16(u0, u_g_mul);
+         u1_g = _mm256_mullo_epi16(u1, u_g_mul);
+         u0_b = _mm256_mullo_epi16(u0, u_b_mul);
+         u1_b = _mm256_mullo_epi16(u1, u_b_mul);
+         v0_r = _mm256_mullo_epi16(v0, v_r_mul);
+         v1_r = _mm256_mullo_epi16(v1, v_r_mul);
+         v0_g = _mm256_mullo_epi16(v0, v_g_mul);
+         v1_g = _mm256_mullo_epi16(v1, v_g_mul);
+
+         r0 = _mm256_srai_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y0, v0_r), round_offset), YUV_SHIFT);
+         g0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y0, v0_g), u0_g), round_offset), YUV_SHIFT);
+         b0 = _mm256_srai_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y0, u0_b), round_offset), YUV_SHIFT);
+
+         r1 = _mm256_srai_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y1, v1_r), round_offset), YUV_SHIFT);
+         g1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y1, v1_g), u1_g), round_offset), YUV_SHIFT);
+         b1 = _mm256_srai_epi16(_mm256_adds_epi16(
+                  _mm256_adds_epi16(_y1, u1_b), round_offset), YUV_SHIFT);
+
+         r0 = _mm256_packus_epi16(r0, r1);
+         g0 = _mm256_packus_epi16(g0, g1);
+         b0 = _mm256_packus_epi16(b0, b1);
+
+         res_lo_bg = _mm256_unpacklo_epi8(b0, g0);
+         res_hi_bg = _mm256_unpackhi_epi8(b0, g0);
+         res_lo_ra = _mm256_unpacklo_epi8(r0, a);
+         res_hi_ra = _mm256_unpackhi_epi8(r0, a);
+         res0      = _mm256_unpacklo_epi16(res_lo_bg, res_lo_ra);
+         res1      = _mm256_unpackhi_epi16(res_lo_bg, res_lo_ra);
+         res2      = _mm256_unpacklo_epi16(res_hi_bg, res_hi_ra);
+         res3      = _mm256_unpackhi_epi16(res_hi_bg, res_hi_ra);
+
+         _mm256_storeu_si256((__m256i*)(dst +  0),
+               _mm256_permute2x128_si256(res0, res1, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst +  8),
+               _mm256_permute2x128_si256(res0, res1, 0x31));
+         _mm256_storeu_si256((__m256i*)(dst + 16),
+               _mm256_permute2x128_si256(res2, res3, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst + 24),
+               _mm256_permute2x128_si256(res2, res3, 0x31));
+      }
+
+      conv_yuyv_argb8888(dst, src, width - w, 1, out_stride, in_stride);
+   }
+}
+
+static const struct
+{
+   pixconv_fn conv;
+   pixconv_fn avx2;
+} pixconv_avx2_kernels[] = {
+   { conv_0rgb1555_argb8888, conv_0rgb1555_argb8888_avx2 },
+   { conv_0rgb1555_rgb565,   conv_0rgb1555_rgb565_avx2   },
+   { conv_rgb565_0rgb1555,   conv_rgb565_0rgb1555_avx2   },
+   { conv_rgb565_abgr8888,   conv_rgb565_abgr8888_avx2   },
+   { conv_rgb565_argb8888,   conv_rgb565_argb8888_avx2   },
+   { conv_rgba4444_argb8888, conv_rgba4444_argb8888_avx2 },
+   { conv_rgba4444_rgb565,   conv_rgba4444_rgb565_avx2   },
+   { conv_bgr24_argb8888,    conv_bgr24_argb8888_avx2    },
+   { conv_bgr24_rgb565,      conv_bgr24_rgb565_avx2      },
+   { conv_argb8888_0rgb1555, conv_argb8888_0rgb1555_avx2 },
+   { conv_argb8888_rgba4444, conv_argb8888_rgba4444_avx2 },
+   { conv_argb8888_bgr24,    conv_argb8888_bgr24_avx2    },
+   { conv_abgr8888_bgr24,    conv_abgr8888_bgr24_avx2    },
+   { conv_argb8888_abgr8888, conv_argb8888_abgr8888_avx2 },
+   { conv_0rgb1555_bgr24,    conv_0rgb1555_bgr24_avx2    },
+   { conv_rgb565_bgr24,      conv_rgb565_bgr24_avx2      },
+   { conv_yuyv_argb8888,     conv_yuyv_argb8888_avx2     },
+};
+#endif
+
+pixconv_fn pixconv_select_avx2(pixconv_fn conv)
+{
+#if defined(__AVX2__)
+   size_t i;
+
+   for (i = 0; i < sizeof(pixconv_avx2_kernels) / sizeof(pixconv_avx2_kernels[0]); i++)
+   {
+      if (pixconv_avx2_kernels[i].conv == conv)
+         return pixconv_avx2_kernels[i].avx2;
+   }
+#endif
+
+   return NULL;
+}
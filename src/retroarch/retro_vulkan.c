@@ -24,6 +24,7 @@
 #include "driver.h"
 #include "video_driver.h"
 #include "shader_vulkan.h"
+#include "shader_cache.h"
 #include "matrix_4x4.h"
 
 static void vulkan_set_viewport(void* data, unsigned viewport_width,
@@ -609,28 +610,16 @@ static void vulkan_deinit_samplers(vk_t* vk)
 
 static void vulkan_init_buffers(vk_t* vk)
 {
-    unsigned i;
-    for (i = 0; i < vk->num_swapchain_images; i++)
-    {
-        vk->swapchain[i].vbo = vulkan_buffer_chain_init(
-            VULKAN_BUFFER_BLOCK_SIZE, 16, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-        vk->swapchain[i].ubo = vulkan_buffer_chain_init(
-            VULKAN_BUFFER_BLOCK_SIZE,
-            vk->context->gpu_properties.limits.minUniformBufferOffsetAlignment,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    }
+    /* VBOs and UBOs both want host-visible coherent memory,
+     * so they share one ring. */
+    vulkan_buffer_ring_init(&vk->ring,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+        | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 }
 
 static void vulkan_deinit_buffers(vk_t* vk)
 {
-    unsigned i;
-    for (i = 0; i < vk->num_swapchain_images; i++)
-    {
-        vulkan_buffer_chain_free(
-            vk->context->device, &vk->swapchain[i].vbo);
-        vulkan_buffer_chain_free(
-            vk->context->device, &vk->swapchain[i].ubo);
-    }
+    vulkan_buffer_ring_free(vk->context->device, &vk->ring);
 }
 
 static void vulkan_init_descriptor_pool(vk_t* vk)
@@ -647,6 +636,9 @@ static void vulkan_init_descriptor_pool(vk_t* vk)
             vulkan_create_descriptor_manager(
                 vk->context->device,
                 pool_sizes, 2, vk->pipelines.set_layout);
+        vulkan_create_descriptor_cache(vk->context,
+            &vk->swapchain[i].descriptor_cache,
+            pool_sizes, 2, vk->pipelines.set_layout);
     }
 }
 
@@ -654,9 +646,14 @@ static void vulkan_deinit_descriptor_pool(vk_t* vk)
 {
     unsigned i;
     for (i = 0; i < vk->num_swapchain_images; i++)
+    {
         vulkan_destroy_descriptor_manager(
             vk->context->device,
             &vk->swapchain[i].descriptor_manager);
+        vulkan_destroy_descriptor_cache(
+            vk->context->device,
+            &vk->swapchain[i].descriptor_cache);
+    }
 }
 
 static void vulkan_init_textures(vk_t* vk)
@@ -840,41 +837,9 @@ static void vulkan_set_hdr10(vk_t* vk, bool hdr10)
 }
 #endif /* VULKAN_HDR_SWAPCHAIN */
 
-static bool vulkan_init_default_filter_chain(vk_t* vk)
-{
-    struct vulkan_filter_chain_create_info info;
-
-    if (!vk->context)
-        return false;
-
-    info.device = vk->context->device;
-    info.gpu = vk->context->gpu;
-    info.memory_properties = &vk->context->memory_properties;
-    info.pipeline_cache = vk->pipelines.cache;
-    info.queue = vk->context->queue;
-    info.command_pool = vk->swapchain[vk->context->current_frame_index].cmd_pool;
-    info.num_passes = 0;
-    info.original_format = vk->tex_fmt;
-    info.max_input_size.width = vk->tex_w;
-    info.max_input_size.height = vk->tex_h;
-    info.swapchain.viewport = vk->vk_vp;
-    info.swapchain.format = vk->context->swapchain_format;
-    info.swapchain.render_pass = vk->render_pass;
-    info.swapchain.num_indices = vk->context->num_swapchain_images;
-
-    vk->filter_chain = vulkan_filter_chain_create_default(
-        &info,
-        vk->video.smooth
-        ? GLSLANG_FILTER_CHAIN_LINEAR
-        : GLSLANG_FILTER_CHAIN_NEAREST);
-
-    if (!vk->filter_chain)
-    {
-        RARCH_ERR("Failed to create filter chain.\n");
-        return false;
-    }
-
 #ifdef VULKAN_HDR_SWAPCHAIN
+static void vulkan_init_hdr_filter_chain(vk_t* vk)
+{
     if (vk->context->hdr_enable)
     {
         struct video_shader* shader_preset = vulkan_filter_chain_get_preset(vk->filter_chain);
@@ -899,6 +864,81 @@ static bool vulkan_init_default_filter_chain(vk_t* vk)
             vulkan_set_hdr10(vk, true);
         }
     }
+}
+#endif /* VULKAN_HDR_SWAPCHAIN */
+
+static void vulkan_filter_chain_fill_create_info(vk_t* vk,
+    struct vulkan_filter_chain_create_info* info)
+{
+    info->device = vk->context->device;
+    info->gpu = vk->context->gpu;
+    info->memory_properties = &vk->context->memory_properties;
+    info->pipeline_cache = vk->pipelines.cache;
+    info->queue = vk->context->queue;
+    info->queue_lock = vk->context->queue_lock;
+    info->command_pool = vk->swapchain[vk->context->current_frame_index].cmd_pool;
+    info->num_passes = 0;
+    info->original_format = vk->tex_fmt;
+    info->max_input_size.width = vk->tex_w;
+    info->max_input_size.height = vk->tex_h;
+    info->swapchain.viewport = vk->vk_vp;
+    info->swapchain.format = vk->context->swapchain_format;
+    info->swapchain.render_pass = vk->render_pass;
+    info->swapchain.num_indices = vk->context->num_swapchain_images;
+    info->pass_fusion = config_get_ptr()->bools.video_shader_pass_fusion;
+}
+
+static bool vulkan_init_filter_chain_preset(vk_t* vk, const char* shader_path)
+{
+    struct vulkan_filter_chain_create_info info;
+
+    if (!vk->context)
+        return false;
+
+    vulkan_filter_chain_fill_create_info(vk, &info);
+
+    vk->filter_chain = vulkan_filter_chain_create_from_preset(
+        &info, shader_path,
+        vk->video.smooth
+        ? GLSLANG_FILTER_CHAIN_LINEAR
+        : GLSLANG_FILTER_CHAIN_NEAREST);
+
+    if (!vk->filter_chain)
+    {
+        RARCH_LOG("[Vulkan]: Failed to create preset: \"%s\".\n", shader_path);
+        return false;
+    }
+
+#ifdef VULKAN_HDR_SWAPCHAIN
+    vulkan_init_hdr_filter_chain(vk);
+#endif /* VULKAN_HDR_SWAPCHAIN */
+
+    return true;
+}
+
+static bool vulkan_init_default_filter_chain(vk_t* vk)
+{
+    struct vulkan_filter_chain_create_info info;
+
+    if (!vk->context)
+        return false;
+
+    vulkan_filter_chain_fill_create_info(vk, &info);
+
+    vk->filter_chain = vulkan_filter_chain_create_default(
+        &info,
+        vk->video.smooth
+        ? GLSLANG_FILTER_CHAIN_LINEAR
+        : GLSLANG_FILTER_CHAIN_NEAREST);
+
+    if (!vk->filter_chain)
+    {
+        RARCH_ERR("Failed to create filter chain.\n");
+        return false;
+    }
+
+#ifdef VULKAN_HDR_SWAPCHAIN
+    vulkan_init_hdr_filter_chain(vk);
 #endif /* VULKAN_HDR_SWAPCHAIN */
 
     return true;
@@ -906,7 +946,21 @@ static bool vulkan_init_default_filter_chain(vk_t* vk)
 
 static bool vulkan_init_filter_chain(vk_t* vk)
 {
-    return vulkan_init_default_filter_chain(vk);
+    const char* shader_path = config_get_ptr()->paths.path_shader;
+
+    if (!*shader_path)
+    {
+        RARCH_LOG("[Vulkan]: Loading stock shader.\n");
+        return vulkan_init_default_filter_chain(vk);
+    }
+
+    if (!vulkan_init_filter_chain_preset(vk, shader_path))
+    {
+        RARCH_WARN("Failed to load shader preset \"%s\". Falling back to stock.\n", shader_path);
+        return vulkan_init_default_filter_chain(vk);
+    }
+
+    return true;
 }
 
 static void vulkan_init_resources(vk_t* vk)
@@ -924,6 +978,89 @@ static void vulkan_init_resources(vk_t* vk)
     vulkan_init_command_buffers(vk);
 }
 
+static void vulkan_init_timing(vk_t* vk)
+{
+    VkQueryPoolCreateInfo info = {
+       VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+
+    vk->timing.pool = VK_NULL_HANDLE;
+
+    /* Two timestamps per frame, bracketing our own command buffer. */
+    if (!vk->context->gpu_properties.limits.timestampComputeAndGraphics)
+    {
+        RARCH_LOG("[Vulkan]: GPU timestamps are not supported, frame timing disabled.\n");
+        return;
+    }
+
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = 2 * VULKAN_MAX_SWAPCHAIN_IMAGES;
+
+    if (vkCreateQueryPool(vk->context->device,
+        &info, NULL, &vk->timing.pool) != VK_SUCCESS)
+        vk->timing.pool = VK_NULL_HANDLE;
+
+    vk->timing.period = vk->context->gpu_properties.limits.timestampPeriod;
+}
+
+/* Pipeline cache blobs are only valid for the exact device and driver. */
+static uint64_t vulkan_pipeline_cache_key(vk_t* vk)
+{
+    const VkPhysicalDeviceProperties* props = &vk->context->gpu_properties;
+    uint64_t key = SHADER_CACHE_HASH_SEED;
+
+    key = shader_cache_hash(&props->vendorID, sizeof(props->vendorID), key);
+    key = shader_cache_hash(&props->deviceID, sizeof(props->deviceID), key);
+    key = shader_cache_hash(&props->driverVersion, sizeof(props->driverVersion), key);
+    return shader_cache_hash(props->pipelineCacheUUID, VK_UUID_SIZE, key);
+}
+
+static void vulkan_init_pipeline_cache(vk_t* vk)
+{
+    void* data = NULL;
+    size_t size = 0;
+    VkPipelineCacheCreateInfo cache = {
+       VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+
+    if (shader_cache_load("pipeline", vulkan_pipeline_cache_key(vk), &data, &size))
+    {
+        cache.initialDataSize = size;
+        cache.pInitialData = data;
+    }
+
+    if (vkCreatePipelineCache(vk->context->device,
+        &cache, NULL, &vk->pipelines.cache) != VK_SUCCESS && data)
+    {
+        /* Driver rejected the blob, start over empty. */
+        cache.initialDataSize = 0;
+        cache.pInitialData = NULL;
+        vkCreatePipelineCache(vk->context->device,
+            &cache, NULL, &vk->pipelines.cache);
+    }
+    else if (data)
+        RARCH_LOG("[Vulkan]: Loaded %u byte pipeline cache.\n", (unsigned)size);
+
+    free(data);
+}
+
+static void vulkan_save_pipeline_cache(vk_t* vk)
+{
+    void* data = NULL;
+    size_t size = 0;
+
+    if (vkGetPipelineCacheData(vk->context->device,
+        vk->pipelines.cache, &size, NULL) != VK_SUCCESS || !size)
+        return;
+
+    if (!(data = malloc(size)))
+        return;
+
+    if (vkGetPipelineCacheData(vk->context->device,
+        vk->pipelines.cache, &size, data) == VK_SUCCESS)
+        shader_cache_store("pipeline", vulkan_pipeline_cache_key(vk), data, size);
+
+    free(data);
+}
+
 static void vulkan_init_static_resources(vk_t* vk)
 {
     unsigned i;
@@ -931,17 +1068,12 @@ static void vulkan_init_static_resources(vk_t* vk)
     VkCommandPoolCreateInfo pool_info = {
        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 
-    /* Create the pipeline cache. */
-    VkPipelineCacheCreateInfo cache = {
-       VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
-
     pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (!vk->context)
         return;
 
-    vkCreatePipelineCache(vk->context->device,
-        &cache, NULL, &vk->pipelines.cache);
+    vulkan_init_pipeline_cache(vk);
 
     pool_info.queueFamilyIndex = vk->context->graphics_queue_index;
 
@@ -954,11 +1086,14 @@ static void vulkan_init_static_resources(vk_t* vk)
     vk->display.blank_texture = vulkan_create_texture(vk, NULL,
         4, 4, VK_FORMAT_B8G8R8A8_UNORM,
         blank, NULL, VULKAN_TEXTURE_STATIC);
+
+    vulkan_init_timing(vk);
 }
 
 static void vulkan_deinit_static_resources(vk_t* vk)
 {
     unsigned i;
+    vulkan_save_pipeline_cache(vk);
     vkDestroyPipelineCache(vk->context->device,
         vk->pipelines.cache, NULL);
     vulkan_destroy_texture(
@@ -967,6 +1102,9 @@ static void vulkan_deinit_static_resources(vk_t* vk)
 
     vkDestroyCommandPool(vk->context->device,
         vk->staging_pool, NULL);
+    if (vk->timing.pool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(vk->context->device,
+            vk->timing.pool, NULL);
     free(vk->hw.cmd);
     free(vk->hw.wait_dst_stages);
     free(vk->hw.semaphores);
@@ -1413,9 +1551,25 @@ static bool vulkan_set_shader(void* data,
     if (!vk)
         return false;
 
-    // no shader bs is allowed here
-    RARCH_ERR("[Vulkan]: Failed to create filter chain: \"%s\". Falling back to stock.\n", path);
-    vulkan_init_default_filter_chain(vk);
+    if (vk->filter_chain)
+    {
+        slock_lock(vk->context->queue_lock);
+        vkQueueWaitIdle(vk->context->queue);
+        slock_unlock(vk->context->queue_lock);
+        vulkan_filter_chain_free((vulkan_filter_chain_t*)vk->filter_chain);
+        vk->filter_chain = NULL;
+    }
+
+    if (!path || !*path)
+        return vulkan_init_default_filter_chain(vk);
+
+    if (!vulkan_init_filter_chain_preset(vk, path))
+    {
+        RARCH_WARN("Failed to load shader preset \"%s\". Falling back to stock.\n", path);
+        vulkan_init_default_filter_chain(vk);
+        return false;
+    }
+
     return true;
 }
 
@@ -1469,6 +1623,7 @@ static void vulkan_set_video_mode(void* data,
     bool fullscreen)
 {
     vk_t* vk = (vk_t*)data;
+    vk->fullscreen = fullscreen;
     if (vk->ctx_driver->set_video_mode)
         vk->ctx_driver->set_video_mode(vk->ctx_data,
             width, height, fullscreen);
@@ -1625,6 +1780,238 @@ typedef struct gfx_ctx_mode
     bool fullscreen;
 } gfx_ctx_mode_t;
 
+/* Average GPU time over this many frames before logging it. */
+#define VULKAN_TIMING_REPORT_FRAMES 600
+
+static void vulkan_begin_timing(vk_t* vk, unsigned frame_index)
+{
+    uint64_t ts[2];
+
+    if (vk->timing.pool == VK_NULL_HANDLE)
+        return;
+
+    /* The fence for this frame index has been waited on,
+     * so the previous results should be available by now. */
+    if (vk->timing.pending[frame_index] &&
+        vkGetQueryPoolResults(vk->context->device, vk->timing.pool,
+            2 * frame_index, 2, sizeof(ts), ts, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS &&
+        ts[1] >= ts[0])
+    {
+        unsigned path = vk->timing.direct[frame_index] ? 1 : 0;
+
+        vk->timing.total_ns[path] +=
+            (uint64_t)((double)(ts[1] - ts[0]) * vk->timing.period);
+        vk->timing.frames[path]++;
+
+        if (vk->timing.frames[0] + vk->timing.frames[1]
+            >= VULKAN_TIMING_REPORT_FRAMES)
+        {
+            RARCH_LOG("[Vulkan]: GPU frame time: filter chain %.3f ms (%u frames), direct blit %.3f ms (%u frames).\n",
+                vk->timing.frames[0]
+                ? vk->timing.total_ns[0] / (vk->timing.frames[0] * 1e6) : 0.0,
+                vk->timing.frames[0],
+                vk->timing.frames[1]
+                ? vk->timing.total_ns[1] / (vk->timing.frames[1] * 1e6) : 0.0,
+                vk->timing.frames[1]);
+
+            vk->timing.total_ns[0] = 0;
+            vk->timing.total_ns[1] = 0;
+            vk->timing.frames[0] = 0;
+            vk->timing.frames[1] = 0;
+        }
+    }
+
+    vk->timing.pending[frame_index] = false;
+
+    vkCmdResetQueryPool(vk->cmd, vk->timing.pool, 2 * frame_index, 2);
+    vkCmdWriteTimestamp(vk->cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        vk->timing.pool, 2 * frame_index);
+}
+
+static void vulkan_end_timing(vk_t* vk, unsigned frame_index, bool direct)
+{
+    if (vk->timing.pool == VK_NULL_HANDLE)
+        return;
+
+    vkCmdWriteTimestamp(vk->cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        vk->timing.pool, 2 * frame_index + 1);
+
+    vk->timing.pending[frame_index] = true;
+    vk->timing.direct[frame_index] = direct;
+}
+
+static bool vulkan_format_supports(vk_t* vk, VkFormat format,
+    VkFormatFeatureFlags features)
+{
+    VkFormatProperties props;
+
+    vkGetPhysicalDeviceFormatProperties(vk->context->gpu, format, &props);
+    return (props.optimalTilingFeatures & features) == features;
+}
+
+/* The stock filter chain only samples the input onto the viewport.
+ * With no rotation and an integer scale factor, a transfer does the
+ * same job without descriptor updates, UBO writes or a render pass. */
+static bool vulkan_can_direct_blit(vk_t* vk,
+    const struct vulkan_filter_chain_texture* input)
+{
+    if (!vulkan_filter_chain_is_passthrough(
+        (vulkan_filter_chain_t*)vk->filter_chain))
+        return false;
+
+#ifdef VULKAN_HDR_SWAPCHAIN
+    if (vk->context->hdr_enable)
+        return false;
+#endif /* VULKAN_HDR_SWAPCHAIN */
+
+    if (vk->rotation % 360 != 0)
+        return false;
+
+    if (input->image == VK_NULL_HANDLE
+        || input->format == VK_FORMAT_UNDEFINED
+        || !input->width || !input->height)
+        return false;
+
+    if (vk->vp.x < 0 || vk->vp.y < 0
+        || !vk->vp.width || !vk->vp.height
+        || vk->vp.x + vk->vp.width > vk->context->swapchain_width
+        || vk->vp.y + vk->vp.height > vk->context->swapchain_height)
+        return false;
+
+    if (vk->vp.width % input->width || vk->vp.height % input->height)
+        return false;
+
+    if (vk->blit.src_format != input->format)
+    {
+        vk->blit.src_format = input->format;
+        vk->blit.src_supported = vulkan_format_supports(vk,
+            input->format, VK_FORMAT_FEATURE_BLIT_SRC_BIT);
+    }
+
+    if (vk->blit.dst_format != vk->context->swapchain_format)
+    {
+        vk->blit.dst_format = vk->context->swapchain_format;
+        vk->blit.dst_supported = vulkan_format_supports(vk,
+            vk->context->swapchain_format, VK_FORMAT_FEATURE_BLIT_DST_BIT);
+    }
+
+    return vk->blit.src_supported && vk->blit.dst_supported;
+}
+
+/* Leaves the backbuffer in TRANSFER_DST_OPTIMAL. */
+static void vulkan_direct_blit(vk_t* vk,
+    const struct vulkan_filter_chain_texture* input,
+    const struct vk_image* backbuffer)
+{
+    VkImageSubresourceRange range;
+    VkImageLayout src_layout = input->layout;
+
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = 1;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    /* A GENERAL image is read in place. It still needs a barrier so the
+     * transfer waits for the shader writes before it and sees them. */
+    if (input->layout == VK_IMAGE_LAYOUT_GENERAL)
+    {
+        VULKAN_IMAGE_LAYOUT_TRANSITION(vk->cmd, input->image,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    else
+    {
+        VULKAN_IMAGE_LAYOUT_TRANSITION(vk->cmd, input->image,
+            input->layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT);
+        src_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
+
+    /* Chain onto the acquire semaphore, which waits at attachment output. */
+    VULKAN_IMAGE_LAYOUT_TRANSITION(vk->cmd, backbuffer->image,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    /* Letterboxing, clear what the blit won't cover. */
+    if (vk->vp.x != 0 || vk->vp.y != 0
+        || vk->vp.width != vk->context->swapchain_width
+        || vk->vp.height != vk->context->swapchain_height)
+    {
+        VkClearColorValue color;
+
+        memset(&color, 0, sizeof(color));
+        vkCmdClearColorImage(vk->cmd, backbuffer->image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+
+        VULKAN_IMAGE_LAYOUT_TRANSITION(vk->cmd, backbuffer->image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    if (vk->vp.width == input->width
+        && vk->vp.height == input->height
+        && input->format == vk->context->swapchain_format)
+    {
+        VkImageCopy region;
+
+        memset(&region, 0, sizeof(region));
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource = region.srcSubresource;
+        region.dstOffset.x = vk->vp.x;
+        region.dstOffset.y = vk->vp.y;
+        region.extent.width = input->width;
+        region.extent.height = input->height;
+        region.extent.depth = 1;
+
+        vkCmdCopyImage(vk->cmd,
+            input->image, src_layout,
+            backbuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &region);
+    }
+    else
+    {
+        VkImageBlit region;
+
+        memset(&region, 0, sizeof(region));
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource = region.srcSubresource;
+        region.srcOffsets[1].x = input->width;
+        region.srcOffsets[1].y = input->height;
+        region.srcOffsets[1].z = 1;
+        region.dstOffsets[0].x = vk->vp.x;
+        region.dstOffsets[0].y = vk->vp.y;
+        region.dstOffsets[1].x = vk->vp.x + vk->vp.width;
+        region.dstOffsets[1].y = vk->vp.y + vk->vp.height;
+        region.dstOffsets[1].z = 1;
+
+        vkCmdBlitImage(vk->cmd,
+            input->image, src_layout,
+            backbuffer->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &region,
+            vk->video.smooth ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+    }
+
+    /* Later shader work on the input waits for the read, for GENERAL too. */
+    VULKAN_IMAGE_LAYOUT_TRANSITION(vk->cmd, input->image,
+        src_layout, input->layout,
+        0, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
 static bool vulkan_frame(void* data, const void* frame,
     unsigned frame_width, unsigned frame_height,
     uint64_t frame_count,
@@ -1636,8 +2023,14 @@ static bool vulkan_frame(void* data, const void* frame,
     VkRenderPassBeginInfo rp_info;
     VkCommandBufferBeginInfo begin_info;
     VkSemaphore signal_semaphores[2];
+    struct vulkan_filter_chain_texture input;
     vk_t* vk = (vk_t*)data;
     bool waits_for_semaphores = false;
+    bool direct_blit = false;
+    /* Where the backbuffer is left once rendering is done. */
+    VkImageLayout backbuffer_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAccessFlags backbuffer_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkPipelineStageFlags backbuffer_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     settings_t* settings = config_get_ptr();
     unsigned width = settings->uints.window_position_width;
     unsigned height = settings->uints.window_position_height;
@@ -1656,15 +2049,15 @@ static bool vulkan_frame(void* data, const void* frame,
     struct vk_per_frame* chain = &vk->swapchain[frame_index];
     struct vk_image* backbuffer = &vk->backbuffers[swapchain_index];
     struct vk_descriptor_manager* manager = &chain->descriptor_manager;
-    struct vk_buffer_chain* buff_chain_vbo = &chain->vbo;
-    struct vk_buffer_chain* buff_chain_ubo = &chain->ubo;
+    struct vk_descriptor_cache* descriptor_cache = &chain->descriptor_cache;
 
     vk->chain = chain;
     vk->backbuffer = backbuffer;
 
     VK_DESCRIPTOR_MANAGER_RESTART(manager);
-    VK_BUFFER_CHAIN_DISCARD(buff_chain_vbo);
-    VK_BUFFER_CHAIN_DISCARD(buff_chain_ubo);
+    VK_DESCRIPTOR_CACHE_BEGIN_FRAME(descriptor_cache);
+    vulkan_buffer_ring_begin_frame(vk->context->device,
+        &vk->ring, frame_index);
 
     /* Start recording the command buffer. */
     vk->cmd = chain->cmd;
@@ -1680,6 +2073,8 @@ static bool vulkan_frame(void* data, const void* frame,
 
     vkBeginCommandBuffer(vk->cmd, &begin_info);
 
+    vulkan_begin_timing(vk, frame_index);
+
     vk->tracker.dirty = 0;
     vk->tracker.scissor.offset.x = 0;
     vk->tracker.scissor.offset.y = 0;
@@ -1779,8 +2174,6 @@ static bool vulkan_frame(void* data, const void* frame,
     /* Render offscreen filter chain passes. */
     {
         /* Set the source texture in the filter chain */
-        struct vulkan_filter_chain_texture input;
-
         if (vk->hw.enable)
         {
             /* Does this make that this can happen at all? */
@@ -1862,9 +2255,22 @@ static bool vulkan_frame(void* data, const void* frame,
 
     vulkan_set_viewport(vk, width, height, false, true);
 
-    vulkan_filter_chain_build_offscreen_passes(
-        (vulkan_filter_chain_t*)vk->filter_chain,
-        vk->cmd, &vk->vk_vp);
+    direct_blit = (backbuffer->image != VK_NULL_HANDLE)
+        && vk->context->has_acquired_swapchain
+        && vulkan_can_direct_blit(vk, &input);
+
+    if (direct_blit)
+    {
+        vulkan_direct_blit(vk, &input, backbuffer);
+
+        backbuffer_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        backbuffer_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+        backbuffer_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    else
+        vulkan_filter_chain_build_offscreen_passes(
+            (vulkan_filter_chain_t*)vk->filter_chain,
+            vk->cmd, &vk->vk_vp);
 
 #ifdef VULKAN_HDR_SWAPCHAIN
     if (vk->context->hdr_enable && use_main_buffer)
@@ -1874,7 +2280,8 @@ static bool vulkan_frame(void* data, const void* frame,
 #endif /* VULKAN_HDR_SWAPCHAIN */
 
     /* Render to backbuffer. */
-    if ((backbuffer->image != VK_NULL_HANDLE)
+    if (!direct_blit
+        && (backbuffer->image != VK_NULL_HANDLE)
         && vk->context->has_acquired_swapchain)
     {
         rp_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -2031,7 +2438,7 @@ static bool vulkan_frame(void* data, const void* frame,
             {
                 struct vk_buffer_range range;
 
-                vulkan_buffer_chain_alloc(vk->context, &vk->chain->vbo, 6 * sizeof(struct vk_vertex), &range);
+                VULKAN_RING_ALLOC_VBO(vk, 6 * sizeof(struct vk_vertex), &range);
 
                 {
                     struct vk_vertex* pv = (struct vk_vertex*)range.data;
@@ -2078,11 +2485,11 @@ static bool vulkan_frame(void* data, const void* frame,
             VULKAN_IMAGE_LAYOUT_TRANSITION(
                 vk->cmd,
                 backbuffer->image,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                backbuffer_layout,
                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                backbuffer_access,
                 VK_ACCESS_TRANSFER_READ_BIT,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                backbuffer_stage,
                 VK_PIPELINE_STAGE_TRANSFER_BIT);
 
             vulkan_readback(vk);
@@ -2106,11 +2513,11 @@ static bool vulkan_frame(void* data, const void* frame,
             VULKAN_IMAGE_LAYOUT_TRANSITION(
                 vk->cmd,
                 backbuffer->image,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                backbuffer_layout,
                 VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                backbuffer_access,
                 0,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                backbuffer_stage,
                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
         }
     }
@@ -2130,6 +2537,8 @@ static bool vulkan_frame(void* data, const void* frame,
             vk->context->graphics_queue_index, vk->hw.src_queue_family);
     }
 
+    vulkan_end_timing(vk, frame_index, direct_blit);
+
     vkEndCommandBuffer(vk->cmd);
 
     /* Submit command buffers to GPU. */
@@ -2388,9 +2797,13 @@ static void vulkan_set_aspect_ratio(void* data, unsigned aspect_ratio_idx)
 
 static void vulkan_apply_state_changes(void* data)
 {
+    settings_t* settings = config_get_ptr();
     vk_t* vk = (vk_t*)data;
-    if (vk)
-        vk->should_resize = true;
+    if (!vk)
+        return;
+
+    vk->keep_aspect = settings->bools.video_force_aspect;
+    vk->should_resize = true;
 }
 
 static void vulkan_show_mouse(void* data, bool state)
@@ -2410,6 +2823,15 @@ static struct video_shader* vulkan_get_current_shader(void* data)
     return vulkan_filter_chain_get_preset((vulkan_filter_chain_t*)vk->filter_chain);
 }
 
+static unsigned vulkan_get_history_size(void* data)
+{
+    vk_t* vk = (vk_t*)data;
+    if (!vk || !vk->filter_chain)
+        return 0;
+
+    return vulkan_filter_chain_get_history_size((vulkan_filter_chain_t*)vk->filter_chain);
+}
+
 static bool vulkan_get_current_sw_framebuffer(void* data,
     struct retro_framebuffer* framebuffer)
 {
@@ -2696,13 +3118,14 @@ static const video_poke_interface_t vulkan_poke_interface = {
    vulkan_set_hdr_max_nits,
    vulkan_set_hdr_paper_white_nits,
    vulkan_set_hdr_contrast,
-   vulkan_set_hdr_expand_gamut
+   vulkan_set_hdr_expand_gamut,
 #else
    NULL, /* set_hdr_max_nits */
    NULL, /* set_hdr_paper_white_nits */
    NULL, /* set_hdr_contrast */
-   NULL  /* set_hdr_expand_gamut */
+   NULL, /* set_hdr_expand_gamut */
 #endif /* VULKAN_HDR_SWAPCHAIN */
+   vulkan_get_history_size
 };
 
 static void vulkan_get_poke_interface(void* data,
@@ -2949,8 +3372,7 @@ static void vulkan_render_overlay(vk_t* vk, unsigned width,
         struct vk_draw_triangles call;
         struct vk_buffer_range range;
 
-        if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->vbo,
-            4 * sizeof(struct vk_vertex), &range))
+        if (!VULKAN_RING_ALLOC_VBO(vk, 4 * sizeof(struct vk_vertex), &range))
             break;
 
         memcpy(range.data, &vk->overlay.vertex[i * 4],
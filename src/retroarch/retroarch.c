@@ -25,6 +25,7 @@
 #include "../config.h"
 #include "driver.h"
 #include "video_driver.h"
+#include "compat_strl.h"
 
 #include <stdio.h>
 
@@ -97,6 +98,9 @@ bool retro_init(bool fs, unsigned width, unsigned height, unsigned av_width, uns
     rsettings->bools.video_fullscreen = fs;
     rsettings->bools.video_vsync = settings[KEY_VSYNC].val;
     rsettings->bools.video_scale_integer = settings[KEY_INTEGER].val;
+    rsettings->bools.video_shader_pass_fusion = settings[KEY_SHADER_PASS_FUSION].val;
+    strlcpy(rsettings->paths.path_shader, string_settings[SKEY_SHADER_PRESET].val,
+        sizeof(rsettings->paths.path_shader));
 
 #if defined(DEBUG) && defined(HAVE_DRMINGW)
     char log_file_name[128];
@@ -132,6 +136,7 @@ error:
 void retro_deinit(void)
 {
     core_deinit();
+    ScreenshotShutdown();
 }
 
 void retro_reinit()
@@ -139,6 +144,63 @@ void retro_reinit()
     video_driver_reinit();
 }
 
+bool retro_reconfigure(bool fs, unsigned width, unsigned height, unsigned av_width, unsigned av_height)
+{
+    settings_t* rsettings = config_get_ptr();
+    video_driver_state_t* video_st = video_state_get_ptr();
+    bool vsync = settings[KEY_VSYNC].val;
+
+    /* Without a live driver there is nothing to patch up, caller has to do a full init. */
+    if (!video_st->data || !video_st->current_video || !video_st->poke)
+        return false;
+
+    video_st->av_info.geometry.max_height = video_st->av_info.geometry.base_height = av_height;
+    video_st->av_info.geometry.max_width = video_st->av_info.geometry.base_width = av_width;
+
+    rsettings->bools.video_force_aspect = settings[KEY_INTEGER].val;
+    rsettings->bools.video_scale_integer = settings[KEY_INTEGER].val;
+
+    if (rsettings->bools.video_fullscreen != fs
+        || rsettings->uints.window_position_width != width
+        || rsettings->uints.window_position_height != height)
+    {
+        rsettings->bools.video_fullscreen = fs;
+        rsettings->uints.window_position_width = width;
+        rsettings->uints.window_position_height = height;
+
+        if (video_st->poke->set_video_mode)
+            video_st->poke->set_video_mode(video_st->data, width, height, fs);
+    }
+
+    if (rsettings->bools.video_vsync != vsync)
+    {
+        rsettings->bools.video_vsync = vsync;
+
+        if (video_st->current_video->set_nonblock_state)
+            video_st->current_video->set_nonblock_state(video_st->data, !vsync,
+                rsettings->bools.video_adaptive_vsync, rsettings->uints.video_swap_interval);
+    }
+
+    /* Fusion is decided when the chain is built, so it takes a reload too. */
+    if (!string_is_equal(rsettings->paths.path_shader, string_settings[SKEY_SHADER_PRESET].val)
+        || rsettings->bools.video_shader_pass_fusion != !!settings[KEY_SHADER_PASS_FUSION].val)
+    {
+        strlcpy(rsettings->paths.path_shader, string_settings[SKEY_SHADER_PRESET].val,
+            sizeof(rsettings->paths.path_shader));
+        rsettings->bools.video_shader_pass_fusion = settings[KEY_SHADER_PASS_FUSION].val;
+
+        if (video_st->current_video->set_shader)
+            video_st->current_video->set_shader(video_st->data, 0,
+                rsettings->paths.path_shader);
+    }
+
+    /* Swapchain and viewport are rebuilt through set_resize on the next frame. */
+    if (video_st->poke->apply_state_changes)
+        video_st->poke->apply_state_changes(video_st->data);
+
+    return true;
+}
+
 static settings_t config_st = { 
     .uints = {
         .video_swap_interval = 1,
@@ -216,10 +278,24 @@ void retro_video_capture_screen(const char* dir, const char* romname)
     if (!vp.width || !vp.height)
         return;
 
-    void* buffer = malloc(vp.width * vp.height * 3);
+    /* Only the readback happens here, encoding and writing the file is
+     * left to the screenshot writer thread. */
+    bool busy;
+    unsigned char* buffer = ScreenshotAcquireBuffer((size_t)vp.width * vp.height * 3, &busy);
+    if (!buffer)
+    {
+        if (busy)
+            RARCH_LOG("[Screenshot]: Dropped, earlier captures are still being written.\n");
+        else
+            RARCH_LOG("[Screenshot]: Dropped, out of memory for a %ux%u capture.\n", vp.width, vp.height);
+        return;
+    }
+
     if (video_driver_read_viewport(buffer, false /*is_idle*/))
     {
-        SaveScreenshot(dir, romname, vp.width, vp.height, buffer);
+        ScreenshotSubmit(dir, romname, vp.width, vp.height, buffer, settings[KEY_SCREENSHOT_FORMAT].val,
+            settings[KEY_PNG_COMPRESSION].val, settings[KEY_PNG_FILTER].val);
     }
-    free(buffer);
+    else
+        ScreenshotReleaseBuffer(buffer);
 }
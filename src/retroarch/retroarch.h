@@ -175,6 +175,10 @@ static inline uint32_t next_pow2(uint32_t v)
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
+#ifndef PATH_MAX_LENGTH
+#define PATH_MAX_LENGTH 4096
+#endif
+
 typedef struct 
 {
     struct
@@ -186,6 +190,7 @@ typedef struct
         bool video_smooth;
         bool video_ctx_scaling;
         bool video_scale_integer;
+        bool video_shader_pass_fusion;
     } bools;
 
     struct
@@ -204,6 +209,12 @@ typedef struct
     {
         int vulkan_gpu_index;
     } ints;
+
+    struct
+    {
+        /* .slangp preset, empty for the stock filter chain. */
+        char path_shader[PATH_MAX_LENGTH];
+    } paths;
 } settings_t;
 
 #define RARCH_ERR(...) retroarch_fail(1, __VA_ARGS__)
@@ -218,6 +229,8 @@ inline bool string_is_equal(const char* a, const char* b)
 
 #define string_is_equal_fast(a, b, size)     (memcmp(a, b, size) == 0)
 
+#define STRLEN_CONST(x)                   ((sizeof((x))-1))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -225,6 +238,7 @@ extern "C" {
     bool retro_init(bool fs, unsigned width, unsigned height, unsigned av_width, unsigned av_height);
     void retro_deinit(void);
     void retro_reinit(void);
+    bool retro_reconfigure(bool fs, unsigned width, unsigned height, unsigned av_width, unsigned av_height);
 
     void retro_video_capture_screen(const char* dir, const char* romname);
 
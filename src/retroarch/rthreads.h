@@ -23,12 +23,17 @@
 #ifndef __LIBRETRO_SDK_RTHREADS_H__
 #define __LIBRETRO_SDK_RTHREADS_H__
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct sthread sthread_t;
 typedef struct slock slock_t;
 typedef struct scond scond_t;
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * sthread_create:
  * @start_routine           : thread entry callback function
@@ -253,4 +258,8 @@ uintptr_t sthread_get_thread_id(sthread_t* thread);
  */
 uintptr_t sthread_get_current_thread_id(void);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
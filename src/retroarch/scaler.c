@@ -26,65 +26,300 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 #include "filter.h"
 #include "scaler.h"
 #include "scaler_int.h"
 #include "pixconv.h"
+#include "rthreads.h"
+
+/* Frames smaller than this are scaled on the calling thread. */
+#define SCALER_THREAD_MIN_PIXELS (256 * 256)
+
+#define SCALER_MAX_THREADS 8
 
-static bool allocate_frames(struct scaler_ctx *ctx)
+struct scaler_pool_worker
 {
-   uint64_t *scaled_frame = NULL;
-   ctx->scaled.stride     = ((ctx->out_width + 7) & ~7) * sizeof(uint64_t);
-   ctx->scaled.width      = ctx->out_width;
-   ctx->scaled.height     = ctx->in_height;
-   scaled_frame           = (uint64_t*)calloc(sizeof(uint64_t),
-            (ctx->scaled.stride * ctx->scaled.height) >> 3);
-
-   if (!scaled_frame)
-      return false;
+   struct scaler_pool *pool;
+   sthread_t *thread;
+   unsigned index;
+};
 
-   ctx->scaled.frame      = scaled_frame;
+struct scaler_pool
+{
+   struct scaler_pool_worker workers[SCALER_MAX_THREADS];
+   unsigned num_workers;
+
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+
+   /* The job being run, all guarded by the lock. */
+   void (*job)(void *data, unsigned index, unsigned thread);
+   void *data;
+   unsigned count;
+   unsigned next;
+   unsigned busy;
+   unsigned generation;
+   bool quit;
+};
+
+struct scaler_job
+{
+   const struct scaler_ctx *ctx;
+   const void *input;
+   void *output;
+};
+
+static unsigned scaler_cpu_count(void)
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   long count = sysconf(_SC_NPROCESSORS_ONLN);
+   return count > 0 ? (unsigned)count : 1;
+#else
+   return 1;
+#endif
+}
+
+static void scaler_pool_thread(void *data)
+{
+   struct scaler_pool_worker *worker = (struct scaler_pool_worker*)data;
+   struct scaler_pool *pool          = worker->pool;
+   unsigned generation               = 0;
 
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   slock_lock(pool->lock);
+
+   for (;;)
    {
-      uint32_t *input_frame = NULL;
-      ctx->input.stride     = ((ctx->in_width + 7) & ~7) * sizeof(uint32_t);
-      input_frame           = (uint32_t*)calloc(sizeof(uint32_t),
-               (ctx->input.stride * ctx->in_height) >> 2);
+      while (!pool->quit && pool->generation == generation)
+         scond_wait(pool->work_cond, pool->lock);
 
-      if (!input_frame)
-         return false;
+      if (pool->quit)
+         break;
+
+      generation = pool->generation;
+      pool->busy++;
+
+      while (pool->next < pool->count)
+      {
+         unsigned index = pool->next++;
+
+         slock_unlock(pool->lock);
+         pool->job(pool->data, index, worker->index);
+         slock_lock(pool->lock);
+      }
+
+      if (--pool->busy == 0)
+         scond_signal(pool->done_cond);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void scaler_pool_free(struct scaler_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      scond_broadcast(pool->work_cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_workers; i++)
+      sthread_join(pool->workers[i].thread);
+
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->work_cond)
+      scond_free(pool->work_cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+   free(pool);
+}
+
+static struct scaler_pool *scaler_pool_new(unsigned num_workers)
+{
+   unsigned i;
+   struct scaler_pool *pool = (struct scaler_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->lock      = slock_new();
+   pool->work_cond = scond_new();
+   pool->done_cond = scond_new();
+
+   if (!pool->lock || !pool->work_cond || !pool->done_cond)
+   {
+      scaler_pool_free(pool);
+      return NULL;
+   }
+
+   for (i = 0; i < num_workers; i++)
+   {
+      struct scaler_pool_worker *worker = &pool->workers[pool->num_workers];
+
+      worker->pool   = pool;
+      worker->index  = pool->num_workers + 1;
+      worker->thread = sthread_create(scaler_pool_thread, worker);
+
+      if (!worker->thread)
+         break;
+      pool->num_workers++;
+   }
 
-      ctx->input.frame      = input_frame;
+   if (!pool->num_workers)
+   {
+      scaler_pool_free(pool);
+      return NULL;
    }
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   return pool;
+}
+
+/* Runs @job for every index below @count, on the calling thread
+ * (thread 0) and the workers of @pool (1 and up), if there is one. */
+static void scaler_pool_run(struct scaler_pool *pool,
+      void (*job)(void *data, unsigned index, unsigned thread),
+      void *data, unsigned count)
+{
+   unsigned i;
+
+   if (!pool || count < 2)
+   {
+      for (i = 0; i < count; i++)
+         job(data, i, 0);
+      return;
+   }
+
+   slock_lock(pool->lock);
+
+   pool->job   = job;
+   pool->data  = data;
+   pool->count = count;
+   pool->next  = 0;
+   pool->generation++;
+   scond_broadcast(pool->work_cond);
+
+   while (pool->next < pool->count)
    {
-      uint32_t *output_frame = NULL;
-      ctx->output.stride     = ((ctx->out_width + 7) & ~7) * sizeof(uint32_t);
+      unsigned index = pool->next++;
+
+      slock_unlock(pool->lock);
+      job(data, index, 0);
+      slock_lock(pool->lock);
+   }
+
+   while (pool->busy)
+      scond_wait(pool->done_cond, pool->lock);
+
+   slock_unlock(pool->lock);
+}
+
+static bool scaler_gen_bands(struct scaler_ctx *ctx, unsigned threads)
+{
+   int i;
+   int count = 1;
+
+   /* A few bands per thread, so uneven ones can balance out. */
+   if (threads > 1)
+      count = threads * 4;
+   if (count > ctx->out_height)
+      count = ctx->out_height;
+
+   ctx->bands.first_row = (int*)malloc((count + 1) * sizeof(int));
+   if (!ctx->bands.first_row)
+      return false;
 
-      output_frame           = (uint32_t*)calloc(sizeof(uint32_t),
-               (ctx->output.stride * ctx->out_height) >> 2);
+   for (i = 0; i <= count; i++)
+      ctx->bands.first_row[i] = ctx->out_height * i / count;
+   ctx->bands.count = count;
 
-      if (!output_frame)
+   /* Pixels are converted a row at a time, next to where they are
+    * scaled, so neither side needs a whole staging frame. */
+   if (ctx->in_pixconv || (ctx->scaler_point && ctx->out_pixconv))
+   {
+      int width         = ctx->in_width;
+      if (ctx->scaler_point && ctx->out_width > width)
+         width = ctx->out_width;
+      ctx->input.stride = ((width + 7) & ~7) * sizeof(uint32_t);
+      ctx->input.frame  = (uint32_t*)calloc(threads, ctx->input.stride);
+      if (!ctx->input.frame)
          return false;
+   }
 
-      ctx->output.frame      = output_frame;
+   if (ctx->out_pixconv)
+   {
+      ctx->output.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint32_t);
+      ctx->output.frame  = (uint32_t*)calloc(threads, ctx->output.stride);
+      if (!ctx->output.frame)
+         return false;
    }
 
-   return true;
+   if (ctx->scaler_point)
+      return true;
+
+   ctx->bands.taps = (const uint64_t**)malloc(
+         threads * ctx->vert.filter_len * sizeof(*ctx->bands.taps));
+   if (!ctx->bands.taps)
+      return false;
+
+   /* Each thread keeps just the rows one output row is filtered from,
+    * that stays in L2 where a whole frame of them would not. */
+   ctx->scaled.width  = ctx->out_width;
+   ctx->scaled.height = ctx->vert.filter_len;
+   ctx->scaled.stride = ((ctx->out_width + 7) & ~7) * sizeof(uint64_t);
+   ctx->scaled.frame  = (uint64_t*)calloc(
+         (size_t)threads * ctx->scaled.height, ctx->scaled.stride);
+
+   return ctx->scaled.frame != NULL;
+}
+
+static bool scaler_gen_threads(struct scaler_ctx *ctx)
+{
+   unsigned threads = scaler_cpu_count();
+
+   if (threads > SCALER_MAX_THREADS)
+      threads = SCALER_MAX_THREADS;
+   if ((int64_t)ctx->in_width  * ctx->in_height
+         + (int64_t)ctx->out_width * ctx->out_height < SCALER_THREAD_MIN_PIXELS)
+      threads = 1;
+
+   if (threads > 1)
+   {
+      ctx->pool = scaler_pool_new(threads - 1);
+      threads   = ctx->pool ? ctx->pool->num_workers + 1 : 1;
+   }
+
+   return scaler_gen_bands(ctx, threads);
 }
 
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
    scaler_ctx_gen_reset(ctx);
 
-   ctx->scaler_special = NULL;
+   ctx->scaler_point   = NULL;
+   ctx->in_pixconv     = NULL;
+   ctx->out_pixconv    = NULL;
+   ctx->direct_pixconv = NULL;
    ctx->unscaled       = false;
 
-   if (!allocate_frames(ctx))
-      return false;
-
    if (     ctx->in_width  == ctx->out_width
          && ctx->in_height == ctx->out_height)
    {
@@ -208,12 +443,20 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
       ctx->scaler_horiz = scaler_argb8888_horiz;
       ctx->scaler_vert  = scaler_argb8888_vert;
 
+      if (pixconv_has_avx2())
+         scaler_argb8888_select_avx2(ctx);
+
       switch (ctx->in_fmt)
       {
          case SCALER_FMT_ARGB8888:
             /* No need to convert :D */
             break;
 
+         case SCALER_FMT_ABGR8888:
+            /* Every channel is filtered alike, so this is scaled
+             * as it is and only has its channels swapped on output. */
+            break;
+
          case SCALER_FMT_0RGB1555:
             ctx->in_pixconv = conv_0rgb1555_argb8888;
             break;
@@ -234,7 +477,27 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
             return false;
       }
 
-      switch (ctx->out_fmt)
+      if (ctx->in_fmt == SCALER_FMT_ABGR8888)
+      {
+         switch (ctx->out_fmt)
+         {
+            case SCALER_FMT_ABGR8888:
+               break;
+
+            case SCALER_FMT_ARGB8888:
+               /* The swap goes both ways. */
+               ctx->out_pixconv = conv_argb8888_abgr8888;
+               break;
+
+            case SCALER_FMT_BGR24:
+               ctx->out_pixconv = conv_abgr8888_bgr24;
+               break;
+
+            default:
+               return false;
+         }
+      }
+      else switch (ctx->out_fmt)
       {
          case SCALER_FMT_ARGB8888:
             /* No need to convert :D */
@@ -262,8 +525,38 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
       if (!scaler_gen_filter(ctx))
          return false;
+
+      if (ctx->scaler_type == SCALER_TYPE_POINT)
+      {
+         switch (ctx->in_fmt)
+         {
+            case SCALER_FMT_ARGB8888:
+            case SCALER_FMT_ABGR8888:
+               ctx->scaler_point = scaler_point_32;
+               break;
+
+            case SCALER_FMT_BGR24:
+               ctx->scaler_point = scaler_point_24;
+               break;
+
+            default:
+               ctx->scaler_point = scaler_point_16;
+               break;
+         }
+      }
+
+      if (!scaler_gen_threads(ctx))
+         return false;
    }
 
+   /* Same output, faster kernels where the CPU has them. */
+   if (ctx->direct_pixconv)
+      ctx->direct_pixconv = pixconv_select(ctx->direct_pixconv);
+   if (ctx->in_pixconv)
+      ctx->in_pixconv     = pixconv_select(ctx->in_pixconv);
+   if (ctx->out_pixconv)
+      ctx->out_pixconv    = pixconv_select(ctx->out_pixconv);
+
    return true;
 }
 
@@ -283,6 +576,12 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
       free(ctx->input.frame);
    if (ctx->output.frame)
       free(ctx->output.frame);
+   if (ctx->bands.first_row)
+      free(ctx->bands.first_row);
+   if (ctx->bands.taps)
+      free((void*)ctx->bands.taps);
+
+   scaler_pool_free(ctx->pool);
 
    ctx->horiz.filter        = NULL;
    ctx->horiz.filter_len    = 0;
@@ -304,6 +603,142 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 
    ctx->output.frame        = NULL;
    ctx->output.stride       = 0;
+
+   ctx->bands.first_row     = NULL;
+   ctx->bands.count         = 0;
+   ctx->bands.taps          = NULL;
+
+   ctx->pool                = NULL;
+}
+
+static void scaler_scale_band(void *data, unsigned index, unsigned thread)
+{
+   int h, y;
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   const struct scaler_ctx *ctx = job->ctx;
+   const int filter_len         = ctx->vert.filter_len;
+   const int scaled_stride      = ctx->scaled.stride >> 3;
+   int end                      = ctx->bands.first_row[index + 1];
+   int next                     = 0;
+   uint64_t *ring               = ctx->scaled.frame
+      + (size_t)thread * filter_len * scaled_stride;
+   const uint64_t **taps        = ctx->bands.taps + thread * filter_len;
+   uint8_t *input_row           = (uint8_t*)ctx->input.frame
+      + (size_t)thread * ctx->input.stride;
+   uint8_t *output_row          = (uint8_t*)ctx->output.frame
+      + (size_t)thread * ctx->output.stride;
+
+   for (h = ctx->bands.first_row[index]; h < end; h++)
+   {
+      int pos = ctx->vert.filter_pos[h];
+      uint8_t *output = (uint8_t*)job->output
+         + (ptrdiff_t)h * ctx->out_stride;
+
+      /* Scale the rows this output row adds, they replace
+       * the ones no later row of the band will need. */
+      if (next < pos || h == ctx->bands.first_row[index])
+         next = pos;
+
+      for (; next < pos + filter_len; next++)
+      {
+         const uint8_t *input = (const uint8_t*)job->input
+            + (ptrdiff_t)next * ctx->in_stride;
+         int input_stride     = ctx->in_stride;
+
+         /* Convert the row right before it is filtered, while
+          * it still sits in L1. */
+         if (ctx->in_pixconv)
+         {
+            ctx->in_pixconv(input_row, input, ctx->in_width, 1,
+                  ctx->input.stride, ctx->in_stride);
+            input        = input_row;
+            input_stride = ctx->input.stride;
+         }
+
+         ctx->scaler_horiz(ctx, ring + (next % filter_len) * scaled_stride,
+               input, input_stride, 1);
+      }
+
+      for (y = 0; y < filter_len; y++)
+         taps[y] = ring + ((pos + y) % filter_len) * scaled_stride;
+
+      if (ctx->out_pixconv)
+      {
+         ctx->scaler_vert(ctx, output_row, taps, h);
+         ctx->out_pixconv(output, output_row, ctx->out_width, 1,
+               ctx->out_stride, ctx->output.stride);
+      }
+      else
+         ctx->scaler_vert(ctx, output, taps, h);
+   }
+}
+
+static void scaler_point_band(void *data, unsigned index, unsigned thread)
+{
+   int h;
+   const struct scaler_job *job = (const struct scaler_job*)data;
+   const struct scaler_ctx *ctx = job->ctx;
+   int end                      = ctx->bands.first_row[index + 1];
+   int converted                = -1;
+   uint8_t *input_row           = (uint8_t*)ctx->input.frame
+      + (size_t)thread * ctx->input.stride;
+   uint8_t *output_row          = (uint8_t*)ctx->output.frame
+      + (size_t)thread * ctx->output.stride;
+
+   for (h = ctx->bands.first_row[index]; h < end; h++)
+   {
+      int pos              = ctx->vert.filter_pos[h];
+      const uint8_t *input = (const uint8_t*)job->input
+         + (ptrdiff_t)pos * ctx->in_stride;
+      uint8_t *output      = (uint8_t*)job->output
+         + (ptrdiff_t)h * ctx->out_stride;
+
+      /* When upscaling, converting the input row touches fewer
+       * pixels, and repeated rows are converted once. */
+      if (ctx->in_pixconv && ctx->in_width < ctx->out_width)
+      {
+         if (pos != converted)
+         {
+            ctx->in_pixconv(input_row, input, ctx->in_width, 1,
+                  ctx->input.stride, ctx->in_stride);
+            converted = pos;
+         }
+
+         if (!ctx->out_pixconv)
+         {
+            scaler_point_32(ctx, output, input_row);
+            continue;
+         }
+
+         scaler_point_32(ctx, output_row, input_row);
+         ctx->out_pixconv(output, output_row, ctx->out_width, 1,
+               ctx->out_stride, ctx->output.stride);
+         continue;
+      }
+
+      if (!ctx->in_pixconv && !ctx->out_pixconv)
+      {
+         ctx->scaler_point(ctx, output, input);
+         continue;
+      }
+
+      /* Only the pixels that were kept get converted. */
+      ctx->scaler_point(ctx, input_row, input);
+
+      if (ctx->in_pixconv && ctx->out_pixconv)
+      {
+         ctx->in_pixconv(output_row, input_row, ctx->out_width, 1,
+               ctx->output.stride, ctx->input.stride);
+         ctx->out_pixconv(output, output_row, ctx->out_width, 1,
+               ctx->out_stride, ctx->output.stride);
+      }
+      else if (ctx->in_pixconv)
+         ctx->in_pixconv(output, input_row, ctx->out_width, 1,
+               ctx->out_stride, ctx->input.stride);
+      else
+         ctx->out_pixconv(output, input_row, ctx->out_width, 1,
+               ctx->out_stride, ctx->input.stride);
+   }
 }
 
 /**
@@ -317,44 +752,13 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 void scaler_ctx_scale(struct scaler_ctx *ctx,
       void *output, const void *input)
 {
-   const void *input_frame = input;
-   void *output_frame      = output;
-   int input_stride        = ctx->in_stride;
-   int output_stride       = ctx->out_stride;
+   struct scaler_job job;
 
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
-   {
-      ctx->in_pixconv(ctx->input.frame, input,
-            ctx->in_width, ctx->in_height,
-            ctx->input.stride, ctx->in_stride);
-
-      input_frame       = ctx->input.frame;
-      input_stride      = ctx->input.stride;
-   }
-
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-   {
-      output_frame  = ctx->output.frame;
-      output_stride = ctx->output.stride;
-   }
-
-   /* Take some special, and (hopefully) more optimized path. */
-   if (ctx->scaler_special)
-      ctx->scaler_special(ctx, output_frame, input_frame,
-            ctx->out_width, ctx->out_height,
-            ctx->in_width, ctx->in_height,
-            output_stride, input_stride);
-   else
-   {
-      /* Take generic filter path. */
-      if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
-      if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
-   }
+   job.ctx    = ctx;
+   job.input  = input;
+   job.output = output;
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-      ctx->out_pixconv(output, ctx->output.frame,
-            ctx->out_width, ctx->out_height,
-            ctx->out_stride, ctx->output.stride);
+   scaler_pool_run(ctx->pool,
+         ctx->scaler_point ? scaler_point_band : scaler_scale_band,
+         &job, ctx->bands.count);
 }
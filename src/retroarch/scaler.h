@@ -54,26 +54,32 @@ struct scaler_filter
    int      filter_stride;
 };
 
+struct scaler_pool;
+
 struct scaler_ctx
 {
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         uint64_t*, const void*, int, int);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
-   void (*scaler_special)(const struct scaler_ctx*,
-         void*, const void*, int, int, int, int, int, int);
+         void*, const uint64_t* const*, int);
+   void (*scaler_point)(const struct scaler_ctx*,
+         void*, const void*);
 
    void (*in_pixconv)(void*, const void*, int, int, int, int);
    void (*out_pixconv)(void*, const void*, int, int, int, int);
    void (*direct_pixconv)(void*, const void*, int, int, int, int);
    struct scaler_filter horiz, vert;   /* ptr alignment */
 
+   /* One row per thread of the pool, converted to ARGB8888
+    * on its way in, or point sampled before conversion. */
    struct
    {
       uint32_t *frame;
       int stride;
    } input;
 
+   /* The last vert.filter_len horizontally scaled rows,
+    * a ring per thread of the pool. */
    struct
    {
       uint64_t *frame;
@@ -82,6 +88,19 @@ struct scaler_ctx
       int stride;
    } scaled;
 
+   /* Output rows first_row[i] to first_row[i + 1] make up
+    * band i, the unit of work of the pool. */
+   struct
+   {
+      int *first_row;
+      int count;
+      const uint64_t **taps;
+   } bands;
+
+   struct scaler_pool *pool;
+
+   /* One ARGB8888 row per thread of the pool, converted
+    * to the output format once it is scaled. */
    struct
    {
       uint32_t *frame;
@@ -29,10 +29,21 @@
 
 #include "filter.h"
 #include "scaler_int.h"
-#include "retroarch.h"
 
 #define FILTER_UNITY (1 << 14)
 
+static uint32_t scaler_next_pow2(uint32_t v)
+{
+   v--;
+   v |= v >> 1;
+   v |= v >> 2;
+   v |= v >> 4;
+   v |= v >> 8;
+   v |= v >> 16;
+   v++;
+   return v;
+}
+
 static double sinc(double val)
 {
     if (fabs(val) < 0.00001)
@@ -187,7 +198,7 @@ bool scaler_gen_filter(struct scaler_ctx *ctx)
          break;
       case SCALER_TYPE_SINC:
          sinc_size                = 8 * ((ctx->in_width > ctx->out_width)
-               ? next_pow2(ctx->in_width / ctx->out_width) : 1);
+               ? scaler_next_pow2(ctx->in_width / ctx->out_width) : 1);
          ctx->horiz.filter_len    = sinc_size;
          ctx->horiz.filter_stride = sinc_size;
          ctx->vert.filter_len     = sinc_size;
@@ -216,10 +227,15 @@ bool scaler_gen_filter(struct scaler_ctx *ctx)
          x_pos  = (1 << 15) * ctx->in_width / ctx->out_width   - (1 << 15);
          y_pos  = (1 << 15) * ctx->in_height / ctx->out_height - (1 << 15);
 
+         /* Start on the first pixel rather than clamping the ones
+          * before it, so every sample keeps the same step. */
+         if (x_pos < 0)
+            x_pos = 0;
+         if (y_pos < 0)
+            y_pos = 0;
+
          gen_filter_point_sub(&ctx->horiz, ctx->out_width,  x_pos, x_step);
          gen_filter_point_sub(&ctx->vert,  ctx->out_height, y_pos, y_step);
-
-         ctx->scaler_special = scaler_argb8888_point_special;
          break;
 
       case SCALER_TYPE_BILINEAR:
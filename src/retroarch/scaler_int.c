@@ -62,96 +62,105 @@
  * SIMD code for testing purposes.
  */
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+#if !defined(__SSE2__)
+static uint8_t clamp_8bit(int16_t col)
 {
-   int h, w, y;
-   const uint64_t      *input = ctx->scaled.frame;
-   uint32_t           *output = (uint32_t*)output_;
+   if (col > 255)
+      return 255;
+   else if (col < 0)
+      return 0;
+   return (uint8_t)col;
+}
+#endif
+
+#if defined(__SSE2__)
+/* Four copies of @c0 in the low half, four of @c1 in the high half. */
+static __m128i scaler_coeff_sse2(int16_t c0, int16_t c1)
+{
+   return _mm_unpacklo_epi64(_mm_set1_epi16(c0), _mm_set1_epi16(c1));
+}
+#endif
 
-   const int16_t *filter_vert = ctx->vert.filter;
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_,
+      const uint64_t *const *taps, int row)
+{
+   int w, y;
+   uint32_t           *output = (uint32_t*)output_;
+   const int16_t *filter_vert = ctx->vert.filter
+      + row * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++,
-         filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   for (w = 0; w < ctx->out_width; w++)
    {
-      const uint64_t *input_base = input + ctx->vert.filter_pos[h]
-         * (ctx->scaled.stride >> 3);
-
-      for (w = 0; w < ctx->out_width; w++)
-      {
-         const uint64_t *input_base_y = input_base + w;
 #if defined(__SSE2__)
-         __m128i final;
-         __m128i res = _mm_setzero_si128();
+      __m128i final;
+      __m128i res = _mm_setzero_si128();
 
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
-               input_base_y += (ctx->scaled.stride >> 2))
-         {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+      for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2)
+      {
+         __m128i coeff = scaler_coeff_sse2(filter_vert[y + 0], filter_vert[y + 1]);
+         __m128i col   = _mm_set_epi64x(taps[y + 1][w], taps[y][w]);
 
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
+         res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+      }
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
-         {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+      for (; y < ctx->vert.filter_len; y++)
+      {
+         __m128i coeff = scaler_coeff_sse2(filter_vert[y], 0);
+         __m128i col   = _mm_set_epi64x(0, taps[y][w]);
 
-            res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
+         res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+      }
 
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-         res       = _mm_srai_epi16(res, (7 - 2 - 2));
+      res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+      res       = _mm_srai_epi16(res, (7 - 2 - 2));
 
-         final     = _mm_packus_epi16(res, res);
+      final     = _mm_packus_epi16(res, res);
 
-         output[w] = _mm_cvtsi128_si32(final);
+      output[w] = _mm_cvtsi128_si32(final);
 #else
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+      int16_t res_a = 0;
+      int16_t res_r = 0;
+      int16_t res_g = 0;
+      int16_t res_b = 0;
 
-         for (y = 0; y < ctx->vert.filter_len; y++,
-               input_base_y += (ctx->scaled.stride >> 3))
-         {
-            uint64_t col   = *input_base_y;
+      for (y = 0; y < ctx->vert.filter_len; y++)
+      {
+         uint64_t col   = taps[y][w];
 
-            int16_t a      = (col >> 48) & 0xffff;
-            int16_t r      = (col >> 32) & 0xffff;
-            int16_t g      = (col >> 16) & 0xffff;
-            int16_t b      = (col >>  0) & 0xffff;
+         int16_t a      = (col >> 48) & 0xffff;
+         int16_t r      = (col >> 32) & 0xffff;
+         int16_t g      = (col >> 16) & 0xffff;
+         int16_t b      = (col >>  0) & 0xffff;
 
-            int16_t coeff  = filter_vert[y];
+         int16_t coeff  = filter_vert[y];
 
-            res_a         += (a * coeff) >> 16;
-            res_r         += (r * coeff) >> 16;
-            res_g         += (g * coeff) >> 16;
-            res_b         += (b * coeff) >> 16;
-         }
+         res_a         += (a * coeff) >> 16;
+         res_r         += (r * coeff) >> 16;
+         res_g         += (g * coeff) >> 16;
+         res_b         += (b * coeff) >> 16;
+      }
 
-         res_a           >>= (7 - 2 - 2);
-         res_r           >>= (7 - 2 - 2);
-         res_g           >>= (7 - 2 - 2);
-         res_b           >>= (7 - 2 - 2);
+      res_a           >>= (7 - 2 - 2);
+      res_r           >>= (7 - 2 - 2);
+      res_g           >>= (7 - 2 - 2);
+      res_b           >>= (7 - 2 - 2);
 
-         output[w]         =
-            (clamp_8bit(res_a) << 24) |
-            (clamp_8bit(res_r) << 16) |
-            (clamp_8bit(res_g) << 8)  |
-            (clamp_8bit(res_b) << 0);
+      output[w]         =
+         (clamp_8bit(res_a) << 24) |
+         (clamp_8bit(res_r) << 16) |
+         (clamp_8bit(res_g) << 8)  |
+         (clamp_8bit(res_b) << 0);
 #endif
-      }
    }
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, uint64_t *output,
+      const void *input_, int stride, int rows)
 {
    int h, w, x;
    const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2,
+   for (h = 0; h < rows; h++, input += stride >> 2,
          output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
@@ -171,7 +180,7 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 #endif
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
+            __m128i coeff = scaler_coeff_sse2(filter_horiz[x + 0], filter_horiz[x + 1]);
 
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi64x(0,
                      ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
@@ -182,7 +191,7 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
+            __m128i coeff = scaler_coeff_sse2(filter_horiz[x], 0);
             __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
 
             col           = _mm_slli_epi16(col, 7);
@@ -221,41 +230,57 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
             res_b         += (b * coeff) >> 16;
          }
 
+         /* Ringing can make channels negative, keep them to 16 bits. */
          output[w]         = (
-               (uint64_t)res_a  << 48)  |
-               ((uint64_t)res_r << 32)  |
-               ((uint64_t)res_g << 16)  |
-               ((uint64_t)res_b << 0);
+               (uint64_t)(uint16_t)res_a  << 48)  |
+               ((uint64_t)(uint16_t)res_r << 32)  |
+               ((uint64_t)(uint16_t)res_g << 16)  |
+               ((uint64_t)(uint16_t)res_b << 0);
 #endif
       }
    }
 }
 
-void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output_, const void *input_,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride)
+/* Point sampling only copies pixels, so these work in the input
+ * format and leave any conversion to the caller. */
+void scaler_point_16(const struct scaler_ctx *ctx,
+      void *output_, const void *input_)
 {
-   int h, w;
-   int x_pos             = (1 << 15) * in_width / out_width - (1 << 15);
-   int x_step            = (1 << 16) * in_width / out_width;
-   int y_pos             = (1 << 15) * in_height / out_height - (1 << 15);
-   int y_step            = (1 << 16) * in_height / out_height;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   int w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   const int *filter_pos = ctx->horiz.filter_pos;
+
+   for (w = 0; w < ctx->out_width; w++)
+      output[w] = input[filter_pos[w]];
+}
 
-   if (x_pos < 0)
-      x_pos = 0;
-   if (y_pos < 0)
-      y_pos = 0;
+void scaler_point_24(const struct scaler_ctx *ctx,
+      void *output_, const void *input_)
+{
+   int w;
+   const uint8_t *input  = (const uint8_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+   const int *filter_pos = ctx->horiz.filter_pos;
 
-   for (h = 0; h < out_height; h++, y_pos += y_step, output += out_stride >> 2)
+   for (w = 0; w < ctx->out_width; w++, output += 3)
    {
-      int               x = x_pos;
-      const uint32_t *inp = input + (y_pos >> 16) * (in_stride >> 2);
+      const uint8_t *inp = input + filter_pos[w] * 3;
 
-      for (w = 0; w < out_width; w++, x += x_step)
-         output[w] = inp[x >> 16];
+      output[0]          = inp[0];
+      output[1]          = inp[1];
+      output[2]          = inp[2];
    }
 }
+
+void scaler_point_32(const struct scaler_ctx *ctx,
+      void *output_, const void *input_)
+{
+   int w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   const int *filter_pos = ctx->horiz.filter_pos;
+
+   for (w = 0; w < ctx->out_width; w++)
+      output[w] = input[filter_pos[w]];
+}
@@ -25,16 +25,29 @@
 
 #include "scaler.h"
 
+/* Scales output row @row, @taps points to the vert.filter_len
+ * rows of the horizontal pass it is filtered from. */
 void scaler_argb8888_vert(const struct scaler_ctx *ctx,
-      void *output, int stride);
+      void *output, const uint64_t *const *taps, int row);
 
+/* Scales @rows input rows into @scaled, ctx->scaled.stride apart. */
 void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
-      const void *input, int stride);
+      uint64_t *scaled, const void *input, int stride, int rows);
 
-void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
-      void *output, const void *input,
-      int out_width, int out_height,
-      int in_width, int in_height,
-      int out_stride, int in_stride);
+/* Points ctx->scaler_horiz and ctx->scaler_vert to the AVX2 kernels.
+ * Returns false when they were not built, only call it after
+ * pixconv_has_avx2(). */
+bool scaler_argb8888_select_avx2(struct scaler_ctx *ctx);
+
+/* Point samples one output row from input row @input, with pixels
+ * of 16, 24 or 32 bits in whatever format the input is in. */
+void scaler_point_16(const struct scaler_ctx *ctx,
+      void *output, const void *input);
+
+void scaler_point_24(const struct scaler_ctx *ctx,
+      void *output, const void *input);
+
+void scaler_point_32(const struct scaler_ctx *ctx,
+      void *output, const void *input);
 
 #endif
@@ -0,0 +1,210 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scaler_int_avx2.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* AVX2 versions of the ARGB8888 scalers in scaler_int.c. Every 128-bit
+ * lane does what the SSE2 code does for one pixel, even taps in the low
+ * half and odd taps in the high half, so the results are the same. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "scaler_int.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static __m256i scaler_load_taps_avx2(const int16_t *a, const int16_t *b)
+{
+   /* Two taps per lane, each repeated over one 64-bit half. */
+   const __m256i broadcast = _mm256_setr_epi8(
+         0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3,
+         0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3);
+   int32_t ta, tb;
+
+   memcpy(&ta, a, sizeof(ta));
+   memcpy(&tb, b, sizeof(tb));
+
+   return _mm256_shuffle_epi8(
+         _mm256_setr_epi32(ta, 0, 0, 0, tb, 0, 0, 0), broadcast);
+}
+
+/* One 64-bit result per lane, @a in the low lane. */
+static __m256i scaler_horiz_pair_avx2(const struct scaler_ctx *ctx,
+      const uint32_t *input_a, const int16_t *filter_a,
+      const uint32_t *input_b, const int16_t *filter_b)
+{
+   int x;
+   __m256i res = _mm256_setzero_si256();
+
+   for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+   {
+      int64_t pa, pb;
+      __m256i coeff = scaler_load_taps_avx2(filter_a + x, filter_b + x);
+      __m256i col;
+
+      memcpy(&pa, input_a + x, sizeof(pa));
+      memcpy(&pb, input_b + x, sizeof(pb));
+
+      col = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_set_epi64x(pb, pa)), 7);
+      res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; x < ctx->horiz.filter_len; x++)
+   {
+      int16_t ta[2] = { filter_a[x], 0 };
+      int16_t tb[2] = { filter_b[x], 0 };
+      __m256i coeff = scaler_load_taps_avx2(ta, tb);
+      __m256i col   = _mm256_slli_epi16(_mm256_cvtepu8_epi16(
+               _mm_set_epi64x(input_b[x], input_a[x])), 7);
+
+      res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
+   }
+
+   return _mm256_adds_epi16(_mm256_srli_si256(res, 8), res);
+}
+
+static void scaler_argb8888_horiz_avx2(const struct scaler_ctx *ctx,
+      uint64_t *output, const void *input_, int stride, int rows)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   const int filter_stride = ctx->horiz.filter_stride;
+
+   for (h = 0; h < rows; h++, input += stride >> 2,
+         output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; (w + 1) < ctx->scaled.width; w += 2,
+            filter_horiz += filter_stride * 2)
+      {
+         __m256i res = scaler_horiz_pair_avx2(ctx,
+               input + ctx->horiz.filter_pos[w + 0], filter_horiz,
+               input + ctx->horiz.filter_pos[w + 1], filter_horiz + filter_stride);
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(
+                  _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0))));
+      }
+
+      if (w < ctx->scaled.width)
+      {
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         __m256i res = scaler_horiz_pair_avx2(ctx,
+               input_base_x, filter_horiz, input_base_x, filter_horiz);
+
+         _mm_storel_epi64((__m128i*)(output + w), _mm256_castsi256_si128(res));
+      }
+   }
+}
+
+static void scaler_argb8888_vert_avx2(const struct scaler_ctx *ctx,
+      void *output_, const uint64_t *const *taps, int row)
+{
+   int w, y;
+   uint32_t           *output = (uint32_t*)output_;
+   const int       filter_len = ctx->vert.filter_len;
+   const int16_t *filter_vert = ctx->vert.filter
+      + row * ctx->vert.filter_stride;
+
+   /* 8 pixels, even and odd taps summed apart like the SSE2 halves. */
+   for (w = 0; (w + 8) <= ctx->out_width; w += 8)
+   {
+      __m256i even_lo = _mm256_setzero_si256();
+      __m256i even_hi = _mm256_setzero_si256();
+      __m256i odd_lo  = _mm256_setzero_si256();
+      __m256i odd_hi  = _mm256_setzero_si256();
+      __m256i res_lo, res_hi;
+
+      for (y = 0; (y + 1) < filter_len; y += 2)
+      {
+         const __m256i c0     = _mm256_set1_epi16(filter_vert[y + 0]);
+         const __m256i c1     = _mm256_set1_epi16(filter_vert[y + 1]);
+         const uint64_t *row0 = taps[y + 0] + w;
+         const uint64_t *row1 = taps[y + 1] + w;
+
+         even_lo = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row0 + 0)), c0), even_lo);
+         even_hi = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row0 + 4)), c0), even_hi);
+         odd_lo  = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row1 + 0)), c1), odd_lo);
+         odd_hi  = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row1 + 4)), c1), odd_hi);
+      }
+
+      if (y < filter_len)
+      {
+         const __m256i c0     = _mm256_set1_epi16(filter_vert[y]);
+         const uint64_t *row0 = taps[y] + w;
+
+         even_lo = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row0 + 0)), c0), even_lo);
+         even_hi = _mm256_adds_epi16(_mm256_mulhi_epi16(
+                  _mm256_loadu_si256((const __m256i*)(row0 + 4)), c0), even_hi);
+      }
+
+      res_lo = _mm256_srai_epi16(_mm256_adds_epi16(odd_lo, even_lo), (7 - 2 - 2));
+      res_hi = _mm256_srai_epi16(_mm256_adds_epi16(odd_hi, even_hi), (7 - 2 - 2));
+
+      /* Per lane packing gives pixels 0 1 4 5 2 3 6 7. */
+      _mm256_storeu_si256((__m256i*)(output + w), _mm256_permute4x64_epi64(
+               _mm256_packus_epi16(res_lo, res_hi), _MM_SHUFFLE(3, 1, 2, 0)));
+   }
+
+   for (; w < ctx->out_width; w++)
+   {
+      __m128i even = _mm_setzero_si128();
+      __m128i odd  = _mm_setzero_si128();
+      __m128i res;
+
+      for (y = 0; (y + 1) < filter_len; y += 2)
+      {
+         even = _mm_adds_epi16(_mm_mulhi_epi16(
+                  _mm_loadl_epi64((const __m128i*)(taps[y + 0] + w)),
+                  _mm_set1_epi16(filter_vert[y + 0])), even);
+         odd  = _mm_adds_epi16(_mm_mulhi_epi16(
+                  _mm_loadl_epi64((const __m128i*)(taps[y + 1] + w)),
+                  _mm_set1_epi16(filter_vert[y + 1])), odd);
+      }
+
+      if (y < filter_len)
+         even = _mm_adds_epi16(_mm_mulhi_epi16(
+                  _mm_loadl_epi64((const __m128i*)(taps[y] + w)),
+                  _mm_set1_epi16(filter_vert[y])), even);
+
+      res       = _mm_srai_epi16(_mm_adds_epi16(odd, even), (7 - 2 - 2));
+      output[w] = _mm_cvtsi128_si32(_mm_packus_epi16(res, res));
+   }
+}
+#endif
+
+bool scaler_argb8888_select_avx2(struct scaler_ctx *ctx)
+{
+#if defined(__AVX2__)
+   ctx->scaler_horiz = scaler_argb8888_horiz_avx2;
+   ctx->scaler_vert  = scaler_argb8888_vert_avx2;
+   return true;
+#else
+   (void)ctx;
+   return false;
+#endif
+}
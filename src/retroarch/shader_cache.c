@@ -0,0 +1,188 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2016 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "shader_cache.h"
+#include "compat_strl.h"
+#include "rthreads.h"
+#include "retroarch.h"
+
+#define SHADER_CACHE_MAGIC 0x43534a50u /* "PJSC" */
+#define SHADER_CACHE_VERSION 1
+#define SHADER_CACHE_PATH_SIZE 1024
+
+struct shader_cache_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+    uint64_t hash;
+};
+
+static char shader_cache_dir[SHADER_CACHE_PATH_SIZE];
+
+uint64_t shader_cache_hash(const void* data, size_t size, uint64_t seed)
+{
+    size_t i;
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed;
+
+    for (i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+void shader_cache_set_dir(const char* dir)
+{
+    shader_cache_dir[0] = '\0';
+
+    if (!dir || !*dir)
+        return;
+
+    snprintf(shader_cache_dir, sizeof(shader_cache_dir), "%s/cache", dir);
+
+    /* Can fail if it already exists, any real problem shows up on store. */
+#ifdef _WIN32
+    CreateDirectoryA(shader_cache_dir, NULL);
+#else
+    mkdir(shader_cache_dir, 0755);
+#endif
+}
+
+static bool shader_cache_entry_path(char* path, size_t size,
+    const char* kind, uint64_t key)
+{
+    if (!*shader_cache_dir)
+        return false;
+
+    snprintf(path, size, "%s/%s-%016llx.bin",
+        shader_cache_dir, kind, (unsigned long long)key);
+    return true;
+}
+
+bool shader_cache_load(const char* kind, uint64_t key,
+    void** data, size_t* size)
+{
+    char path[SHADER_CACHE_PATH_SIZE];
+    struct shader_cache_header header;
+    void* payload = NULL;
+    FILE* file = NULL;
+
+    *data = NULL;
+    *size = 0;
+
+    if (!shader_cache_entry_path(path, sizeof(path), kind, key))
+        return false;
+
+    if (!(file = fopen(path, "rb")))
+        return false;
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || header.magic != SHADER_CACHE_MAGIC
+        || header.version != SHADER_CACHE_VERSION
+        || header.key != key
+        || header.size == 0
+        || header.size > SIZE_MAX)
+        goto error;
+
+    if (!(payload = malloc((size_t)header.size)))
+        goto error;
+
+    if (fread(payload, (size_t)header.size, 1, file) != 1)
+        goto error;
+
+    if (shader_cache_hash(payload, (size_t)header.size,
+        SHADER_CACHE_HASH_SEED) != header.hash)
+        goto error;
+
+    fclose(file);
+    *data = payload;
+    *size = (size_t)header.size;
+    return true;
+
+error:
+    RARCH_LOG("[Shader cache]: Discarding invalid entry \"%s\".\n", path);
+    free(payload);
+    fclose(file);
+    remove(path);
+    return false;
+}
+
+bool shader_cache_store(const char* kind, uint64_t key,
+    const void* data, size_t size)
+{
+    char path[SHADER_CACHE_PATH_SIZE];
+    char tmp_path[SHADER_CACHE_PATH_SIZE];
+    struct shader_cache_header header;
+    FILE* file = NULL;
+    bool written = false;
+
+    if (!data || !size)
+        return false;
+
+    if (!shader_cache_entry_path(path, sizeof(path), kind, key))
+        return false;
+
+    /* Unique per writer so parallel builds never share a temporary. */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%llx.tmp", path,
+        (unsigned long long)sthread_get_current_thread_id());
+
+    if (!(file = fopen(tmp_path, "wb")))
+        return false;
+
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.key = key;
+    header.size = size;
+    header.hash = shader_cache_hash(data, size, SHADER_CACHE_HASH_SEED);
+
+    written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(data, size, 1, file) == 1;
+
+    if (fclose(file) != 0)
+        written = false;
+
+    if (written)
+    {
+#ifdef _WIN32
+        written = MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        written = rename(tmp_path, path) == 0;
+#endif
+    }
+
+    if (!written)
+    {
+        RARCH_LOG("[Shader cache]: Failed to write \"%s\".\n", path);
+        remove(tmp_path);
+    }
+
+    return written;
+}
@@ -0,0 +1,88 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2016 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHADER_CACHE_H
+#define __SHADER_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Content addressed blob store for shader build products.
+ *
+ * Entries live in <dir>/<kind>-<key>.bin, where key is a 64-bit hash
+ * of whatever the blob was derived from. Every file carries a header
+ * with the key, the payload size and a payload hash, so truncated or
+ * stale files are rejected on load instead of being handed back. */
+
+#define SHADER_CACHE_HASH_SEED 0xcbf29ce484222325ull
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * shader_cache_hash:
+     * @data                : data to hash
+     * @size                : size of @data in bytes
+     * @seed                : previous hash to chain from, or SHADER_CACHE_HASH_SEED
+     *
+     * 64-bit FNV-1a over @data.
+     *
+     * Returns: hash of @data.
+     **/
+    uint64_t shader_cache_hash(const void* data, size_t size, uint64_t seed);
+
+    /**
+     * shader_cache_set_dir:
+     * @dir                 : parent directory of the cache, NULL or empty to disable
+     *
+     * Points the cache at @dir/cache, creating the directory if needed.
+     **/
+    void shader_cache_set_dir(const char* dir);
+
+    /**
+     * shader_cache_load:
+     * @kind                : short tag identifying the blob type
+     * @key                 : content hash the blob was stored under
+     * @data                : receives a malloc'ed copy of the payload
+     * @size                : receives the payload size
+     *
+     * Returns: true if a valid entry was found, caller frees @data.
+     **/
+    bool shader_cache_load(const char* kind, uint64_t key,
+        void** data, size_t* size);
+
+    /**
+     * shader_cache_store:
+     * @kind                : short tag identifying the blob type
+     * @key                 : content hash to store the blob under
+     * @data                : payload
+     * @size                : payload size in bytes
+     *
+     * Writes to a temporary file first and renames it into place,
+     * so a concurrent or interrupted writer never leaves a torn entry.
+     *
+     * Returns: true if the entry was written.
+     **/
+    bool shader_cache_store(const char* kind, uint64_t key,
+        const void* data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,9 +18,18 @@
 
 #include "vulkan_common.h"
 #include "slang_reflection.h"
+#include "video_shader_parse.h"
+#include "../screenshot/inc/png.h"
+#include "../parallel_for.h"
 
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -72,11 +81,141 @@ private:
     void* mapped = nullptr;
 };
 
-class Framebuffer
+/* Free render targets kept around before the oldest is destroyed. */
+#define FRAMEBUFFER_POOL_MAX_FREE 8
+
+/* Image, memory, views and VkFramebuffer backing one render target. */
+struct RenderTarget
+{
+    Size2D size = { 0, 0 };
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    unsigned levels = 0;
+
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkImageView fb_view = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize memory_size = 0;
+    uint32_t memory_type = 0;
+
+    /* Compute mipmapping, see MipmapGenerator. One view
+     * per level and one descriptor set per dispatch. */
+    std::vector<VkImageView> level_views;
+    VkDescriptorPool mip_pool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> mip_sets;
+};
+
+/* Levels written by one dispatch of vulkan_shaders/mipmap.comp. */
+#define MIPMAP_LEVELS_PER_DISPATCH 5
+
+/* Builds mip chains with a compute shader instead of a vkCmdBlitImage
+ * and a barrier per level. A workgroup keeps its tile in shared memory
+ * and writes up to five levels from it, so most chains take one
+ * dispatch and two barriers.
+ *
+ * Only used for formats which support storage images. Targets of those
+ * formats get their level views and descriptor sets once when they are
+ * created, recording a frame only binds and dispatches. */
+class MipmapGenerator
+{
+public:
+    MipmapGenerator(VkDevice device, VkPhysicalDevice gpu,
+        VkPipelineCache cache);
+    ~MipmapGenerator();
+
+    MipmapGenerator(MipmapGenerator&&) = delete;
+    void operator=(MipmapGenerator&&) = delete;
+
+    /* Extra image usage a target needs to take the compute path. */
+    VkImageUsageFlags get_usage(VkFormat format, unsigned levels) const;
+    void init_target(RenderTarget& target) const;
+
+    /* Expects level 0 in COLOR_ATTACHMENT_OPTIMAL and leaves every level
+     * in SHADER_READ_ONLY_OPTIMAL. Returns false if the target has to go
+     * through vulkan_framebuffer_generate_mips instead. */
+    bool generate(VkCommandBuffer cmd, const RenderTarget& target);
+
+private:
+    enum
+    {
+        MIPMAP_RGBA8 = 0,
+        MIPMAP_RGBA16F,
+        MIPMAP_RGBA32F,
+        MIPMAP_VARIANT_COUNT
+    };
+
+    VkDevice device;
+    VkPipelineCache cache;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline pipelines[MIPMAP_VARIANT_COUNT] = {};
+    bool supported[MIPMAP_VARIANT_COUNT] = {};
+
+    static int get_variant(VkFormat format);
+    bool init_pipeline(int variant);
+};
+
+/* Render targets keyed by size, format and level count.
+ *
+ * Viewport scaled passes change size whenever the window or aspect
+ * settings do. Instead of destroying and reallocating, released targets
+ * go back here once their sync index comes around again, so resizing
+ * back and forth reuses them. A miss still tries to recycle the memory
+ * of a free target before allocating. */
+class FramebufferPool
 {
 public:
-    Framebuffer(VkDevice device,
+    FramebufferPool(VkDevice device,
         const VkPhysicalDeviceMemoryProperties& mem_props,
+        const MipmapGenerator& mips);
+    ~FramebufferPool();
+
+    FramebufferPool(FramebufferPool&&) = delete;
+    void operator=(FramebufferPool&&) = delete;
+
+    RenderTarget acquire(const Size2D& size, VkFormat format,
+        unsigned levels, VkRenderPass render_pass);
+
+    /* The target may still be in flight, it only becomes
+     * available once the disposer runs for this sync index. */
+    void release(DeferredDisposer& disposer, const RenderTarget& target);
+    /* For targets the GPU is known to be done with. */
+    void release(const RenderTarget& target);
+
+    /* Bumped whenever a view is destroyed, since a new one
+     * may then come back with the same handle. */
+    unsigned get_generation() const { return generation; }
+
+private:
+    VkDevice device;
+    const VkPhysicalDeviceMemoryProperties& memory_properties;
+    const MipmapGenerator& mips;
+
+    /* Passes are built on several threads. */
+    std::mutex lock;
+    /* Oldest first. */
+    std::vector<RenderTarget> free_targets;
+    std::atomic<unsigned> generation{ 0 };
+
+    struct
+    {
+        unsigned hits = 0;
+        unsigned memory_reuses = 0;
+        unsigned allocations = 0;
+        unsigned evictions = 0;
+    } stats;
+
+    void destroy_views(RenderTarget& target);
+    void destroy(RenderTarget& target);
+};
+
+class Framebuffer
+{
+public:
+    Framebuffer(VkDevice device, FramebufferPool& pool,
         const Size2D& max_size, VkFormat format, unsigned max_levels);
 
     ~Framebuffer();
@@ -87,35 +226,24 @@ public:
 
     const Size2D& get_size() const { return size; }
     VkFormat get_format() const { return format; }
-    VkImage get_image() const { return image; }
-    VkImageView get_view() const { return view; }
-    VkFramebuffer get_framebuffer() const { return framebuffer; }
+    VkImage get_image() const { return target.image; }
+    VkImageView get_view() const { return target.view; }
+    VkFramebuffer get_framebuffer() const { return target.framebuffer; }
+    const RenderTarget& get_target() const { return target; }
     VkRenderPass get_render_pass() const { return render_pass; }
 
-    unsigned get_levels() const { return levels; }
+    unsigned get_levels() const { return target.levels; }
 
 private:
     Size2D size;
     VkFormat format;
     unsigned max_levels;
-    const VkPhysicalDeviceMemoryProperties& memory_properties;
+    FramebufferPool& pool;
     VkDevice device = VK_NULL_HANDLE;
-    VkImage image = VK_NULL_HANDLE;
-    VkImageView view = VK_NULL_HANDLE;
-    VkImageView fb_view = VK_NULL_HANDLE;
-    unsigned levels = 0;
-
-    VkFramebuffer framebuffer = VK_NULL_HANDLE;
     VkRenderPass render_pass = VK_NULL_HANDLE;
+    RenderTarget target;
 
-    struct
-    {
-        size_t size = 0;
-        uint32_t type = 0;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
-    } memory;
-
-    void init(DeferredDisposer* disposer);
+    void init();
 };
 
 class StaticTexture
@@ -174,6 +302,8 @@ struct CommonResources
     std::unordered_map<std::string, slang_texture_semantic_map> texture_semantic_map;
     std::unordered_map<std::string, slang_texture_semantic_map> texture_semantic_uniform_map;
     std::unique_ptr<video_shader> shader_preset;
+    FramebufferPool* framebuffer_pool = nullptr;
+    MipmapGenerator* mipmap_generator = nullptr;
 
     VkDevice device;
 };
@@ -242,6 +372,7 @@ public:
 
     void set_common_resources(CommonResources* c) { this->common = c; }
     const slang_reflection& get_reflection() const { return reflection; }
+    bool copies_source() const { return source_copy; }
     void set_pass_number(unsigned pass) { pass_number = pass; }
 
     void add_parameter(unsigned parameter_index, const std::string& id);
@@ -282,6 +413,9 @@ private:
     bool init_pipeline();
     bool init_pipeline_layout();
 
+    bool is_external(VkImage image) const;
+    void set_texture(VkDescriptorSet set, unsigned binding,
+        const Texture& texture);
     void set_semantic_texture(VkDescriptorSet set,
         slang_texture_semantic semantic,
         const Texture& texture);
@@ -290,6 +424,8 @@ private:
         const Texture& texture);
 
     slang_reflection reflection;
+    /* Shaders do nothing but write Source to the output. */
+    bool source_copy = false;
     void build_semantics(VkDescriptorSet set, uint8_t* buffer,
         const float* mvp, const Texture& original, const Texture& source);
     void build_semantic_vec4(uint8_t* data, slang_semantic semantic,
@@ -308,6 +444,35 @@ private:
     void build_semantic_texture_array(VkDescriptorSet set, uint8_t* buffer,
         slang_texture_semantic semantic, unsigned index, const Texture& texture);
 
+    void write_ubo(uint8_t* buffer, size_t offset,
+        const void* data, size_t size);
+    void reset_sync_states();
+
+    struct DescriptorState
+    {
+        VkImageView view = VK_NULL_HANDLE;
+        VkSampler sampler = VK_NULL_HANDLE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    /* What was last written for each sync index. Only this pass
+     * writes its UBO slice and descriptor sets, so semantics that
+     * did not change need neither a store nor a descriptor write. */
+    struct SyncState
+    {
+        std::vector<uint8_t> ubo;
+        DescriptorState textures[SLANG_NUM_BINDINGS];
+        unsigned generation = 0;
+        bool ubo_valid = false;
+        bool ubo_bound = false;
+    };
+    std::vector<SyncState> sync_states;
+
+    /* The chain input belongs to the frontend, which may
+     * recreate it under the same handle. Always rewritten,
+     * as are the earlier inputs bound as history. */
+    VkImage external_image = VK_NULL_HANDLE;
+
     uint64_t frame_count = 0;
     int32_t frame_direction = 1;
     unsigned frame_count_period = 0;
@@ -378,17 +543,46 @@ public:
 
     VkFormat get_pass_rt_format(unsigned pass);
 
+    /* The stock chain only scales the input to the viewport,
+     * so the frontend is free to replace it with a blit. */
+    inline void set_passthrough(bool enable)
+    {
+        passthrough = enable;
+    }
+
+    inline bool is_passthrough() const
+    {
+        return passthrough;
+    }
+
+    /* History is bound straight from earlier inputs, so the frontend
+     * keeps each input alive for this many frames after its own. */
+    inline unsigned get_history_size() const
+    {
+        return unsigned(original_history.size());
+    }
+
 private:
     VkDevice device;
     VkPhysicalDevice gpu;
     const VkPhysicalDeviceMemoryProperties& memory_properties;
     VkPipelineCache cache;
+    MipmapGenerator mipmap_generator;
+    /* Outlives every Framebuffer below, they hand their targets back to it. */
+    FramebufferPool framebuffer_pool;
     std::vector<std::unique_ptr<Pass>> passes;
     std::vector<vulkan_filter_chain_pass_info> pass_info;
     std::vector<std::vector<std::function<void()>>> deferred_calls;
     CommonResources common;
     VkFormat original_format;
 
+    /* Passes which would only copy their input are skipped,
+     * their consumers read the previous output directly. */
+    bool pass_fusion;
+    std::vector<bool> fused_passes;
+    uint64_t fused_bytes = 0;
+    uint64_t fused_frames = 0;
+
     vulkan_filter_chain_texture input_texture;
 
     Size2D max_input_size;
@@ -406,14 +600,35 @@ private:
     bool init_history();
     bool init_feedback();
     bool init_alias();
-    void update_history(DeferredDisposer& disposer, VkCommandBuffer cmd);
-    std::vector<std::unique_ptr<Framebuffer>> original_history;
+    bool build_passes();
+    bool can_fuse_pass(unsigned pass) const;
+    void init_fusion();
+    void update_history();
+    /* Ring of previous inputs, OriginalHistory[1] lives at history_head.
+     * A slot without an image has not seen a frame yet. */
+    std::vector<vulkan_filter_chain_texture> original_history;
+    unsigned history_head = 0;
+    /* Bound for the slots that have not seen a frame yet. */
+    std::unique_ptr<Framebuffer> history_blank;
     bool require_clear = false;
+    bool passthrough = false;
     void clear_history_and_feedback(VkCommandBuffer cmd);
     void update_feedback_info();
     void update_history_info();
 };
 
+static unsigned num_miplevels(unsigned width, unsigned height)
+{
+    unsigned size = std::max(width, height);
+    unsigned levels = 0;
+    while (size)
+    {
+        levels++;
+        size >>= 1;
+    }
+    return levels;
+}
+
 static uint32_t find_memory_type_fallback(
     const VkPhysicalDeviceMemoryProperties& mem_props,
     uint32_t device_reqs, uint32_t host_reqs)
@@ -557,103 +772,494 @@ CommonResources::~CommonResources()
                     vkDestroySampler(device, k, nullptr);
 }
 
-void Framebuffer::set_size(DeferredDisposer& disposer, const Size2D& size, VkFormat format)
+MipmapGenerator::MipmapGenerator(VkDevice device, VkPhysicalDevice gpu,
+    VkPipelineCache cache) :
+    device(device),
+    cache(cache)
 {
-    this->size = size;
-    if (format != VK_FORMAT_UNDEFINED)
-        this->format = format;
+    int i;
+    static const VkFormat formats[MIPMAP_VARIANT_COUNT] = {
+       VK_FORMAT_R8G8B8A8_UNORM,
+       VK_FORMAT_R16G16B16A16_SFLOAT,
+       VK_FORMAT_R32G32B32A32_SFLOAT,
+    };
+    VkDescriptorSetLayoutBinding bindings[2] = {
+       { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+         VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+       { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MIPMAP_LEVELS_PER_DISPATCH,
+         VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+    };
+    VkPushConstantRange push_range = {
+       VK_SHADER_STAGE_COMPUTE_BIT, 0, 3 * sizeof(uint32_t) };
+    VkSamplerCreateInfo sampler_info = {
+       VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+       VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    VkPipelineLayoutCreateInfo layout_info = {
+       VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
 
-    RARCH_LOG("[Vulkan filter chain]: Updating framebuffer size %ux%u (format: %u).\n",
-        size.width, size.height, (unsigned)this->format);
+    for (i = 0; i < MIPMAP_VARIANT_COUNT; i++)
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(gpu, formats[i], &props);
+        supported[i] =
+            (props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) &&
+            (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    }
+
+    /* Every view is a single level, so the
+     * source is always sampled at LOD 0. */
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxAnisotropy = 1.0f;
+    sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    vkCreateSampler(device, &sampler_info, nullptr, &sampler);
+
+    set_layout_info.bindingCount = 2;
+    set_layout_info.pBindings = bindings;
+    vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout);
+
+    layout_info.setLayoutCount = 1;
+    layout_info.pSetLayouts = &set_layout;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_range;
+    vkCreatePipelineLayout(device, &layout_info, nullptr, &pipeline_layout);
+}
+
+MipmapGenerator::~MipmapGenerator()
+{
+    for (auto pipeline : pipelines)
+        if (pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(device, pipeline, nullptr);
+    if (pipeline_layout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+    if (set_layout != VK_NULL_HANDLE)
+        vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+    if (sampler != VK_NULL_HANDLE)
+        vkDestroySampler(device, sampler, nullptr);
+}
 
+int MipmapGenerator::get_variant(VkFormat format)
+{
+    /* The image format qualifier of the shader has to match. */
+    switch (format)
     {
-        /* The current framebuffers, etc, might still be in use
-         * so defer deletion.
-         * We'll most likely be able to reuse the memory,
-         * so don't free it here.
-         *
-         * Fake lambda init captures for C++11.
-         */
-        VkDevice d = device;
-        VkImage i = image;
-        VkImageView v = view;
-        VkImageView fbv = fb_view;
-        VkFramebuffer fb = framebuffer;
-        disposer.defer([=]
-            {
-                if (fb != VK_NULL_HANDLE)
-                    vkDestroyFramebuffer(d, fb, nullptr);
-                if (v != VK_NULL_HANDLE)
-                    vkDestroyImageView(d, v, nullptr);
-                if (fbv != VK_NULL_HANDLE)
-                    vkDestroyImageView(d, fbv, nullptr);
-                if (i != VK_NULL_HANDLE)
-                    vkDestroyImage(d, i, nullptr);
-            });
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return MIPMAP_RGBA8;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return MIPMAP_RGBA16F;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return MIPMAP_RGBA32F;
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+VkImageUsageFlags MipmapGenerator::get_usage(VkFormat format,
+    unsigned levels) const
+{
+    int variant = get_variant(format);
+
+    if (levels < 2 || variant < 0 || !supported[variant])
+        return 0;
+    return VK_IMAGE_USAGE_STORAGE_BIT;
+}
+
+void MipmapGenerator::init_target(RenderTarget& target) const
+{
+    unsigned i, j;
+    unsigned dispatches = (target.levels - 1 + MIPMAP_LEVELS_PER_DISPATCH - 1)
+        / MIPMAP_LEVELS_PER_DISPATCH;
+    VkDescriptorPoolSize pool_sizes[2] = {
+       { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, dispatches },
+       { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+         dispatches * MIPMAP_LEVELS_PER_DISPATCH },
+    };
+    VkImageViewCreateInfo view_info = {
+       VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    VkDescriptorPoolCreateInfo pool_info = {
+       VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    VkDescriptorSetAllocateInfo alloc_info = {
+       VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = target.format;
+    view_info.image = target.image;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.layerCount = 1;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.components.r = VK_COMPONENT_SWIZZLE_R;
+    view_info.components.g = VK_COMPONENT_SWIZZLE_G;
+    view_info.components.b = VK_COMPONENT_SWIZZLE_B;
+    view_info.components.a = VK_COMPONENT_SWIZZLE_A;
+
+    target.level_views.resize(target.levels);
+    for (i = 0; i < target.levels; i++)
+    {
+        view_info.subresourceRange.baseMipLevel = i;
+        vkCreateImageView(device, &view_info, nullptr, &target.level_views[i]);
+    }
+
+    pool_info.maxSets = dispatches;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    vkCreateDescriptorPool(device, &pool_info, nullptr, &target.mip_pool);
+
+    alloc_info.descriptorPool = target.mip_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &set_layout;
+
+    target.mip_sets.resize(dispatches);
+    for (i = 0; i < dispatches; i++)
+    {
+        unsigned base = i * MIPMAP_LEVELS_PER_DISPATCH;
+        VkDescriptorImageInfo source_info;
+        VkDescriptorImageInfo level_info[MIPMAP_LEVELS_PER_DISPATCH];
+        VkWriteDescriptorSet writes[2] = {
+           { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+           { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+        };
+
+        vkAllocateDescriptorSets(device, &alloc_info, &target.mip_sets[i]);
+
+        /* Later dispatches read what the previous one wrote in GENERAL. */
+        source_info.sampler = sampler;
+        source_info.imageView = target.level_views[base];
+        source_info.imageLayout = base == 0
+            ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            : VK_IMAGE_LAYOUT_GENERAL;
+
+        /* Slots past the last level are never written by the shader,
+         * but have to hold a valid view. */
+        for (j = 0; j < MIPMAP_LEVELS_PER_DISPATCH; j++)
+        {
+            level_info[j].sampler = VK_NULL_HANDLE;
+            level_info[j].imageView = target.level_views[
+                std::min(base + 1 + j, target.levels - 1)];
+            level_info[j].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        writes[0].dstSet = target.mip_sets[i];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &source_info;
+
+        writes[1].dstSet = target.mip_sets[i];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = MIPMAP_LEVELS_PER_DISPATCH;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = level_info;
+
+        vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+    }
+}
+
+bool MipmapGenerator::init_pipeline(int variant)
+{
+    static const uint32_t mipmap_rgba8_comp[] =
+#include "vulkan_shaders/mipmap_rgba8.comp.inc"
+        ;
+    static const uint32_t mipmap_rgba16f_comp[] =
+#include "vulkan_shaders/mipmap_rgba16f.comp.inc"
+        ;
+    static const uint32_t mipmap_rgba32f_comp[] =
+#include "vulkan_shaders/mipmap_rgba32f.comp.inc"
+        ;
+    static const struct
+    {
+        const uint32_t* code;
+        size_t size;
+    } shaders[MIPMAP_VARIANT_COUNT] = {
+       { mipmap_rgba8_comp, sizeof(mipmap_rgba8_comp) },
+       { mipmap_rgba16f_comp, sizeof(mipmap_rgba16f_comp) },
+       { mipmap_rgba32f_comp, sizeof(mipmap_rgba32f_comp) },
+    };
+    VkShaderModuleCreateInfo module_info = {
+       VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    VkComputePipelineCreateInfo pipe = {
+       VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    VkResult res;
+
+    module_info.codeSize = shaders[variant].size;
+    module_info.pCode = shaders[variant].code;
+
+    pipe.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipe.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipe.stage.pName = "main";
+    pipe.layout = pipeline_layout;
+
+    if (vkCreateShaderModule(device, &module_info, nullptr,
+        &pipe.stage.module) != VK_SUCCESS)
+        return false;
+
+    res = vkCreateComputePipelines(device, cache, 1, &pipe, nullptr,
+        &pipelines[variant]);
+    vkDestroyShaderModule(device, pipe.stage.module, nullptr);
+
+    if (res != VK_SUCCESS)
+    {
+        /* Don't try again for every frame. */
+        pipelines[variant] = VK_NULL_HANDLE;
+        supported[variant] = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool MipmapGenerator::generate(VkCommandBuffer cmd, const RenderTarget& target)
+{
+    unsigned i;
+    int variant = get_variant(target.format);
+    VkImageMemoryBarrier barriers[2] = {
+       { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER },
+       { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER },
+    };
+
+    if (target.mip_sets.empty() || variant < 0 || !supported[variant])
+        return false;
+    if (pipelines[variant] == VK_NULL_HANDLE && !init_pipeline(variant))
+        return false;
+
+    /* Level 0 is sampled, the rest is written as storage. */
+    barriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = target.image;
+    barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barriers[0].subresourceRange.baseMipLevel = 0;
+    barriers[0].subresourceRange.levelCount = 1;
+    barriers[0].subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    barriers[1] = barriers[0];
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].subresourceRange.baseMipLevel = 1;
+    barriers[1].subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[variant]);
+
+    for (i = 0; i < target.mip_sets.size(); i++)
+    {
+        unsigned base = i * MIPMAP_LEVELS_PER_DISPATCH;
+        uint32_t push[3];
+
+        push[0] = std::max(target.size.width >> (base + 1), 1u);
+        push[1] = std::max(target.size.height >> (base + 1), 1u);
+        push[2] = std::min(target.levels - 1 - base,
+            unsigned(MIPMAP_LEVELS_PER_DISPATCH));
+
+        /* The last level of the previous dispatch is our source. */
+        if (i > 0)
+        {
+            VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(cmd,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+            pipeline_layout, 0, 1, &target.mip_sets[i], 0, nullptr);
+        vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(push), push);
+        vkCmdDispatch(cmd, (push[0] + 15) / 16, (push[1] + 15) / 16, 1);
     }
 
-    init(&disposer);
+    /* Level 0 keeps its layout. Its attachment writes were made available
+     * by the first barrier but only visible to compute, so it needs a
+     * visibility operation for the next pass's fragment reads too. */
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    barriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, barriers);
+    return true;
+}
+
+FramebufferPool::FramebufferPool(VkDevice device,
+    const VkPhysicalDeviceMemoryProperties& mem_props,
+    const MipmapGenerator& mips) :
+    device(device),
+    memory_properties(mem_props),
+    mips(mips)
+{
+}
+
+FramebufferPool::~FramebufferPool()
+{
+    for (auto& target : free_targets)
+        destroy(target);
+
+    RARCH_LOG("[Vulkan filter chain]: Framebuffer pool: %u hit(s),"
+        " %u memory reuse(s), %u allocation(s), %u eviction(s).\n",
+        stats.hits, stats.memory_reuses, stats.allocations, stats.evictions);
+}
+
+void FramebufferPool::destroy_views(RenderTarget& target)
+{
+    generation++;
+    for (auto level_view : target.level_views)
+        vkDestroyImageView(device, level_view, nullptr);
+    if (target.mip_pool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(device, target.mip_pool, nullptr);
+    if (target.framebuffer != VK_NULL_HANDLE)
+        vkDestroyFramebuffer(device, target.framebuffer, nullptr);
+    if (target.view != VK_NULL_HANDLE)
+        vkDestroyImageView(device, target.view, nullptr);
+    if (target.fb_view != VK_NULL_HANDLE)
+        vkDestroyImageView(device, target.fb_view, nullptr);
+    if (target.image != VK_NULL_HANDLE)
+        vkDestroyImage(device, target.image, nullptr);
+
+    target.level_views.clear();
+    target.mip_pool = VK_NULL_HANDLE;
+    target.mip_sets.clear();
+    target.framebuffer = VK_NULL_HANDLE;
+    target.view = VK_NULL_HANDLE;
+    target.fb_view = VK_NULL_HANDLE;
+    target.image = VK_NULL_HANDLE;
+}
+
+void FramebufferPool::destroy(RenderTarget& target)
+{
+    destroy_views(target);
+    if (target.memory != VK_NULL_HANDLE)
+        vkFreeMemory(device, target.memory, nullptr);
+    target.memory = VK_NULL_HANDLE;
 }
 
-void Framebuffer::init(DeferredDisposer* disposer)
+RenderTarget FramebufferPool::acquire(const Size2D& size, VkFormat format,
+    unsigned levels, VkRenderPass render_pass)
 {
+    RenderTarget target;
     VkMemoryRequirements mem_reqs;
     VkImageCreateInfo info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
     VkMemoryAllocateInfo alloc = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
     VkImageViewCreateInfo view_info = {
        VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    VkFramebufferCreateInfo fb_info = {
+       VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        /* Render passes of the same format are compatible, so the
+         * VkFramebuffer can be handed over as is. */
+        for (auto itr = free_targets.begin(); itr != free_targets.end(); ++itr)
+        {
+            if (itr->size.width == size.width
+                && itr->size.height == size.height
+                && itr->format == format
+                && itr->levels == levels)
+            {
+                target = *itr;
+                free_targets.erase(itr);
+                stats.hits++;
+                return target;
+            }
+        }
+    }
+
+    target.size = size;
+    target.format = format;
+    target.levels = levels;
 
     info.imageType = VK_IMAGE_TYPE_2D;
     info.format = format;
     info.extent.width = size.width;
     info.extent.height = size.height;
     info.extent.depth = 1;
-    info.mipLevels = 0; // std::min(max_levels, glslang_num_miplevels(size.width, size.height));
+    info.mipLevels = levels;
     info.arrayLayers = 1;
     info.samples = VK_SAMPLE_COUNT_1_BIT;
     info.tiling = VK_IMAGE_TILING_OPTIMAL;
     info.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
         VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+        mips.get_usage(format, levels);
 
     info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    levels = info.mipLevels;
 
-    vkCreateImage(device, &info, nullptr, &image);
+    vkCreateImage(device, &info, nullptr, &target.image);
 
-    vkGetImageMemoryRequirements(device, image, &mem_reqs);
+    vkGetImageMemoryRequirements(device, target.image, &mem_reqs);
 
     alloc.allocationSize = mem_reqs.size;
     alloc.memoryTypeIndex = find_memory_type_fallback(
         memory_properties, mem_reqs.memoryTypeBits,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    /* Can reuse already allocated memory. */
-    if (memory.size < mem_reqs.size || memory.type != alloc.memoryTypeIndex)
+    /* Take over the smallest free allocation that fits,
+     * which covers the common case of shrinking. */
     {
-        /* Memory might still be in use since we don't want
-         * to totally stall
-         * the world for framebuffer recreation. */
-        if (memory.memory != VK_NULL_HANDLE && disposer)
+        std::lock_guard<std::mutex> guard(lock);
+        auto best = free_targets.end();
+
+        for (auto itr = free_targets.begin(); itr != free_targets.end(); ++itr)
         {
-            VkDevice       d = device;
-            VkDeviceMemory m = memory.memory;
-            disposer->defer([=] { vkFreeMemory(d, m, nullptr); });
+            if (itr->memory_type == alloc.memoryTypeIndex
+                && itr->memory_size >= mem_reqs.size
+                && (best == free_targets.end()
+                    || itr->memory_size < best->memory_size))
+                best = itr;
         }
 
-        memory.type = alloc.memoryTypeIndex;
-        memory.size = mem_reqs.size;
+        if (best != free_targets.end())
+        {
+            destroy_views(*best);
+            target.memory = best->memory;
+            target.memory_size = best->memory_size;
+            target.memory_type = best->memory_type;
+            free_targets.erase(best);
+            stats.memory_reuses++;
+        }
+        else
+            stats.allocations++;
+    }
 
-        vkAllocateMemory(device, &alloc, nullptr, &memory.memory);
+    if (target.memory == VK_NULL_HANDLE)
+    {
+        target.memory_type = alloc.memoryTypeIndex;
+        target.memory_size = mem_reqs.size;
+        vkAllocateMemory(device, &alloc, nullptr, &target.memory);
     }
 
-    vkBindImageMemory(device, image, memory.memory, 0);
+    vkBindImageMemory(device, target.image, target.memory, 0);
 
     view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
     view_info.format = format;
-    view_info.image = image;
+    view_info.image = target.image;
     view_info.subresourceRange.baseMipLevel = 0;
     view_info.subresourceRange.baseArrayLayer = 0;
     view_info.subresourceRange.levelCount = levels;
@@ -664,56 +1270,128 @@ void Framebuffer::init(DeferredDisposer* disposer)
     view_info.components.b = VK_COMPONENT_SWIZZLE_B;
     view_info.components.a = VK_COMPONENT_SWIZZLE_A;
 
-    vkCreateImageView(device, &view_info, nullptr, &view);
+    vkCreateImageView(device, &view_info, nullptr, &target.view);
     view_info.subresourceRange.levelCount = 1;
-    vkCreateImageView(device, &view_info, nullptr, &fb_view);
+    vkCreateImageView(device, &view_info, nullptr, &target.fb_view);
 
-    /* Initialize framebuffer */
-    {
-        VkFramebufferCreateInfo info = {
-           VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
-        info.renderPass = render_pass;
-        info.attachmentCount = 1;
-        info.pAttachments = &fb_view;
-        info.width = size.width;
-        info.height = size.height;
-        info.layers = 1;
+    fb_info.renderPass = render_pass;
+    fb_info.attachmentCount = 1;
+    fb_info.pAttachments = &target.fb_view;
+    fb_info.width = size.width;
+    fb_info.height = size.height;
+    fb_info.layers = 1;
+
+    vkCreateFramebuffer(device, &fb_info, nullptr, &target.framebuffer);
+
+    if (info.usage & VK_IMAGE_USAGE_STORAGE_BIT)
+        mips.init_target(target);
+    return target;
+}
+
+void FramebufferPool::release(DeferredDisposer& disposer,
+    const RenderTarget& target)
+{
+    FramebufferPool* pool = this;
+    disposer.defer([=] { pool->release(target); });
+}
+
+void FramebufferPool::release(const RenderTarget& target)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (target.image == VK_NULL_HANDLE)
+        return;
+
+    free_targets.push_back(target);
 
-        vkCreateFramebuffer(device, &info, nullptr, &framebuffer);
+    /* Enough for every pass to bounce between two sizes. */
+    while (free_targets.size() > FRAMEBUFFER_POOL_MAX_FREE)
+    {
+        destroy(free_targets.front());
+        free_targets.erase(free_targets.begin());
+        stats.evictions++;
     }
 }
 
+void Framebuffer::set_size(DeferredDisposer& disposer, const Size2D& size, VkFormat format)
+{
+    this->size = size;
+    if (format != VK_FORMAT_UNDEFINED)
+        this->format = format;
+
+    RARCH_LOG("[Vulkan filter chain]: Updating framebuffer size %ux%u (format: %u).\n",
+        size.width, size.height, (unsigned)this->format);
+
+    /* The current target might still be in use, so it only
+     * goes back to the pool once this sync index comes around. */
+    pool.release(disposer, target);
+    init();
+}
+
+void Framebuffer::init()
+{
+    target = pool.acquire(size, format,
+        std::min(max_levels, num_miplevels(size.width, size.height)),
+        render_pass);
+}
+
 Framebuffer::Framebuffer(
     VkDevice device,
-    const VkPhysicalDeviceMemoryProperties& mem_props,
+    FramebufferPool& pool,
     const Size2D& max_size, VkFormat format,
     unsigned max_levels) :
     size(max_size),
     format(format),
     max_levels(std::max(max_levels, 1u)),
-    memory_properties(mem_props),
+    pool(pool),
     device(device)
 {
     RARCH_LOG("[Vulkan filter chain]: Creating framebuffer %ux%u (max %u level(s)).\n",
         max_size.width, max_size.height, max_levels);
     vulkan_initialize_render_pass(device, format, &render_pass);
-    init(nullptr);
+    init();
 }
 
+/* Framebuffers are only torn down with the device idle,
+ * so the target can go straight back to the pool. */
 Framebuffer::~Framebuffer()
 {
-    if (framebuffer != VK_NULL_HANDLE)
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    pool.release(target);
     if (render_pass != VK_NULL_HANDLE)
         vkDestroyRenderPass(device, render_pass, nullptr);
-    if (view != VK_NULL_HANDLE)
-        vkDestroyImageView(device, view, nullptr);
-    if (fb_view != VK_NULL_HANDLE)
-        vkDestroyImageView(device, fb_view, nullptr);
-    if (image != VK_NULL_HANDLE)
-        vkDestroyImage(device, image, nullptr);
-    if (memory.memory != VK_NULL_HANDLE)
-        vkFreeMemory(device, memory.memory, nullptr);
+}
+
+StaticTexture::StaticTexture(std::string id,
+    VkDevice device,
+    VkImage image,
+    VkImageView view,
+    VkDeviceMemory memory,
+    std::unique_ptr<Buffer> buffer,
+    unsigned width, unsigned height,
+    bool linear,
+    bool mipmap,
+    glslang_filter_chain_address address)
+    : device(device),
+    image(image),
+    view(view),
+    memory(memory),
+    buffer(std::move(buffer)),
+    id(std::move(id))
+{
+    texture.filter = GLSLANG_FILTER_CHAIN_NEAREST;
+    texture.mip_filter = GLSLANG_FILTER_CHAIN_NEAREST;
+    texture.address = address;
+    texture.texture.image = image;
+    texture.texture.view = view;
+    texture.texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    texture.texture.width = width;
+    texture.texture.height = height;
+    texture.texture.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    if (linear)
+        texture.filter = GLSLANG_FILTER_CHAIN_LINEAR;
+    if (mipmap && linear)
+        texture.mip_filter = GLSLANG_FILTER_CHAIN_LINEAR;
 }
 
 StaticTexture::~StaticTexture()
@@ -1031,7 +1709,7 @@ bool Pass::build()
 
     if (!final_pass)
         framebuffer = std::unique_ptr<Framebuffer>(
-            new Framebuffer(device, memory_properties,
+            new Framebuffer(device, *common->framebuffer_pool,
                 current_framebuffer_size,
                 pass_info.rt_format, pass_info.max_levels));
 
@@ -1054,6 +1732,9 @@ bool Pass::build()
     if (!slang_reflect_spirv(vertex_shader, fragment_shader, &reflection))
         return false;
 
+    source_copy = !final_pass && slang_spirv_is_passthrough(
+        vertex_shader, fragment_shader, reflection);
+
     /* Filter out parameters which we will never use anyways. */
     filtered_parameters.clear();
 
@@ -1167,6 +1848,18 @@ void Pass::allocate_buffers()
         /* Allocate */
         common->ubo_offset += reflection.ubo_size;
     }
+
+    /* Fresh UBO and descriptor sets, nothing has been written yet. */
+    reset_sync_states();
+}
+
+void Pass::reset_sync_states()
+{
+    sync_states.clear();
+    sync_states.resize(num_sync_indices);
+
+    for (auto& state : sync_states)
+        state.ubo.resize(reflection.ubo_size);
 }
 
 void Pass::set_shader(VkShaderStageFlags stage,
@@ -1218,13 +1911,17 @@ void Pass::build_commands(
 
     build_semantics(sets[sync_index], u, mvp, original, source);
 
-    if (reflection.ubo_stage_mask)
+    /* The UBO range of a sync index is fixed until the chain is rebuilt. */
+    if (reflection.ubo_stage_mask && !sync_states[sync_index].ubo_bound)
+    {
         vulkan_set_uniform_buffer(device,
             sets[sync_index],
             reflection.ubo_binding,
             common->ubo->get_buffer(),
             ubo_offset + sync_index * common->ubo_sync_index_stride,
             reflection.ubo_size);
+        sync_states[sync_index].ubo_bound = true;
+    }
 
     /* The final pass is always executed inside
      * another render pass since the frontend will
@@ -1322,12 +2019,16 @@ void Pass::build_commands(
         vkCmdEndRenderPass(cmd);
 
         if (framebuffer->get_levels() > 1)
-            vulkan_framebuffer_generate_mips(
-                framebuffer->get_framebuffer(),
-                framebuffer->get_image(),
-                framebuffer->get_size(),
-                cmd,
-                framebuffer->get_levels());
+        {
+            if (!common->mipmap_generator->generate(cmd,
+                framebuffer->get_target()))
+                vulkan_framebuffer_generate_mips(
+                    framebuffer->get_framebuffer(),
+                    framebuffer->get_image(),
+                    framebuffer->get_size(),
+                    cmd,
+                    framebuffer->get_levels());
+        }
         else
         {
             /* Barrier to sync with next pass. */
@@ -1353,6 +2054,24 @@ void Pass::end_frame()
         swap(framebuffer, fb_feedback);
 }
 
+bool Pass::init_feedback()
+{
+    if (final_pass)
+        return false;
+
+    fb_feedback = std::unique_ptr<Framebuffer>(
+        new Framebuffer(device, *common->framebuffer_pool,
+            current_framebuffer_size,
+            pass_info.rt_format,
+            pass_info.max_levels));
+    return true;
+}
+
+void Pass::add_parameter(unsigned index, const std::string& id)
+{
+    parameters.push_back({ id, index, unsigned(parameters.size()) });
+}
+
 static void build_identity_matrix(float* data)
 {
     data[0] = 1.0f;
@@ -1377,15 +2096,31 @@ void Pass::build_semantics(VkDescriptorSet set, uint8_t* buffer,
     const float* mvp, const Texture& original, const Texture& source)
 {
     unsigned i;
+    float identity[16];
+    SyncState& state = sync_states[sync_index];
+    unsigned generation = common->framebuffer_pool->get_generation();
+
+    /* A view we cached may have been destroyed, and a new one
+     * handed out under the same handle. */
+    if (state.generation != generation)
+    {
+        for (auto& texture : state.textures)
+            texture = DescriptorState();
+        state.generation = generation;
+    }
+
+    external_image = original.texture.image;
 
     /* MVP */
     if (buffer && reflection.semantics[SLANG_SEMANTIC_MVP].uniform)
     {
         size_t offset = reflection.semantics[SLANG_SEMANTIC_MVP].ubo_offset;
-        if (mvp)
-            memcpy(buffer + offset, mvp, sizeof(float) * 16);
-        else
-            build_identity_matrix(reinterpret_cast<float*>(buffer + offset));
+        if (!mvp)
+        {
+            build_identity_matrix(identity);
+            mvp = identity;
+        }
+        write_ubo(buffer, offset, mvp, sizeof(float) * 16);
     }
 
     if (reflection.semantics[SLANG_SEMANTIC_MVP].push_constant)
@@ -1451,15 +2186,63 @@ void Pass::build_semantics(VkDescriptorSet set, uint8_t* buffer,
         build_semantic_texture_array(set, buffer,
             SLANG_TEXTURE_SEMANTIC_USER, i,
             common->luts[i]->get_texture());
+
+    if (buffer)
+        state.ubo_valid = true;
+}
+
+void Pass::write_ubo(uint8_t* buffer, size_t offset,
+    const void* data, size_t size)
+{
+    SyncState& state = sync_states[sync_index];
+    uint8_t* shadow = state.ubo.data() + offset;
+
+    if (state.ubo_valid && !memcmp(shadow, data, size))
+        return;
+
+    memcpy(shadow, data, size);
+    memcpy(buffer + offset, data, size);
+}
+
+bool Pass::is_external(VkImage image) const
+{
+    unsigned i;
+
+    if (image == external_image)
+        return true;
+
+    for (i = 0; i < common->original_history.size(); i++)
+        if (common->original_history[i].texture.image == image)
+            return true;
+
+    return false;
+}
+
+void Pass::set_texture(VkDescriptorSet set, unsigned binding,
+    const Texture& texture)
+{
+    VkSampler sampler = common->samplers[texture.filter][texture.mip_filter][texture.address];
+    DescriptorState& state = sync_states[sync_index].textures[binding];
+    bool external = is_external(texture.texture.image);
+
+    if (!external
+        && state.view == texture.texture.view
+        && state.sampler == sampler
+        && state.layout == texture.texture.layout)
+        return;
+
+    VULKAN_PASS_SET_TEXTURE(device, set, sampler, binding, texture.texture.view, texture.texture.layout);
+
+    state.view = external ? VK_NULL_HANDLE : texture.texture.view;
+    state.sampler = sampler;
+    state.layout = texture.texture.layout;
 }
 
 void Pass::set_semantic_texture(VkDescriptorSet set,
     slang_texture_semantic semantic, const Texture& texture)
 {
     if (reflection.semantic_textures[semantic][0].texture)
-    {
-        VULKAN_PASS_SET_TEXTURE(device, set, common->samplers[texture.filter][texture.mip_filter][texture.address], reflection.semantic_textures[semantic][0].binding, texture.texture.view, texture.texture.layout);
-    }
+        set_texture(set, reflection.semantic_textures[semantic][0].binding, texture);
 }
 
 void Pass::set_semantic_texture_array(VkDescriptorSet set,
@@ -1468,9 +2251,7 @@ void Pass::set_semantic_texture_array(VkDescriptorSet set,
 {
     if (index < reflection.semantic_textures[semantic].size() &&
         reflection.semantic_textures[semantic][index].texture)
-    {
-        VULKAN_PASS_SET_TEXTURE(device, set, common->samplers[texture.filter][texture.mip_filter][texture.address], reflection.semantic_textures[semantic][index].binding, texture.texture.view, texture.texture.layout);
-    }
+        set_texture(set, reflection.semantic_textures[semantic][index].binding, texture);
 }
 
 void Pass::build_semantic_texture_array_vec4(uint8_t* data, slang_texture_semantic semantic,
@@ -1483,11 +2264,12 @@ void Pass::build_semantic_texture_array_vec4(uint8_t* data, slang_texture_semant
 
     if (data && refl[index].uniform)
     {
-        float* _data = reinterpret_cast<float*>(data + refl[index].ubo_offset);
+        float _data[4];
         _data[0] = (float)(width);
         _data[1] = (float)(height);
         _data[2] = 1.0f / (float)(width);
         _data[3] = 1.0f / (float)(height);
+        write_ubo(data, refl[index].ubo_offset, _data, sizeof(_data));
     }
 
     if (refl[index].push_constant)
@@ -1513,11 +2295,12 @@ void Pass::build_semantic_vec4(uint8_t* data, slang_semantic semantic,
 
     if (data && refl.uniform)
     {
-        float* _data = reinterpret_cast<float*>(data + refl.ubo_offset);
+        float _data[4];
         _data[0] = (float)(width);
         _data[1] = (float)(height);
         _data[2] = 1.0f / (float)(width);
         _data[3] = 1.0f / (float)(height);
+        write_ubo(data, refl.ubo_offset, _data, sizeof(_data));
     }
 
     if (refl.push_constant)
@@ -1537,7 +2320,7 @@ void Pass::build_semantic_parameter(uint8_t* data, unsigned index, float value)
 
     /* We will have filtered out stale parameters. */
     if (data && refl.uniform)
-        *reinterpret_cast<float*>(data + refl.ubo_offset) = value;
+        write_ubo(data, refl.ubo_offset, &value, sizeof(value));
 
     if (refl.push_constant)
         *reinterpret_cast<float*>(push.buffer.data() + (refl.push_constant_offset >> 2)) = value;
@@ -1549,7 +2332,7 @@ void Pass::build_semantic_uint(uint8_t* data, slang_semantic semantic,
     auto& refl = reflection.semantics[semantic];
 
     if (data && refl.uniform)
-        *reinterpret_cast<uint32_t*>(data + reflection.semantics[semantic].ubo_offset) = value;
+        write_ubo(data, refl.ubo_offset, &value, sizeof(value));
 
     if (refl.push_constant)
         *reinterpret_cast<uint32_t*>(push.buffer.data() + (refl.push_constant_offset >> 2)) = value;
@@ -1561,7 +2344,7 @@ void Pass::build_semantic_int(uint8_t* data, slang_semantic semantic,
     auto& refl = reflection.semantics[semantic];
 
     if (data && refl.uniform)
-        *reinterpret_cast<int32_t*>(data + reflection.semantics[semantic].ubo_offset) = value;
+        write_ubo(data, refl.ubo_offset, &value, sizeof(value));
 
     if (refl.push_constant)
         *reinterpret_cast<int32_t*>(push.buffer.data() + (refl.push_constant_offset >> 2)) = value;
@@ -1694,8 +2477,8 @@ bool vulkan_filter_chain::init_feedback()
             }
         }
 
-        //if (use_feedback && !passes[i]->init_feedback())
-        //    return false;
+        if (use_feedback && !passes[i]->init_feedback())
+            return false;
 
         if (use_feedback)
             RARCH_LOG("[Vulkan filter chain]: Using framebuffer feedback for pass #%u.\n", i);
@@ -1721,6 +2504,8 @@ bool vulkan_filter_chain::init_history()
 
     original_history.clear();
     common.original_history.clear();
+    history_blank.reset();
+    history_head = 0;
 
     for (i = 0; i < passes.size(); i++)
         required_images =
@@ -1739,12 +2524,10 @@ bool vulkan_filter_chain::init_history()
     /* We don't need to store array element #0,
      * since it's aliased with the actual original. */
     required_images--;
-    original_history.reserve(required_images);
+    original_history.resize(required_images);
     common.original_history.resize(required_images);
-
-    for (i = 0; i < required_images; i++)
-        original_history.emplace_back(new Framebuffer(device, memory_properties,
-            max_input_size, original_format, 1));
+    history_blank.reset(new Framebuffer(device, framebuffer_pool,
+        { 1, 1 }, original_format, 1));
 
 #ifdef VULKAN_DEBUG
     RARCH_LOG("[Vulkan filter chain]: Using history of %u frames.\n", unsigned(required_images));
@@ -1761,7 +2544,9 @@ bool vulkan_filter_chain::init_history()
 bool vulkan_filter_chain::init()
 {
     unsigned i;
+    unsigned cached_passes = 0;
     Size2D source = max_input_size;
+    auto start = std::chrono::steady_clock::now();
 
     if (!init_alias())
         return false;
@@ -1777,8 +2562,21 @@ bool vulkan_filter_chain::init()
 #endif
         source = passes[i]->set_pass_info(max_input_size,
             source, swapchain_info, pass_info[i]);
-        if (!passes[i]->build())
-            return false;
+    }
+
+    /* Only sizing depends on the previous pass, which set_pass_info()
+     * already resolved, so reflection and pipeline creation are spread
+     * over a few threads and joined before anything can record a frame.
+     * The passes do share state: the framebuffer pool, which locks, the
+     * on-disk shader cache, which writes through per-thread temporaries,
+     * and the VkPipelineCache, which the driver synchronizes. */
+    if (!build_passes())
+        return false;
+
+    for (i = 0; i < passes.size(); i++)
+    {
+        if (passes[i]->get_reflection().cached)
+            cached_passes++;
     }
 
     require_clear = false;
@@ -1789,6 +2587,142 @@ bool vulkan_filter_chain::init()
     if (!init_feedback())
         return false;
     common.pass_outputs.resize(passes.size());
+    init_fusion();
+
+    RARCH_LOG("[Vulkan filter chain]: Built %u pass(es) in %.2f ms,"
+        " %u reflected from cache.\n",
+        unsigned(passes.size()),
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(),
+        cached_passes);
+    return true;
+}
+
+static unsigned vulkan_filter_chain_format_size(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+        return 1;
+
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_UINT:
+    case VK_FORMAT_R8G8_SINT:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16_SINT:
+    case VK_FORMAT_R16_SFLOAT:
+        return 2;
+
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_SFLOAT:
+        return 8;
+
+    case VK_FORMAT_R32G32B32A32_UINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return 16;
+
+    default:
+        break;
+    }
+
+    return 4;
+}
+
+/* Skipping a pass is only safe when running it would reproduce
+ * its input exactly: the shaders copy Source, texel for texel,
+ * into the format Source already has. */
+bool vulkan_filter_chain::can_fuse_pass(unsigned pass) const
+{
+    const vulkan_filter_chain_pass_info& info = pass_info[pass];
+    VkFormat input_format = pass ? pass_info[pass - 1].rt_format : original_format;
+    unsigned input_levels = pass ? pass_info[pass - 1].max_levels : 1;
+
+    /* The final pass renders to the swapchain. */
+    if (pass + 1 >= passes.size() || !passes[pass]->copies_source())
+        return false;
+
+    if (info.scale_type_x != GLSLANG_FILTER_CHAIN_SCALE_SOURCE
+        || info.scale_type_y != GLSLANG_FILTER_CHAIN_SCALE_SOURCE
+        || info.scale_x != 1.0f || info.scale_y != 1.0f)
+        return false;
+
+    /* Linear taps at texel centers are exact on paper,
+     * but rely on the sub-texel precision of the hardware. */
+    if (info.source_filter != GLSLANG_FILTER_CHAIN_NEAREST)
+        return false;
+
+    if (info.max_levels > 1 || input_levels > 1)
+        return false;
+
+    /* sRGB round trips through linear on the way. */
+    if (info.rt_format != input_format
+        || info.rt_format == VK_FORMAT_R8G8B8A8_SRGB)
+        return false;
+
+    /* PassFeedback of this pass is its own output one frame ago. */
+    return !passes[pass]->get_feedback_framebuffer();
+}
+
+void vulkan_filter_chain::init_fusion()
+{
+    unsigned i;
+    unsigned fused = 0;
+    uint64_t bytes = 0;
+
+    fused_passes.assign(passes.size(), false);
+
+    if (!pass_fusion)
+        return;
+
+    for (i = 0; i < passes.size(); i++)
+    {
+        if (!can_fuse_pass(i))
+            continue;
+
+        /* One write and one read of the largest target per frame. */
+        const Size2D& size = passes[i]->get_framebuffer().get_size();
+        bytes += 2ull * size.width * size.height
+            * vulkan_filter_chain_format_size(pass_info[i].rt_format);
+
+        fused_passes[i] = true;
+        fused++;
+
+        RARCH_LOG("[Vulkan filter chain]: Pass #%u (%s) only copies its input,"
+            " fusing it into pass #%u.\n", i, passes[i]->get_name().c_str(), i + 1);
+    }
+
+    if (fused)
+        RARCH_LOG("[Vulkan filter chain]: Pass fusion skips %u pass(es),"
+            " saving up to %.2f MiB of render target traffic per frame.\n",
+            fused, bytes / (1024.0 * 1024.0));
+}
+
+bool vulkan_filter_chain::build_passes()
+{
+    unsigned i;
+    std::unique_ptr<bool[]> built(new bool[passes.size()]());
+
+    /* A single pass or a single core never spawns anything. */
+    parallel_for(unsigned(passes.size()), [&](unsigned index) {
+        built[index] = passes[index]->build();
+    });
+
+    for (i = 0; i < passes.size(); i++)
+    {
+        if (!built[i])
+        {
+            RARCH_LOG("[Vulkan filter chain]: Failed to build pass #%u.\n", i);
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -1834,6 +2768,7 @@ void vulkan_filter_chain::build_offscreen_passes(VkCommandBuffer cmd,
 {
     unsigned i;
     Texture source;
+    bool fused = false;
 
     /* First frame, make sure our history and feedback textures
      * are in a clean state. */
@@ -1858,21 +2793,36 @@ void vulkan_filter_chain::build_offscreen_passes(VkCommandBuffer cmd,
 
     for (i = 0; i < passes.size() - 1; i++)
     {
-        passes[i]->build_commands(disposer, cmd,
-            original, source, vp, nullptr);
+        /* The input is forwarded untouched, PassOutput#i included.
+         * The frontend may hand over another input format at runtime. */
+        if (fused_passes[i] && (i || input_texture.format == original_format))
+        {
+            fused_bytes += 2ull * source.texture.width * source.texture.height
+                * vulkan_filter_chain_format_size(pass_info[i].rt_format);
+            fused = true;
+        }
+        else
+        {
+            passes[i]->build_commands(disposer, cmd,
+                original, source, vp, nullptr);
 
-        const Framebuffer& fb = passes[i]->get_framebuffer();
+            const Framebuffer& fb = passes[i]->get_framebuffer();
+
+            source.texture.view = fb.get_view();
+            source.texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            source.texture.width = fb.get_size().width;
+            source.texture.height = fb.get_size().height;
+        }
 
-        source.texture.view = fb.get_view();
-        source.texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        source.texture.width = fb.get_size().width;
-        source.texture.height = fb.get_size().height;
         source.filter = passes[i + 1]->get_source_filter();
         source.mip_filter = passes[i + 1]->get_mip_filter();
         source.address = passes[i + 1]->get_address_mode();
 
         common.pass_outputs[i] = source;
     }
+
+    if (fused)
+        fused_frames++;
 }
 
 void vulkan_filter_chain::build_viewport_pass(
@@ -1906,6 +2856,8 @@ void vulkan_filter_chain::build_viewport_pass(
            passes.back()->get_address_mode(),
         };
     }
+    else if (fused_passes[passes.size() - 2])
+        source = common.pass_outputs[passes.size() - 2];
     else
     {
         const Framebuffer& fb = passes[passes.size() - 2]->get_framebuffer();
@@ -1928,22 +2880,19 @@ void vulkan_filter_chain::build_viewport_pass(
 
 void vulkan_filter_chain::end_frame(VkCommandBuffer cmd)
 {
-    /* If we need to keep old frames, copy it after fragment is complete.
-     * TODO: We can improve pipelining by figuring out which
-     * pass is the last that reads from
-     * the history and dispatch the copy earlier. */
+    (void)cmd;
+
     if (!original_history.empty())
-    {
-        DeferredDisposer disposer(deferred_calls[current_sync_index]);
-        update_history(disposer, cmd);
-    }
+        update_history();
 }
 
 void vulkan_filter_chain::clear_history_and_feedback(VkCommandBuffer cmd)
 {
     unsigned i;
     for (i = 0; i < original_history.size(); i++)
-        vulkan_framebuffer_clear(original_history[i]->get_image(), cmd);
+        original_history[i] = vulkan_filter_chain_texture();
+    if (history_blank)
+        vulkan_framebuffer_clear(history_blank->get_image(), cmd);
     for (i = 0; i < passes.size(); i++)
     {
         Framebuffer* fb = passes[i]->get_feedback_framebuffer();
@@ -1980,6 +2929,38 @@ void vulkan_filter_chain::set_frame_direction(int32_t direction)
         passes[i]->set_frame_direction(direction);
 }
 
+void vulkan_filter_chain::set_frame_count_period(unsigned pass, unsigned period)
+{
+    passes[pass]->set_frame_count_period(period);
+}
+
+void vulkan_filter_chain::set_pass_name(unsigned pass, const char* name)
+{
+    passes[pass]->set_name(name);
+}
+
+void vulkan_filter_chain::add_static_texture(std::unique_ptr<StaticTexture> texture)
+{
+    common.luts.push_back(std::move(texture));
+}
+
+void vulkan_filter_chain::add_parameter(unsigned pass,
+    unsigned index, const std::string& id)
+{
+    passes[pass]->add_parameter(index, id);
+}
+
+void vulkan_filter_chain::release_staging_buffers()
+{
+    for (auto& lut : common.luts)
+        lut->release_staging_buffer();
+}
+
+VkFormat vulkan_filter_chain::get_pass_rt_format(unsigned pass)
+{
+    return pass_info[pass].rt_format;
+}
+
 void vulkan_filter_chain::set_input_texture(
     const vulkan_filter_chain_texture& texture)
 {
@@ -2021,75 +3002,40 @@ void vulkan_filter_chain::update_history_info()
     for (i = 0; i < original_history.size(); i++)
     {
         Texture* source = (Texture*)&common.original_history[i];
+        const vulkan_filter_chain_texture& frame = original_history[
+            (history_head + i) % original_history.size()];
 
         if (!source)
             continue;
 
-        source->texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (frame.image != VK_NULL_HANDLE)
+            source->texture = frame;
+        else
+        {
+            source->texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            source->texture.view = history_blank->get_view();
+            source->texture.image = history_blank->get_image();
+            source->texture.width = history_blank->get_size().width;
+            source->texture.height = history_blank->get_size().height;
+        }
 
-        source->texture.view = original_history[i]->get_view();
-        source->texture.image = original_history[i]->get_image();
-        source->texture.width = original_history[i]->get_size().width;
-        source->texture.height = original_history[i]->get_size().height;
         source->filter = passes.front()->get_source_filter();
         source->mip_filter = passes.front()->get_mip_filter();
         source->address = passes.front()->get_address_mode();
     }
 }
 
-void vulkan_filter_chain::update_history(DeferredDisposer& disposer,
-    VkCommandBuffer cmd)
+void vulkan_filter_chain::update_history()
 {
-    std::unique_ptr<Framebuffer> tmp;
-    VkImageLayout src_layout = input_texture.layout;
+    /* The oldest entry becomes the newest, the
+     * others move back a slot by rotating the head.
+     * Only the handles are kept, the frontend keeps the
+     * input itself alive for get_history_size() frames. */
+    unsigned newest = (history_head + unsigned(original_history.size()) - 1)
+        % unsigned(original_history.size());
 
-    /* Transition input texture to something appropriate. */
-    if (input_texture.layout != VK_IMAGE_LAYOUT_GENERAL)
-    {
-        VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(cmd,
-            input_texture.image, VK_REMAINING_MIP_LEVELS,
-            input_texture.layout,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            0,
-            VK_ACCESS_TRANSFER_READ_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_QUEUE_FAMILY_IGNORED,
-            VK_QUEUE_FAMILY_IGNORED);
-
-        src_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    }
-
-    std::unique_ptr<Framebuffer>& back = original_history.back();
-    swap(back, tmp);
-
-    if (input_texture.width != tmp->get_size().width ||
-        input_texture.height != tmp->get_size().height ||
-        (input_texture.format != VK_FORMAT_UNDEFINED
-            && input_texture.format != tmp->get_format()))
-        tmp->set_size(disposer, { input_texture.width, input_texture.height }, input_texture.format);
-
-    vulkan_framebuffer_copy(tmp->get_image(), tmp->get_size(),
-        cmd, input_texture.image, src_layout);
-
-    /* Transition input texture back. */
-    if (input_texture.layout != VK_IMAGE_LAYOUT_GENERAL)
-    {
-        VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(cmd,
-            input_texture.image, VK_REMAINING_MIP_LEVELS,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            input_texture.layout,
-            0,
-            VK_ACCESS_SHADER_READ_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_QUEUE_FAMILY_IGNORED,
-            VK_QUEUE_FAMILY_IGNORED);
-    }
-
-    /* Should ring buffer, but we don't have *that* many passes. */
-    move_backward(begin(original_history), end(original_history) - 1, end(original_history));
-    swap(original_history.front(), tmp);
+    original_history[newest] = input_texture;
+    history_head = newest;
 }
 
 void vulkan_filter_chain::set_pass_info(unsigned pass,
@@ -2113,9 +3059,14 @@ vulkan_filter_chain::vulkan_filter_chain(
     gpu(info.gpu),
     memory_properties(*info.memory_properties),
     cache(info.pipeline_cache),
+    mipmap_generator(info.device, info.gpu, info.pipeline_cache),
+    framebuffer_pool(info.device, *info.memory_properties, mipmap_generator),
     common(info.device, *info.memory_properties),
-    original_format(info.original_format)
+    original_format(info.original_format),
+    pass_fusion(info.pass_fusion)
 {
+    common.framebuffer_pool = &framebuffer_pool;
+    common.mipmap_generator = &mipmap_generator;
     max_input_size = { info.max_input_size.width, info.max_input_size.height };
     set_swapchain_info(info.swapchain);
     set_num_passes(info.num_passes);
@@ -2124,6 +3075,11 @@ vulkan_filter_chain::vulkan_filter_chain(
 vulkan_filter_chain::~vulkan_filter_chain()
 {
     flush();
+
+    if (fused_frames)
+        RARCH_LOG("[Vulkan filter chain]: Pass fusion saved %.2f MiB of"
+            " render target traffic over %llu frame(s).\n",
+            fused_bytes / (1024.0 * 1024.0), (unsigned long long)fused_frames);
 }
 
 void vulkan_filter_chain::set_num_passes(unsigned num_passes)
@@ -2182,6 +3138,558 @@ vulkan_filter_chain_t* vulkan_filter_chain_create_default(
         opaque_frag,
         sizeof(opaque_frag) / sizeof(uint32_t));
 
+    if (!chain->init())
+        return nullptr;
+
+    chain->set_passthrough(true);
+    return chain.release();
+}
+
+static glslang_filter_chain_address wrap_to_address(enum gfx_wrap_type type)
+{
+    switch (type)
+    {
+    case RARCH_WRAP_BORDER:
+        return GLSLANG_FILTER_CHAIN_ADDRESS_CLAMP_TO_BORDER;
+    case RARCH_WRAP_REPEAT:
+        return GLSLANG_FILTER_CHAIN_ADDRESS_REPEAT;
+    case RARCH_WRAP_MIRRORED_REPEAT:
+        return GLSLANG_FILTER_CHAIN_ADDRESS_MIRRORED_REPEAT;
+    case RARCH_WRAP_EDGE:
+    default:
+        break;
+    }
+
+    return GLSLANG_FILTER_CHAIN_ADDRESS_CLAMP_TO_EDGE;
+}
+
+static VkFormat glslang_find_format(const char* fmt)
+{
+#undef FMT
+#define FMT(x) if (string_is_equal(fmt, #x)) return VK_FORMAT_ ## x
+    FMT(R8_UNORM);
+    FMT(R8_UINT);
+    FMT(R8_SINT);
+    FMT(R8G8_UNORM);
+    FMT(R8G8_UINT);
+    FMT(R8G8_SINT);
+    FMT(R8G8B8A8_UNORM);
+    FMT(R8G8B8A8_UINT);
+    FMT(R8G8B8A8_SINT);
+    FMT(R8G8B8A8_SRGB);
+
+    FMT(A2B10G10R10_UNORM_PACK32);
+    FMT(A2B10G10R10_UINT_PACK32);
+
+    FMT(R16_UINT);
+    FMT(R16_SINT);
+    FMT(R16_SFLOAT);
+    FMT(R16G16_UINT);
+    FMT(R16G16_SINT);
+    FMT(R16G16_SFLOAT);
+    FMT(R16G16B16A16_UINT);
+    FMT(R16G16B16A16_SINT);
+    FMT(R16G16B16A16_SFLOAT);
+
+    FMT(R32_UINT);
+    FMT(R32_SINT);
+    FMT(R32_SFLOAT);
+    FMT(R32G32_UINT);
+    FMT(R32G32_SINT);
+    FMT(R32G32_SFLOAT);
+    FMT(R32G32B32A32_UINT);
+    FMT(R32G32B32A32_SINT);
+    FMT(R32G32B32A32_SFLOAT);
+#undef FMT
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+static bool vulkan_filter_chain_read_spirv(const std::string& path,
+    std::vector<uint32_t>& words)
+{
+    long size;
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if (!file)
+        return false;
+
+    if (fseek(file, 0, SEEK_END) != 0
+        || (size = ftell(file)) <= 0
+        || (size & 3)
+        || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    words.resize(size / sizeof(uint32_t));
+    if (fread(words.data(), size, 1, file) != 1)
+        words.clear();
+    fclose(file);
+
+    /* SPIR-V magic number. */
+    return !words.empty() && words[0] == 0x07230203;
+}
+
+/* Passes are compiled offline, the SPIR-V for foo.slang
+ * is picked up from foo.vert.spv and foo.frag.spv. */
+static bool vulkan_filter_chain_load_pass_spirv(const char* source,
+    std::vector<uint32_t>& vertex, std::vector<uint32_t>& fragment)
+{
+    std::string base = source;
+    size_t dot = base.rfind('.');
+    size_t slash = base.find_last_of("/\\");
+
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        base.erase(dot);
+
+    if (!vulkan_filter_chain_read_spirv(base + ".vert.spv", vertex))
+    {
+        RARCH_LOG("[Vulkan filter chain]: Failed to load \"%s.vert.spv\".\n", base.c_str());
+        return false;
+    }
+
+    if (!vulkan_filter_chain_read_spirv(base + ".frag.spv", fragment))
+    {
+        RARCH_LOG("[Vulkan filter chain]: Failed to load \"%s.frag.spv\".\n", base.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static bool vulkan_filter_chain_read_png(const char* path,
+    std::vector<uint8_t>& pixels, unsigned& width, unsigned& height)
+{
+    png_image image = {};
+
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path))
+        return false;
+
+    image.format = PNG_FORMAT_RGBA;
+    pixels.resize(PNG_IMAGE_SIZE(image));
+
+    if (!png_image_finish_read(&image, nullptr, pixels.data(), 0, nullptr))
+    {
+        png_image_free(&image);
+        return false;
+    }
+
+    width = image.width;
+    height = image.height;
+    return true;
+}
+
+static std::unique_ptr<StaticTexture> vulkan_filter_chain_load_lut(
+    VkCommandBuffer cmd,
+    const struct vulkan_filter_chain_create_info* info,
+    const video_shader_lut* shader)
+{
+    unsigned i;
+    unsigned width = 0;
+    unsigned height = 0;
+    std::vector<uint8_t> pixels;
+    VkMemoryRequirements mem_reqs;
+    VkImageCreateInfo image_info = {
+       VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    VkImageViewCreateInfo view_info = {
+       VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    VkMemoryAllocateInfo alloc = {
+       VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    VkBufferImageCopy region = {};
+    VkImage tex = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkImageLayout upload_layout;
+    std::unique_ptr<Buffer> buffer;
+    void* ptr;
+
+    if (!vulkan_filter_chain_read_png(shader->path, pixels, width, height))
+    {
+        RARCH_LOG("[Vulkan filter chain]: Failed to load LUT \"%s\".\n", shader->path);
+        return {};
+    }
+
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    image_info.extent.width = width;
+    image_info.extent.height = height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = shader->mipmap
+        ? num_miplevels(width, height) : 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(info->device, &image_info, nullptr, &tex) != VK_SUCCESS)
+        goto error;
+
+    vkGetImageMemoryRequirements(info->device, tex, &mem_reqs);
+
+    alloc.allocationSize = mem_reqs.size;
+    alloc.memoryTypeIndex = find_memory_type_fallback(
+        *info->memory_properties,
+        mem_reqs.memoryTypeBits,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(info->device, &alloc, nullptr, &memory) != VK_SUCCESS)
+        goto error;
+
+    vkBindImageMemory(info->device, tex, memory, 0);
+
+    view_info.image = tex;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+    view_info.components.r = VK_COMPONENT_SWIZZLE_R;
+    view_info.components.g = VK_COMPONENT_SWIZZLE_G;
+    view_info.components.b = VK_COMPONENT_SWIZZLE_B;
+    view_info.components.a = VK_COMPONENT_SWIZZLE_A;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.levelCount = image_info.mipLevels;
+    view_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(info->device, &view_info, nullptr, &view) != VK_SUCCESS)
+        goto error;
+
+    buffer = std::unique_ptr<Buffer>(new Buffer(info->device,
+        *info->memory_properties, pixels.size(),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
+    if (!(ptr = buffer->map()))
+        goto error;
+    memcpy(ptr, pixels.data(), pixels.size());
+    buffer->unmap();
+
+    /* Mip levels are blitted from each other within the same image,
+     * GENERAL saves a layout transition per level. */
+    upload_layout = image_info.mipLevels > 1
+        ? VK_IMAGE_LAYOUT_GENERAL
+        : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(cmd, tex,
+        VK_REMAINING_MIP_LEVELS,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        upload_layout,
+        0,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED);
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+
+    vkCmdCopyBufferToImage(cmd, buffer->get_buffer(), tex,
+        upload_layout, 1, &region);
+
+    for (i = 1; i < image_info.mipLevels; i++)
+    {
+        VkImageBlit blit_region = {};
+
+        blit_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit_region.srcSubresource.mipLevel = i - 1;
+        blit_region.srcSubresource.baseArrayLayer = 0;
+        blit_region.srcSubresource.layerCount = 1;
+        blit_region.dstSubresource = blit_region.srcSubresource;
+        blit_region.dstSubresource.mipLevel = i;
+        blit_region.srcOffsets[1].x = std::max(width >> (i - 1), 1u);
+        blit_region.srcOffsets[1].y = std::max(height >> (i - 1), 1u);
+        blit_region.srcOffsets[1].z = 1;
+        blit_region.dstOffsets[1].x = std::max(width >> i, 1u);
+        blit_region.dstOffsets[1].y = std::max(height >> i, 1u);
+        blit_region.dstOffsets[1].z = 1;
+
+        /* Only an execution and memory barrier, no actual transition. */
+        VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(cmd, tex,
+            VK_REMAINING_MIP_LEVELS,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED);
+
+        vkCmdBlitImage(cmd,
+            tex, VK_IMAGE_LAYOUT_GENERAL,
+            tex, VK_IMAGE_LAYOUT_GENERAL,
+            1, &blit_region, VK_FILTER_LINEAR);
+    }
+
+    VULKAN_IMAGE_LAYOUT_TRANSITION_LEVELS(cmd, tex,
+        VK_REMAINING_MIP_LEVELS,
+        upload_layout,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED);
+
+    return std::unique_ptr<StaticTexture>(new StaticTexture(shader->id,
+        info->device, tex, view, memory, std::move(buffer), width, height,
+        shader->filter != RARCH_FILTER_NEAREST,
+        image_info.mipLevels > 1,
+        wrap_to_address(shader->wrap)));
+
+error:
+    if (view != VK_NULL_HANDLE)
+        vkDestroyImageView(info->device, view, nullptr);
+    if (tex != VK_NULL_HANDLE)
+        vkDestroyImage(info->device, tex, nullptr);
+    if (memory != VK_NULL_HANDLE)
+        vkFreeMemory(info->device, memory, nullptr);
+    return {};
+}
+
+static bool vulkan_filter_chain_load_luts(
+    const struct vulkan_filter_chain_create_info* info,
+    vulkan_filter_chain* chain,
+    const video_shader* shader)
+{
+    unsigned i;
+    VkCommandBufferBeginInfo begin_info = {
+       VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    VkSubmitInfo submit_info = {
+       VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    VkCommandBufferAllocateInfo cmd_info = {
+       VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    bool recording = false;
+
+    if (!shader->luts)
+        return true;
+
+    cmd_info.commandPool = info->command_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(info->device, &cmd_info, &cmd) != VK_SUCCESS)
+        return false;
+
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &begin_info);
+    recording = true;
+
+    for (i = 0; i < shader->luts; i++)
+    {
+        std::unique_ptr<StaticTexture> image =
+            vulkan_filter_chain_load_lut(cmd, info, &shader->lut[i]);
+        if (!image)
+            goto error;
+
+        chain->add_static_texture(std::move(image));
+    }
+
+    vkEndCommandBuffer(cmd);
+    recording = false;
+
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    slock_lock(info->queue_lock);
+    vkQueueSubmit(info->queue, 1, &submit_info, VK_NULL_HANDLE);
+    vkQueueWaitIdle(info->queue);
+    slock_unlock(info->queue_lock);
+    vkFreeCommandBuffers(info->device, info->command_pool, 1, &cmd);
+
+    chain->release_staging_buffers();
+    return true;
+
+error:
+    if (recording)
+        vkEndCommandBuffer(cmd);
+    vkFreeCommandBuffers(info->device, info->command_pool, 1, &cmd);
+    return false;
+}
+
+vulkan_filter_chain_t* vulkan_filter_chain_create_from_preset(
+    const struct vulkan_filter_chain_create_info* info,
+    const char* path, glslang_filter_chain_filter filter)
+{
+    unsigned i, j;
+    struct vulkan_filter_chain_pass_info pass_info;
+    std::unique_ptr<video_shader> shader{ new video_shader() };
+    bool last_pass_is_fbo;
+    auto tmpinfo = *info;
+
+    if (!video_shader_load_preset_into_shader(path, shader.get()))
+        return nullptr;
+
+    /* The last pass wants an offscreen target of its own,
+     * so a stock pass scales it to the viewport afterwards. */
+    last_pass_is_fbo = shader->pass[shader->passes - 1].fbo.valid;
+    tmpinfo.num_passes = shader->passes + (last_pass_is_fbo ? 1 : 0);
+
+    std::unique_ptr<vulkan_filter_chain> chain{ new vulkan_filter_chain(tmpinfo) };
+    if (!chain)
+        return nullptr;
+
+    for (i = 0; i < shader->passes; i++)
+    {
+        const video_shader_pass* pass = &shader->pass[i];
+        const video_shader_pass* next_pass =
+            i + 1 < shader->passes ? &shader->pass[i + 1] : nullptr;
+        VkFormat pass_format = VK_FORMAT_UNDEFINED;
+        std::vector<uint32_t> vertex;
+        std::vector<uint32_t> fragment;
+
+        pass_info = {};
+
+        if (!vulkan_filter_chain_load_pass_spirv(pass->source.path, vertex, fragment))
+            return nullptr;
+
+        chain->set_shader(i, VK_SHADER_STAGE_VERTEX_BIT,
+            vertex.data(), vertex.size());
+        chain->set_shader(i, VK_SHADER_STAGE_FRAGMENT_BIT,
+            fragment.data(), fragment.size());
+        chain->set_frame_count_period(i, pass->frame_count_mod);
+
+        if (*pass->alias)
+            chain->set_pass_name(i, pass->alias);
+
+        /* Parameters the pass doesn't reference are
+         * dropped again after reflection. */
+        for (j = 0; j < shader->num_parameters; j++)
+            chain->add_parameter(i, j, shader->parameters[j].id);
+
+        if (pass->filter == RARCH_FILTER_UNSPEC)
+            pass_info.source_filter = filter;
+        else
+            pass_info.source_filter = pass->filter == RARCH_FILTER_LINEAR
+            ? GLSLANG_FILTER_CHAIN_LINEAR
+            : GLSLANG_FILTER_CHAIN_NEAREST;
+
+        pass_info.address = wrap_to_address(pass->wrap);
+        pass_info.max_levels = 1;
+
+        /* mipmap_input is a property of the pass sampling
+         * our output, so it sizes our mip chain. */
+        if (next_pass && next_pass->mipmap)
+            pass_info.max_levels = ~0u;
+
+        pass_info.mip_filter = pass->filter != RARCH_FILTER_NEAREST
+            && pass_info.max_levels > 1
+            ? GLSLANG_FILTER_CHAIN_LINEAR
+            : GLSLANG_FILTER_CHAIN_NEAREST;
+
+        if (*pass->format
+            && (pass_format = glslang_find_format(pass->format)) == VK_FORMAT_UNDEFINED)
+            RARCH_LOG("[Vulkan filter chain]: Unknown format \"%s\" in pass #%u, using default.\n",
+                pass->format, i);
+
+        if (!pass->fbo.valid)
+        {
+            bool last = i + 1 == shader->passes;
+
+            pass_info.scale_type_x = last
+                ? GLSLANG_FILTER_CHAIN_SCALE_VIEWPORT
+                : GLSLANG_FILTER_CHAIN_SCALE_SOURCE;
+            pass_info.scale_type_y = pass_info.scale_type_x;
+            pass_info.scale_x = 1.0f;
+            pass_info.scale_y = 1.0f;
+
+            if (last)
+                pass_info.rt_format = tmpinfo.swapchain.format;
+            else if (pass_format != VK_FORMAT_UNDEFINED)
+                pass_info.rt_format = pass_format;
+            else
+                pass_info.rt_format = VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        else
+        {
+            if (pass_format == VK_FORMAT_UNDEFINED)
+            {
+                if (pass->fbo.fp_fbo)
+                    pass_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+                else if (pass->fbo.srgb_fbo)
+                    pass_format = VK_FORMAT_R8G8B8A8_SRGB;
+                else
+                    pass_format = VK_FORMAT_R8G8B8A8_UNORM;
+            }
+
+            pass_info.rt_format = pass_format;
+
+            switch (pass->fbo.type_x)
+            {
+            case RARCH_SCALE_INPUT:
+                pass_info.scale_x = pass->fbo.scale_x;
+                pass_info.scale_type_x = GLSLANG_FILTER_CHAIN_SCALE_SOURCE;
+                break;
+
+            case RARCH_SCALE_ABSOLUTE:
+                pass_info.scale_x = float(pass->fbo.abs_x);
+                pass_info.scale_type_x = GLSLANG_FILTER_CHAIN_SCALE_ABSOLUTE;
+                break;
+
+            case RARCH_SCALE_VIEWPORT:
+                pass_info.scale_x = pass->fbo.scale_x;
+                pass_info.scale_type_x = GLSLANG_FILTER_CHAIN_SCALE_VIEWPORT;
+                break;
+            }
+
+            switch (pass->fbo.type_y)
+            {
+            case RARCH_SCALE_INPUT:
+                pass_info.scale_y = pass->fbo.scale_y;
+                pass_info.scale_type_y = GLSLANG_FILTER_CHAIN_SCALE_SOURCE;
+                break;
+
+            case RARCH_SCALE_ABSOLUTE:
+                pass_info.scale_y = float(pass->fbo.abs_y);
+                pass_info.scale_type_y = GLSLANG_FILTER_CHAIN_SCALE_ABSOLUTE;
+                break;
+
+            case RARCH_SCALE_VIEWPORT:
+                pass_info.scale_y = pass->fbo.scale_y;
+                pass_info.scale_type_y = GLSLANG_FILTER_CHAIN_SCALE_VIEWPORT;
+                break;
+            }
+        }
+
+        chain->set_pass_info(i, pass_info);
+    }
+
+    if (last_pass_is_fbo)
+    {
+        pass_info = {};
+        pass_info.scale_type_x = GLSLANG_FILTER_CHAIN_SCALE_VIEWPORT;
+        pass_info.scale_type_y = GLSLANG_FILTER_CHAIN_SCALE_VIEWPORT;
+        pass_info.scale_x = 1.0f;
+        pass_info.scale_y = 1.0f;
+        pass_info.rt_format = tmpinfo.swapchain.format;
+        pass_info.source_filter = filter;
+        pass_info.mip_filter = GLSLANG_FILTER_CHAIN_NEAREST;
+        pass_info.address = GLSLANG_FILTER_CHAIN_ADDRESS_CLAMP_TO_EDGE;
+        pass_info.max_levels = 1;
+
+        chain->set_pass_info(shader->passes, pass_info);
+
+        chain->set_shader(shader->passes, VK_SHADER_STAGE_VERTEX_BIT,
+            opaque_vert,
+            sizeof(opaque_vert) / sizeof(uint32_t));
+        chain->set_shader(shader->passes, VK_SHADER_STAGE_FRAGMENT_BIT,
+            opaque_frag,
+            sizeof(opaque_frag) / sizeof(uint32_t));
+    }
+
+    if (!vulkan_filter_chain_load_luts(info, chain.get(), shader.get()))
+        return nullptr;
+
+    chain->set_shader_preset(std::move(shader));
+
     if (!chain->init())
         return nullptr;
 
@@ -2255,3 +3763,22 @@ struct video_shader* vulkan_filter_chain_get_preset(
 {
     return chain->get_shader_preset();
 }
+
+bool vulkan_filter_chain_is_passthrough(
+    vulkan_filter_chain_t* chain)
+{
+    return chain->is_passthrough();
+}
+
+unsigned vulkan_filter_chain_get_history_size(
+    vulkan_filter_chain_t* chain)
+{
+    return chain->get_history_size();
+}
+
+VkFormat vulkan_filter_chain_get_pass_rt_format(
+    vulkan_filter_chain_t* chain,
+    unsigned pass)
+{
+    return chain->get_pass_rt_format(pass);
+}
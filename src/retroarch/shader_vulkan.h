@@ -17,6 +17,7 @@
 #pragma once
 
 #include "volk.h"
+#include "rthreads.h"
 
 typedef struct vulkan_filter_chain vulkan_filter_chain_t;
 
@@ -91,6 +92,8 @@ struct vulkan_filter_chain_create_info
     const VkPhysicalDeviceMemoryProperties* memory_properties;
     VkPipelineCache pipeline_cache;
     VkQueue queue;
+    /* Held around submits to queue, which parallel-RDP shares. */
+    slock_t* queue_lock;
     VkCommandPool command_pool;
     unsigned num_passes;
 
@@ -100,6 +103,9 @@ struct vulkan_filter_chain_create_info
         unsigned width, height;
     } max_input_size;
     struct vulkan_filter_chain_swapchain_info swapchain;
+
+    /* Skip passes which would only copy their input. */
+    bool pass_fusion;
 };
 
 #ifdef __cplusplus
@@ -109,6 +115,9 @@ extern "C" {
     vulkan_filter_chain_t* vulkan_filter_chain_create_default(
         const struct vulkan_filter_chain_create_info* info,
         enum glslang_filter_chain_filter filter);
+    vulkan_filter_chain_t* vulkan_filter_chain_create_from_preset(
+        const struct vulkan_filter_chain_create_info* info,
+        const char* path, enum glslang_filter_chain_filter filter);
     void vulkan_filter_chain_free(vulkan_filter_chain_t* chain);
     bool vulkan_filter_chain_update_swapchain_info(vulkan_filter_chain_t* chain,
         const struct vulkan_filter_chain_swapchain_info* info);
@@ -134,6 +143,13 @@ extern "C" {
         VkCommandBuffer cmd);
     struct video_shader* vulkan_filter_chain_get_preset(
         vulkan_filter_chain_t* chain);
+    bool vulkan_filter_chain_is_passthrough(
+        vulkan_filter_chain_t* chain);
+    unsigned vulkan_filter_chain_get_history_size(
+        vulkan_filter_chain_t* chain);
+    VkFormat vulkan_filter_chain_get_pass_rt_format(
+        vulkan_filter_chain_t* chain,
+        unsigned pass);
 
 #ifdef __cplusplus
 }
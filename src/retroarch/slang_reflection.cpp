@@ -18,7 +18,11 @@
 #include <vector>
 #include <algorithm>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "compat_strl.h"
+#include "shader_cache.h"
+#include "slang_spirv_scanner.h"
 #include "../spirv-cross/spirv_cross.hpp"
 
 using namespace std;
@@ -311,8 +315,9 @@ static bool validate_type_for_texture_semantic(const SPIRType& type)
         (type.columns == 1);
 }
 
+template <typename C>
 static bool add_active_buffer_ranges(
-    const Compiler& compiler,
+    const C& compiler,
     const Resource& resource,
     slang_reflection* reflection,
     bool push_constant)
@@ -403,9 +408,12 @@ slang_reflection::slang_reflection()
             ? 0 : 1);
 }
 
-bool slang_reflect(
-    const Compiler& vertex_compiler,
-    const Compiler& fragment_compiler,
+/* Templated so it runs unchanged on top of either spirv_cross::Compiler
+ * or the reflection-only slang_spirv_scanner. */
+template <typename C>
+static bool slang_reflect(
+    const C& vertex_compiler,
+    const C& fragment_compiler,
     const ShaderResources& vertex,
     const ShaderResources& fragment,
     slang_reflection* reflection)
@@ -756,33 +764,675 @@ bool slang_reflect(
     return true;
 }
 
-bool slang_reflect_spirv(const std::vector<uint32_t>& vertex,
+/* Bump whenever the blob layout or slang_reflect() semantics change. */
+#define SLANG_REFLECTION_CACHE_VERSION 1
+
+template <typename P>
+static uint64_t slang_hash_map(uint64_t hash,
+    const std::unordered_map<std::string, P>* m)
+{
+    /* Iteration order of an unordered_map is unspecified, sort first. */
+    vector<pair<string, P>> entries;
+    uint32_t count = m ? uint32_t(m->size()) : 0;
+
+    hash = shader_cache_hash(&count, sizeof(count), hash);
+    if (!m)
+        return hash;
+
+    entries.assign(m->begin(), m->end());
+    sort(entries.begin(), entries.end(),
+        [](const pair<string, P>& a, const pair<string, P>& b) {
+            return a.first < b.first;
+        });
+
+    for (auto& entry : entries)
+    {
+        int32_t semantic = entry.second.semantic;
+        uint32_t index = entry.second.index;
+
+        hash = shader_cache_hash(entry.first.c_str(),
+            entry.first.size() + 1, hash);
+        hash = shader_cache_hash(&semantic, sizeof(semantic), hash);
+        hash = shader_cache_hash(&index, sizeof(index), hash);
+    }
+
+    return hash;
+}
+
+/* Reflection resolves names through the semantic maps, so the result
+ * depends on those and the pass number as well as on the SPIR-V. */
+static uint64_t slang_reflection_cache_key(
+    const std::vector<uint32_t>& vertex,
     const std::vector<uint32_t>& fragment,
-    slang_reflection* reflection)
+    const slang_reflection* reflection)
 {
-    try
+    uint32_t header[4];
+    uint64_t hash = SHADER_CACHE_HASH_SEED;
+
+    header[0] = SLANG_REFLECTION_CACHE_VERSION;
+    header[1] = reflection->pass_number;
+    header[2] = uint32_t(vertex.size());
+    header[3] = uint32_t(fragment.size());
+
+    hash = shader_cache_hash(header, sizeof(header), hash);
+    hash = shader_cache_hash(vertex.data(),
+        vertex.size() * sizeof(uint32_t), hash);
+    hash = shader_cache_hash(fragment.data(),
+        fragment.size() * sizeof(uint32_t), hash);
+    hash = slang_hash_map(hash, reflection->texture_semantic_map);
+    hash = slang_hash_map(hash, reflection->texture_semantic_uniform_map);
+    hash = slang_hash_map(hash, reflection->semantic_map);
+    return hash;
+}
+
+namespace
+{
+    struct slang_blob_writer
+    {
+        vector<uint8_t> data;
+
+        template <typename T>
+        void put(T v)
+        {
+            size_t offset = data.size();
+            data.resize(offset + sizeof(v));
+            memcpy(data.data() + offset, &v, sizeof(v));
+        }
+    };
+
+    struct slang_blob_reader
     {
-        Compiler vertex_compiler(vertex);
-        Compiler fragment_compiler(fragment);
-        spirv_cross::ShaderResources
-            vertex_resources = vertex_compiler.get_shader_resources();
-        spirv_cross::ShaderResources
-            fragment_resources = fragment_compiler.get_shader_resources();
+        const uint8_t* data;
+        size_t size;
+        bool ok;
+
+        template <typename T>
+        T get()
+        {
+            T v = T();
+            if (!ok || size < sizeof(v))
+            {
+                ok = false;
+                return v;
+            }
+            memcpy(&v, data, sizeof(v));
+            data += sizeof(v);
+            size -= sizeof(v);
+            return v;
+        }
+    };
+}
+
+static void slang_put_semantic_meta(slang_blob_writer& w,
+    const slang_semantic_meta& meta)
+{
+    w.put<uint64_t>(meta.ubo_offset);
+    w.put<uint64_t>(meta.push_constant_offset);
+    w.put<uint32_t>(meta.num_components);
+    w.put<uint8_t>((meta.uniform ? 1 : 0) | (meta.push_constant ? 2 : 0));
+}
+
+static void slang_get_semantic_meta(slang_blob_reader& r,
+    slang_semantic_meta& meta)
+{
+    uint8_t flags;
+
+    meta.ubo_offset = size_t(r.get<uint64_t>());
+    meta.push_constant_offset = size_t(r.get<uint64_t>());
+    meta.num_components = r.get<uint32_t>();
+    flags = r.get<uint8_t>();
+    meta.uniform = (flags & 1) != 0;
+    meta.push_constant = (flags & 2) != 0;
+}
+
+static void slang_reflection_serialize(const slang_reflection* reflection,
+    vector<uint8_t>& blob)
+{
+    unsigned i;
+    slang_blob_writer w;
 
-        if (!slang_reflect(vertex_compiler, fragment_compiler,
-            vertex_resources, fragment_resources,
-            reflection))
+    w.put<uint32_t>(SLANG_REFLECTION_CACHE_VERSION);
+    w.put<uint64_t>(reflection->ubo_size);
+    w.put<uint64_t>(reflection->push_constant_size);
+    w.put<uint32_t>(reflection->ubo_binding);
+    w.put<uint32_t>(reflection->ubo_stage_mask);
+    w.put<uint32_t>(reflection->push_constant_stage_mask);
+
+    for (i = 0; i < SLANG_NUM_TEXTURE_SEMANTICS; i++)
+    {
+        w.put<uint32_t>(uint32_t(reflection->semantic_textures[i].size()));
+        for (auto& meta : reflection->semantic_textures[i])
         {
-            RARCH_ERR("[slang]: Failed to reflect SPIR-V."
-                " Resource usage is inconsistent with expectations.\n");
+            w.put<uint64_t>(meta.ubo_offset);
+            w.put<uint64_t>(meta.push_constant_offset);
+            w.put<uint32_t>(meta.binding);
+            w.put<uint32_t>(meta.stage_mask);
+            w.put<uint8_t>((meta.texture ? 1 : 0)
+                | (meta.uniform ? 2 : 0)
+                | (meta.push_constant ? 4 : 0));
+        }
+    }
+
+    for (i = 0; i < SLANG_NUM_SEMANTICS; i++)
+        slang_put_semantic_meta(w, reflection->semantics[i]);
+
+    w.put<uint32_t>(uint32_t(reflection->semantic_float_parameters.size()));
+    for (auto& meta : reflection->semantic_float_parameters)
+        slang_put_semantic_meta(w, meta);
+
+    blob = std::move(w.data);
+}
+
+static bool slang_reflection_deserialize(const uint8_t* data, size_t size,
+    slang_reflection* reflection)
+{
+    unsigned i, j;
+    uint32_t count;
+    slang_blob_reader r = { data, size, true };
+
+    if (r.get<uint32_t>() != SLANG_REFLECTION_CACHE_VERSION)
+        return false;
+
+    reflection->ubo_size = size_t(r.get<uint64_t>());
+    reflection->push_constant_size = size_t(r.get<uint64_t>());
+    reflection->ubo_binding = r.get<uint32_t>();
+    reflection->ubo_stage_mask = r.get<uint32_t>();
+    reflection->push_constant_stage_mask = r.get<uint32_t>();
+
+    for (i = 0; i < SLANG_NUM_TEXTURE_SEMANTICS && r.ok; i++)
+    {
+        auto& textures = reflection->semantic_textures[i];
+
+        /* Every entry takes more than one byte, so a count larger than
+         * what is left can only come from a corrupt blob. */
+        if ((count = r.get<uint32_t>()) > r.size)
             return false;
+
+        textures.clear();
+        textures.resize(count);
+        for (j = 0; j < count; j++)
+        {
+            uint8_t flags;
+            slang_texture_semantic_meta& meta = textures[j];
+
+            meta.ubo_offset = size_t(r.get<uint64_t>());
+            meta.push_constant_offset = size_t(r.get<uint64_t>());
+            meta.binding = r.get<uint32_t>();
+            meta.stage_mask = r.get<uint32_t>();
+            flags = r.get<uint8_t>();
+            meta.texture = (flags & 1) != 0;
+            meta.uniform = (flags & 2) != 0;
+            meta.push_constant = (flags & 4) != 0;
         }
+    }
+
+    for (i = 0; i < SLANG_NUM_SEMANTICS; i++)
+        slang_get_semantic_meta(r, reflection->semantics[i]);
+
+    if ((count = r.get<uint32_t>()) > r.size)
+        return false;
+
+    reflection->semantic_float_parameters.clear();
+    reflection->semantic_float_parameters.resize(count);
+    for (auto& meta : reflection->semantic_float_parameters)
+        slang_get_semantic_meta(r, meta);
+
+    return r.ok && r.size == 0;
+}
 
+template <typename C>
+static bool slang_reflect_modules(const C& vertex_compiler,
+    const C& fragment_compiler, slang_reflection* reflection)
+{
+    if (!slang_reflect(vertex_compiler, fragment_compiler,
+        vertex_compiler.get_shader_resources(),
+        fragment_compiler.get_shader_resources(),
+        reflection))
+    {
+        RARCH_ERR("[slang]: Failed to reflect SPIR-V."
+            " Resource usage is inconsistent with expectations.\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool slang_reflect_spirv_cached(uint64_t key,
+    slang_reflection* reflection)
+{
+    void* data = NULL;
+    size_t size = 0;
+    bool loaded = false;
+
+    if (!shader_cache_load("reflect", key, &data, &size))
+        return false;
+
+    loaded = slang_reflection_deserialize(
+        (const uint8_t*)data, size, reflection);
+    free(data);
+    return loaded;
+}
+
+bool slang_reflect_spirv(const std::vector<uint32_t>& vertex,
+    const std::vector<uint32_t>& fragment,
+    slang_reflection* reflection)
+{
+    uint64_t key = slang_reflection_cache_key(vertex, fragment, reflection);
+
+    /* Work on a copy so a half-read blob never leaks into the result. */
+    slang_reflection cached = *reflection;
+    if (slang_reflect_spirv_cached(key, &cached))
+    {
+        *reflection = cached;
+        reflection->cached = true;
         return true;
     }
+
+    try
+    {
+        bool reflected;
+        slang_spirv_scanner vertex_scanner;
+        slang_spirv_scanner fragment_scanner;
+
+        /* Modules the scanner does not model take the full parser. */
+        if (vertex_scanner.scan(vertex.data(), vertex.size())
+            && fragment_scanner.scan(fragment.data(), fragment.size()))
+            reflected = slang_reflect_modules(
+                vertex_scanner, fragment_scanner, reflection);
+        else
+            reflected = slang_reflect_modules(
+                Compiler(vertex), Compiler(fragment), reflection);
+
+        if (!reflected)
+            return false;
+    }
     catch (const std::exception& e)
     {
         RARCH_ERR("[slang]: SPIRV-Cross threw exception: %s.\n", e.what());
         return false;
     }
+
+    {
+        vector<uint8_t> blob;
+        slang_reflection_serialize(reflection, blob);
+        shader_cache_store("reflect", key, blob.data(), blob.size());
+    }
+
+    return true;
+}
+
+/* Just enough of a module to follow the few instructions
+ * a passthrough pass is made of. */
+struct slang_passthrough_module
+{
+    struct instruction
+    {
+        spv::Op op;
+        const uint32_t* ops;
+        uint32_t count;
+    };
+
+    unordered_map<uint32_t, uint32_t> locations;
+    unordered_map<uint32_t, uint32_t> builtins;
+    unordered_map<uint32_t, uint32_t> bindings;
+    unordered_map<uint32_t, uint32_t> storage;
+    unordered_map<uint32_t, uint32_t> variable_types;
+    unordered_map<uint32_t, uint32_t> pointees;
+    unordered_map<uint32_t, uint32_t> constants;
+    unordered_map<uint64_t, uint32_t> member_offsets;
+    unordered_map<uint64_t, uint32_t> member_builtins;
+    unordered_map<uint32_t, size_t> definitions;
+    vector<uint32_t> relaxed;
+    vector<instruction> body;
+
+    static uint64_t member_key(uint32_t type, uint32_t member)
+    {
+        return (uint64_t(type) << 32) | member;
+    }
+
+    bool parse(const vector<uint32_t>& words)
+    {
+        size_t i = 5;
+        unsigned functions = 0;
+        bool in_function = false;
+
+        if (words.size() < 5 || words[0] != spv::MagicNumber)
+            return false;
+
+        while (i < words.size())
+        {
+            spv::Op op = spv::Op(words[i] & 0xffff);
+            uint32_t count = words[i] >> 16;
+            const uint32_t* ops = words.data() + i + 1;
+
+            if (count == 0 || i + count > words.size())
+                return false;
+            count--;
+
+            switch (op)
+            {
+            case spv::OpDecorate:
+                if (count < 2)
+                    return false;
+                if (ops[1] == spv::DecorationRelaxedPrecision)
+                    relaxed.push_back(ops[0]);
+                else if (count >= 3 && ops[1] == spv::DecorationLocation)
+                    locations[ops[0]] = ops[2];
+                else if (count >= 3 && ops[1] == spv::DecorationBuiltIn)
+                    builtins[ops[0]] = ops[2];
+                else if (count >= 3 && ops[1] == spv::DecorationBinding)
+                    bindings[ops[0]] = ops[2];
+                break;
+
+            case spv::OpMemberDecorate:
+                if (count >= 4 && ops[2] == spv::DecorationOffset)
+                    member_offsets[member_key(ops[0], ops[1])] = ops[3];
+                else if (count >= 4 && ops[2] == spv::DecorationBuiltIn)
+                    member_builtins[member_key(ops[0], ops[1])] = ops[3];
+                break;
+
+            case spv::OpTypePointer:
+                if (count < 3)
+                    return false;
+                pointees[ops[0]] = ops[2];
+                break;
+
+            case spv::OpConstant:
+                if (count < 3)
+                    return false;
+                constants[ops[1]] = ops[2];
+                break;
+
+            case spv::OpFunction:
+                if (in_function)
+                    return false;
+                in_function = true;
+                functions++;
+                break;
+
+            case spv::OpFunctionEnd:
+                in_function = false;
+                break;
+
+            case spv::OpLine:
+            case spv::OpNoLine:
+                break;
+
+            default:
+                if (!in_function)
+                {
+                    if (op == spv::OpVariable && count >= 3)
+                    {
+                        variable_types[ops[1]] = ops[0];
+                        storage[ops[1]] = ops[2];
+                    }
+                    break;
+                }
+
+                /* Everything with a result we look at keeps it in ops[1]. */
+                if (count >= 2 && op != spv::OpStore)
+                    definitions[ops[1]] = body.size();
+                body.push_back({ op, ops, count });
+                break;
+            }
+
+            i += count + 1;
+        }
+
+        return functions == 1 && !in_function;
+    }
+
+    const instruction* find(uint32_t id, spv::Op op) const
+    {
+        auto itr = definitions.find(id);
+        if (itr == end(definitions) || body[itr->second].op != op)
+            return nullptr;
+        return &body[itr->second];
+    }
+
+    bool is_relaxed(uint32_t id) const
+    {
+        return find_if(begin(relaxed), end(relaxed),
+            [id](uint32_t r) { return r == id; }) != end(relaxed);
+    }
+
+    /* A global variable, or one constant member of a global block. */
+    bool resolve(uint32_t pointer, uint32_t& variable, int& member) const
+    {
+        const instruction* chain = find(pointer, spv::OpAccessChain);
+
+        if (storage.count(pointer))
+        {
+            variable = pointer;
+            member = -1;
+            return true;
+        }
+
+        if (!chain || chain->count != 4 || !storage.count(chain->ops[2]))
+            return false;
+
+        auto index = constants.find(chain->ops[3]);
+        if (index == end(constants))
+            return false;
+
+        variable = chain->ops[2];
+        member = int(index->second);
+        return true;
+    }
+
+    /* The variable an OpLoad result was read from. */
+    bool resolve_load(uint32_t id, uint32_t& variable, int& member) const
+    {
+        const instruction* load = find(id, spv::OpLoad);
+        return load && resolve(load->ops[2], variable, member);
+    }
+
+    bool has_storage(uint32_t variable, spv::StorageClass sc) const
+    {
+        auto itr = storage.find(variable);
+        return itr != end(storage) && itr->second == uint32_t(sc);
+    }
+
+    bool has_location(uint32_t variable, uint32_t location) const
+    {
+        auto itr = locations.find(variable);
+        return itr != end(locations) && itr->second == location;
+    }
+
+    /* Block type behind a variable, through its pointer type. */
+    uint32_t block_type(uint32_t variable) const
+    {
+        auto type = variable_types.find(variable);
+        if (type == end(variable_types))
+            return 0;
+        auto pointee = pointees.find(type->second);
+        return pointee != end(pointees) ? pointee->second : 0;
+    }
+
+    bool is_builtin(uint32_t variable, int member, spv::BuiltIn builtin) const
+    {
+        if (member < 0)
+        {
+            auto itr = builtins.find(variable);
+            return itr != end(builtins) && itr->second == uint32_t(builtin);
+        }
+
+        auto itr = member_builtins.find(
+            member_key(block_type(variable), uint32_t(member)));
+        return itr != end(member_builtins) && itr->second == uint32_t(builtin);
+    }
+};
+
+/* gl_Position = MVP * Position; vTexCoord = TexCoord;
+ * and nothing else. Returns the location vTexCoord is written to. */
+static bool slang_vertex_is_passthrough(const slang_passthrough_module& m,
+    const slang_reflection& reflection, uint32_t& tex_location)
+{
+    const slang_semantic_meta& mvp = reflection.semantics[SLANG_SEMANTIC_MVP];
+    bool position = false;
+    bool texcoord = false;
+
+    for (auto& inst : m.body)
+    {
+        uint32_t variable, source;
+        int member, source_member;
+
+        switch (inst.op)
+        {
+        case spv::OpLabel:
+        case spv::OpLoad:
+        case spv::OpAccessChain:
+        case spv::OpMatrixTimesVector:
+        case spv::OpReturn:
+            /* Only matters through the stores checked below. */
+            break;
+
+        case spv::OpStore:
+            if (inst.count < 2
+                || !m.resolve(inst.ops[0], variable, member)
+                || !m.has_storage(variable, spv::StorageClassOutput))
+                return false;
+
+            if (m.is_builtin(variable, member, spv::BuiltInPosition))
+            {
+                const slang_passthrough_module::instruction* mul =
+                    m.find(inst.ops[1], spv::OpMatrixTimesVector);
+                uint32_t offset;
+
+                if (position || !mul
+                    || !m.resolve_load(mul->ops[2], source, source_member)
+                    || source_member < 0)
+                    return false;
+
+                auto itr = m.member_offsets.find(slang_passthrough_module::member_key(
+                    m.block_type(source), uint32_t(source_member)));
+                if (itr == end(m.member_offsets))
+                    return false;
+                offset = itr->second;
+
+                /* The matrix has to be the MVP semantic,
+                 * which offscreen passes set to identity. */
+                if (m.has_storage(source, spv::StorageClassUniform))
+                {
+                    if (!mvp.uniform || mvp.ubo_offset != offset)
+                        return false;
+                }
+                else if (m.has_storage(source, spv::StorageClassPushConstant))
+                {
+                    if (!mvp.push_constant || mvp.push_constant_offset != offset)
+                        return false;
+                }
+                else
+                    return false;
+
+                if (!m.resolve_load(mul->ops[3], source, source_member)
+                    || source_member >= 0
+                    || !m.has_storage(source, spv::StorageClassInput)
+                    || !m.has_location(source, 0))
+                    return false;
+
+                position = true;
+            }
+            else
+            {
+                auto location = m.locations.find(variable);
+
+                if (texcoord || member >= 0 || location == end(m.locations)
+                    || !m.resolve_load(inst.ops[1], source, source_member)
+                    || source_member >= 0
+                    || !m.has_storage(source, spv::StorageClassInput)
+                    || !m.has_location(source, 1))
+                    return false;
+
+                tex_location = location->second;
+                texcoord = true;
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    return position && texcoord;
+}
+
+/* FragColor = texture(Source, vTexCoord); and nothing else. */
+static bool slang_fragment_is_passthrough(const slang_passthrough_module& m,
+    const slang_reflection& reflection, uint32_t tex_location)
+{
+    auto& source_meta = reflection.semantic_textures[SLANG_TEXTURE_SEMANTIC_SOURCE];
+    bool stored = false;
+
+    if (source_meta.empty() || !source_meta[0].texture)
+        return false;
+
+    for (auto& inst : m.body)
+    {
+        const slang_passthrough_module::instruction* sample;
+        uint32_t variable, texture, coord;
+        int member, texture_member, coord_member;
+
+        switch (inst.op)
+        {
+        case spv::OpLabel:
+        case spv::OpLoad:
+        case spv::OpReturn:
+            break;
+
+        case spv::OpImageSampleImplicitLod:
+            /* No bias or offset operands. */
+            if (inst.count != 4)
+                return false;
+            break;
+
+        case spv::OpStore:
+            if (stored || inst.count < 2
+                || !m.resolve(inst.ops[0], variable, member)
+                || member >= 0
+                || !m.has_storage(variable, spv::StorageClassOutput)
+                || !m.has_location(variable, 0))
+                return false;
+
+            sample = m.find(inst.ops[1], spv::OpImageSampleImplicitLod);
+            if (!sample
+                || !m.resolve_load(sample->ops[2], texture, texture_member)
+                || texture_member >= 0
+                || !m.has_storage(texture, spv::StorageClassUniformConstant)
+                || !m.bindings.count(texture)
+                || m.bindings.at(texture) != source_meta[0].binding
+                || !m.resolve_load(sample->ops[3], coord, coord_member)
+                || coord_member >= 0
+                || !m.has_storage(coord, spv::StorageClassInput)
+                || !m.has_location(coord, tex_location))
+                return false;
+
+            /* mediump may round on the way through. */
+            if (m.is_relaxed(variable) || m.is_relaxed(texture)
+                || m.is_relaxed(inst.ops[1]))
+                return false;
+
+            stored = true;
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    return stored;
+}
+
+bool slang_spirv_is_passthrough(const std::vector<uint32_t>& vertex,
+    const std::vector<uint32_t>& fragment,
+    const slang_reflection& reflection)
+{
+    slang_passthrough_module vertex_module;
+    slang_passthrough_module fragment_module;
+    uint32_t tex_location = 0;
+
+    return vertex_module.parse(vertex)
+        && fragment_module.parse(fragment)
+        && slang_vertex_is_passthrough(vertex_module, reflection, tex_location)
+        && slang_fragment_is_passthrough(fragment_module, reflection, tex_location);
 }
@@ -166,6 +166,10 @@ struct slang_reflection
     const std::unordered_map<std::string, slang_texture_semantic_map>* texture_semantic_uniform_map = nullptr;
     const std::unordered_map<std::string, slang_semantic_map>* semantic_map = nullptr;
     unsigned pass_number = 0;
+
+    /* Set when the result was loaded from the shader cache
+     * instead of being reflected with SPIRV-Cross. */
+    bool cached = false;
 };
 
 template <typename P>
@@ -180,7 +184,19 @@ static bool slang_set_unique_map(std::unordered_map<std::string, P>& m,
     return true;
 }
 
+/* Reflects a vertex/fragment SPIR-V pair against the name maps in
+ * @reflection. Results are cached on disk keyed by the SPIR-V and
+ * the maps, so a hit skips SPIRV-Cross entirely. */
 bool slang_reflect_spirv(
     const std::vector<uint32_t>& vertex,
     const std::vector<uint32_t>& fragment,
     slang_reflection* reflection);
+
+/* True when the pair does nothing but copy Source to the output:
+ * gl_Position = MVP * Position, vTexCoord = TexCoord and
+ * FragColor = texture(Source, vTexCoord). Such a pass run at
+ * 1:1 reproduces its input bit for bit. */
+bool slang_spirv_is_passthrough(
+    const std::vector<uint32_t>& vertex,
+    const std::vector<uint32_t>& fragment,
+    const slang_reflection& reflection);
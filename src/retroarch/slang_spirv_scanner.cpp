@@ -0,0 +1,844 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "slang_spirv_scanner.h"
+
+#include <ctype.h>
+#include <algorithm>
+
+using namespace std;
+using namespace spirv_cross;
+
+/* Larger modules are left to spirv_cross::Compiler rather than
+ * allocating per-ID slots for them. */
+#define SLANG_SPIRV_MAX_BOUND (1u << 18)
+#define SLANG_SPIRV_MAX_MEMBERS 4096
+/* SPIR-V forbids recursion, this only guards against broken modules. */
+#define SLANG_SPIRV_MAX_CALL_DEPTH 64
+
+static const std::string slang_spirv_empty_string;
+
+static bool slang_spirv_string(const uint32_t* ops, uint32_t length,
+    std::string& str, uint32_t* words)
+{
+    uint32_t i, j;
+
+    str.clear();
+    for (i = 0; i < length; i++)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            char c = char((ops[i] >> (j * 8)) & 0xff);
+            if (!c)
+            {
+                *words = i + 1;
+                return true;
+            }
+            str += c;
+        }
+    }
+
+    return false;
+}
+
+/* Same clean-up spirv_cross::ParsedIR applies to OpName/OpMemberName,
+ * so names compare equal to what the full parser reports. */
+static std::string slang_spirv_identifier(const std::string& name, bool member)
+{
+    size_t i;
+    std::string str = name.substr(0, name.find('('));
+
+    for (i = 0; i < str.size(); i++)
+    {
+        char& c = str[i];
+        bool leading = member
+            ? (i == 0 || (i == 2 && str[0] == '_' && str[1] == 'm'))
+            : (i == 0 || (str[0] == '_' && i == 1));
+
+        if (leading)
+            c = isalpha((unsigned char)c) ? c : '_';
+        else
+            c = isalnum((unsigned char)c) ? c : '_';
+    }
+
+    return str;
+}
+
+static void slang_spirv_set_name(std::string& str, const std::string& name,
+    bool member)
+{
+    str.clear();
+    if (name.empty())
+        return;
+
+    /* Reserved for temporaries and unnamed members. */
+    if (member)
+    {
+        if (name[0] == '_' && name.size() >= 3 && name[1] == 'm'
+            && isdigit((unsigned char)name[2]))
+            return;
+    }
+    else if (name[0] == '_' && name.size() >= 2
+        && isdigit((unsigned char)name[1]))
+        return;
+
+    str = slang_spirv_identifier(name, member);
+}
+
+static SPIRType::BaseType slang_spirv_int_type(uint32_t width, bool is_signed)
+{
+    switch (width)
+    {
+    case 8:
+        return is_signed ? SPIRType::SByte : SPIRType::UByte;
+    case 16:
+        return is_signed ? SPIRType::Short : SPIRType::UShort;
+    case 32:
+        return is_signed ? SPIRType::Int : SPIRType::UInt;
+    case 64:
+        return is_signed ? SPIRType::Int64 : SPIRType::UInt64;
+    default:
+        return SPIRType::Unknown;
+    }
+}
+
+bool slang_spirv_scanner::add_type(uint32_t id, const SPIRType& type)
+{
+    if (!valid_id(id) || ids[id].kind != ID_NONE)
+        return false;
+
+    ids[id].kind = ID_TYPE;
+    ids[id].index = uint32_t(types.size());
+    types.push_back(type);
+    return true;
+}
+
+bool slang_spirv_scanner::scan(const uint32_t* words, size_t num_words)
+{
+    size_t offset = 5;
+    bool in_function = false;
+
+    ids.clear();
+    types.clear();
+    variables.clear();
+    functions.clear();
+    events.clear();
+    entry_interface.clear();
+    entry_point = 0;
+    num_entry_points = 0;
+
+    /* Byte swapped modules are valid but never produced by glslang. */
+    if (num_words < 5 || words[0] != spv::MagicNumber)
+        return false;
+    if (words[3] == 0 || words[3] > SLANG_SPIRV_MAX_BOUND)
+        return false;
+
+    ids.resize(words[3]);
+
+    while (offset < num_words)
+    {
+        uint32_t count = words[offset] >> 16;
+        spv::Op op = spv::Op(words[offset] & 0xffff);
+        const uint32_t* ops = words + offset + 1;
+        uint32_t length = count - 1;
+
+        if (count == 0 || count > num_words - offset)
+            return false;
+
+        offset += count;
+
+        switch (op)
+        {
+        case spv::OpEntryPoint:
+        {
+            std::string name;
+            uint32_t name_words = 0;
+
+            if (length < 3 || !valid_id(ops[1]))
+                return false;
+            if (!slang_spirv_string(ops + 2, length - 2, name, &name_words))
+                return false;
+
+            num_entry_points++;
+            slang_spirv_set_name(ids[ops[1]].name, name, false);
+
+            if (!entry_point)
+            {
+                entry_point = ops[1];
+                entry_interface.assign(ops + 2 + name_words, ops + length);
+            }
+            break;
+        }
+
+        case spv::OpName:
+        case spv::OpMemberName:
+        {
+            std::string name;
+            uint32_t name_words = 0;
+            bool member = op == spv::OpMemberName;
+            uint32_t first = member ? 2 : 1;
+
+            if (length <= first || !valid_id(ops[0]))
+                return false;
+            if (!slang_spirv_string(ops + first, length - first,
+                name, &name_words))
+                return false;
+
+            if (member)
+            {
+                std::vector<member_meta>& members = ids[ops[0]].members;
+                if (ops[1] >= SLANG_SPIRV_MAX_MEMBERS)
+                    return false;
+                if (members.size() <= ops[1])
+                    members.resize(ops[1] + 1);
+                slang_spirv_set_name(members[ops[1]].name, name, true);
+            }
+            else
+                slang_spirv_set_name(ids[ops[0]].name, name, false);
+            break;
+        }
+
+        case spv::OpDecorate:
+        case spv::OpDecorateId:
+        {
+            uint32_t value;
+
+            if (length < 2 || !valid_id(ops[0]))
+                return false;
+
+            id_meta& meta = ids[ops[0]];
+            value = length >= 3 ? ops[2] : 0;
+
+            switch (spv::Decoration(ops[1]))
+            {
+            case spv::DecorationLocation:
+                meta.flags |= DECORATION_LOCATION;
+                meta.location = value;
+                break;
+            case spv::DecorationBinding:
+                meta.flags |= DECORATION_BINDING;
+                meta.binding = value;
+                break;
+            case spv::DecorationDescriptorSet:
+                meta.flags |= DECORATION_SET;
+                meta.set = value;
+                break;
+            case spv::DecorationBuiltIn:
+                meta.flags |= DECORATION_BUILTIN;
+                meta.builtin = value;
+                break;
+            case spv::DecorationArrayStride:
+                meta.flags |= DECORATION_ARRAY_STRIDE;
+                meta.array_stride = value;
+                break;
+            case spv::DecorationBlock:
+                meta.flags |= DECORATION_BLOCK;
+                break;
+            case spv::DecorationBufferBlock:
+                meta.flags |= DECORATION_BUFFER_BLOCK;
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+
+        case spv::OpMemberDecorate:
+        {
+            uint32_t value;
+
+            if (length < 3 || !valid_id(ops[0]))
+                return false;
+            if (ops[1] >= SLANG_SPIRV_MAX_MEMBERS)
+                return false;
+
+            std::vector<member_meta>& members = ids[ops[0]].members;
+            if (members.size() <= ops[1])
+                members.resize(ops[1] + 1);
+
+            member_meta& meta = members[ops[1]];
+            value = length >= 4 ? ops[3] : 0;
+
+            switch (spv::Decoration(ops[2]))
+            {
+            case spv::DecorationOffset:
+                meta.flags |= MEMBER_OFFSET;
+                meta.offset = value;
+                break;
+            case spv::DecorationMatrixStride:
+                meta.flags |= MEMBER_MATRIX_STRIDE;
+                meta.matrix_stride = value;
+                break;
+            case spv::DecorationRowMajor:
+                meta.flags |= MEMBER_ROW_MAJOR;
+                break;
+            case spv::DecorationColMajor:
+                meta.flags |= MEMBER_COL_MAJOR;
+                break;
+            case spv::DecorationBuiltIn:
+                meta.flags |= MEMBER_BUILTIN;
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+
+        /* Would need the group fan-out tracked, leave it to SPIRV-Cross. */
+        case spv::OpGroupDecorate:
+        case spv::OpGroupMemberDecorate:
+        case spv::OpTypeForwardPointer:
+            return false;
+
+        case spv::OpTypeVoid:
+        case spv::OpTypeBool:
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat:
+        case spv::OpTypeImage:
+        case spv::OpTypeSampler:
+        case spv::OpTypeStruct:
+        case spv::OpTypeAccelerationStructureNV:
+        {
+            SPIRType type;
+            uint32_t i;
+
+            if (length < 1)
+                return false;
+
+            type.self = ops[0];
+            type.image = SPIRType::ImageType();
+
+            switch (op)
+            {
+            case spv::OpTypeVoid:
+                type.basetype = SPIRType::Void;
+                break;
+            case spv::OpTypeBool:
+                type.basetype = SPIRType::Boolean;
+                type.width = 1;
+                break;
+            case spv::OpTypeInt:
+                if (length < 3)
+                    return false;
+                type.basetype = slang_spirv_int_type(ops[1], ops[2] != 0);
+                type.width = ops[1];
+                break;
+            case spv::OpTypeFloat:
+                if (length < 2)
+                    return false;
+                if (ops[1] == 64)
+                    type.basetype = SPIRType::Double;
+                else if (ops[1] == 32)
+                    type.basetype = SPIRType::Float;
+                else if (ops[1] == 16)
+                    type.basetype = SPIRType::Half;
+                else
+                    return false;
+                type.width = ops[1];
+                break;
+            case spv::OpTypeImage:
+                if (length < 8)
+                    return false;
+                type.basetype = SPIRType::Image;
+                type.image.type = ops[1];
+                type.image.dim = spv::Dim(ops[2]);
+                type.image.depth = ops[3] == 1;
+                type.image.arrayed = ops[4] != 0;
+                type.image.ms = ops[5] != 0;
+                type.image.sampled = ops[6];
+                type.image.format = spv::ImageFormat(ops[7]);
+                type.image.access = length >= 9
+                    ? spv::AccessQualifier(ops[8])
+                    : spv::AccessQualifierMax;
+                break;
+            case spv::OpTypeSampler:
+                type.basetype = SPIRType::Sampler;
+                break;
+            case spv::OpTypeStruct:
+                type.basetype = SPIRType::Struct;
+                for (i = 1; i < length; i++)
+                    type.member_types.push_back(ops[i]);
+                break;
+            default:
+                type.basetype = SPIRType::AccelerationStructureNV;
+                break;
+            }
+
+            if (!add_type(ops[0], type))
+                return false;
+            break;
+        }
+
+        /* Derived types start as a copy of their base, exactly like the
+         * full parser, so self keeps pointing at the innermost struct
+         * for arrays and pointers. */
+        case spv::OpTypeVector:
+        case spv::OpTypeMatrix:
+        case spv::OpTypeSampledImage:
+        case spv::OpTypeArray:
+        case spv::OpTypeRuntimeArray:
+        case spv::OpTypePointer:
+        {
+            uint32_t base = op == spv::OpTypePointer ? 2 : 1;
+
+            if (length <= base || !valid_id(ops[base])
+                || ids[ops[base]].kind != ID_TYPE)
+                return false;
+
+            SPIRType type = types[ids[ops[base]].index];
+            type.parent_type = ops[base];
+
+            switch (op)
+            {
+            case spv::OpTypeVector:
+                if (length < 3)
+                    return false;
+                type.vecsize = ops[2];
+                type.self = ops[0];
+                break;
+            case spv::OpTypeMatrix:
+                if (length < 3)
+                    return false;
+                type.columns = ops[2];
+                type.self = ops[0];
+                break;
+            case spv::OpTypeSampledImage:
+                type.basetype = SPIRType::SampledImage;
+                type.parent_type = 0;
+                type.self = ops[0];
+                break;
+            case spv::OpTypeArray:
+                /* Sizes from specialization constant ops are not modelled. */
+                if (length < 3 || !valid_id(ops[2])
+                    || ids[ops[2]].kind != ID_CONSTANT)
+                    return false;
+                type.array.push_back(ids[ops[2]].index);
+                type.array_size_literal.push_back(true);
+                break;
+            case spv::OpTypeRuntimeArray:
+                type.array.push_back(0);
+                type.array_size_literal.push_back(true);
+                break;
+            default:
+                type.pointer = true;
+                type.pointer_depth++;
+                type.storage = spv::StorageClass(ops[1]);
+                if (type.storage == spv::StorageClassAtomicCounter)
+                    type.basetype = SPIRType::AtomicCounter;
+                break;
+            }
+
+            if (!add_type(ops[0], type))
+                return false;
+            break;
+        }
+
+        case spv::OpConstant:
+        case spv::OpSpecConstant:
+            if (length < 3 || !valid_id(ops[1]) || ids[ops[1]].kind != ID_NONE)
+                return false;
+            ids[ops[1]].kind = ID_CONSTANT;
+            ids[ops[1]].index = ops[2];
+            break;
+
+        case spv::OpVariable:
+        {
+            variable var;
+
+            if (length < 3 || !valid_id(ops[1]))
+                return false;
+
+            /* Locals never show up in reflection. */
+            if (spv::StorageClass(ops[2]) == spv::StorageClassFunction)
+                break;
+
+            if (!valid_id(ops[0]) || ids[ops[0]].kind != ID_TYPE
+                || ids[ops[1]].kind != ID_NONE)
+                return false;
+
+            var.self = ops[1];
+            var.type = ops[0];
+            var.storage = spv::StorageClass(ops[2]);
+
+            ids[ops[1]].kind = ID_VARIABLE;
+            ids[ops[1]].index = uint32_t(variables.size());
+            variables.push_back(var);
+            break;
+        }
+
+        case spv::OpFunction:
+            if (in_function || length < 2 || !valid_id(ops[1])
+                || ids[ops[1]].kind != ID_NONE)
+                return false;
+
+            ids[ops[1]].kind = ID_FUNCTION;
+            ids[ops[1]].index = uint32_t(functions.size());
+            functions.push_back(function());
+            functions.back().first_event = uint32_t(events.size());
+            in_function = true;
+            break;
+
+        case spv::OpFunctionEnd:
+            if (!in_function)
+                return false;
+            functions.back().num_events =
+                uint32_t(events.size()) - functions.back().first_event;
+            in_function = false;
+            break;
+
+        /* Everything else in a function body is skipped. */
+        case spv::OpFunctionCall:
+            if (!in_function || length < 3)
+                return false;
+            events.push_back({ 0, ops[2] });
+            break;
+
+        case spv::OpAccessChain:
+        case spv::OpInBoundsAccessChain:
+        case spv::OpPtrAccessChain:
+        {
+            bool ptr_chain = op == spv::OpPtrAccessChain;
+
+            /* SPIRV-Cross stops the whole buffer range walk on these. */
+            if (length < (ptr_chain ? 5u : 4u))
+                return false;
+
+            if (in_function && valid_id(ops[2])
+                && ids[ops[2]].kind == ID_VARIABLE)
+                events.push_back({ ops[2], ops[ptr_chain ? 4 : 3] });
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    if (in_function || !valid_id(entry_point)
+        || ids[entry_point].kind != ID_FUNCTION)
+        return false;
+
+    for (auto& ev : events)
+    {
+        if (!ev.base && (!valid_id(ev.index)
+            || ids[ev.index].kind != ID_FUNCTION))
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t slang_spirv_scanner::get_decoration(uint32_t id,
+    spv::Decoration decoration) const
+{
+    if (!valid_id(id))
+        return 0;
+
+    const id_meta& meta = ids[id];
+
+    switch (decoration)
+    {
+    case spv::DecorationLocation:
+        return (meta.flags & DECORATION_LOCATION) ? meta.location : 0;
+    case spv::DecorationBinding:
+        return (meta.flags & DECORATION_BINDING) ? meta.binding : 0;
+    case spv::DecorationDescriptorSet:
+        return (meta.flags & DECORATION_SET) ? meta.set : 0;
+    case spv::DecorationBuiltIn:
+        return (meta.flags & DECORATION_BUILTIN) ? meta.builtin : 0;
+    case spv::DecorationArrayStride:
+        return (meta.flags & DECORATION_ARRAY_STRIDE) ? meta.array_stride : 0;
+    default:
+        return 0;
+    }
+}
+
+const std::string& slang_spirv_scanner::get_name(uint32_t id) const
+{
+    return valid_id(id) ? ids[id].name : slang_spirv_empty_string;
+}
+
+const std::string& slang_spirv_scanner::get_member_name(uint32_t id,
+    uint32_t index) const
+{
+    if (!valid_id(id) || index >= ids[id].members.size())
+        return slang_spirv_empty_string;
+    return ids[id].members[index].name;
+}
+
+const SPIRType& slang_spirv_scanner::get_type(uint32_t id) const
+{
+    if (!valid_id(id) || ids[id].kind != ID_TYPE)
+        SPIRV_CROSS_THROW("Bad cast");
+    return types[ids[id].index];
+}
+
+uint32_t slang_spirv_scanner::get_constant(uint32_t id) const
+{
+    if (!valid_id(id) || ids[id].kind != ID_CONSTANT)
+        SPIRV_CROSS_THROW("Bad cast");
+    return ids[id].index;
+}
+
+size_t slang_spirv_scanner::get_declared_struct_size(const SPIRType& type) const
+{
+    uint32_t last;
+
+    if (type.member_types.empty())
+        SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+
+    last = uint32_t(type.member_types.size() - 1);
+    if (last >= ids[type.self].members.size()
+        || !(ids[type.self].members[last].flags & MEMBER_OFFSET))
+        SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+
+    return ids[type.self].members[last].offset
+        + get_declared_struct_member_size(type, last);
+}
+
+size_t slang_spirv_scanner::get_declared_struct_member_size(
+    const SPIRType& struct_type, uint32_t index) const
+{
+    uint32_t flags = 0;
+
+    if (struct_type.member_types.empty())
+        SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+    if (index >= struct_type.member_types.size())
+        SPIRV_CROSS_THROW("Struct member index out of range.");
+
+    const std::vector<member_meta>& members = ids[struct_type.self].members;
+    const SPIRType& type = get_type(struct_type.member_types[index]);
+
+    if (index < members.size())
+        flags = members[index].flags;
+
+    switch (type.basetype)
+    {
+    case SPIRType::Unknown:
+    case SPIRType::Void:
+    case SPIRType::Boolean:
+    case SPIRType::AtomicCounter:
+    case SPIRType::Image:
+    case SPIRType::SampledImage:
+    case SPIRType::Sampler:
+        SPIRV_CROSS_THROW("Querying size for object with opaque size.");
+    default:
+        break;
+    }
+
+    if (!type.array.empty())
+    {
+        /* ArrayStride sits on the array type, not the member. */
+        const id_meta& array_meta = ids[struct_type.member_types[index]];
+        if (!(array_meta.flags & DECORATION_ARRAY_STRIDE))
+            SPIRV_CROSS_THROW("Struct member does not have ArrayStride set.");
+        return size_t(array_meta.array_stride) * type.array.back();
+    }
+
+    if (type.basetype == SPIRType::Struct)
+        return get_declared_struct_size(type);
+
+    if (type.columns == 1)
+        return type.vecsize * (type.width / 8);
+
+    if (!(flags & MEMBER_MATRIX_STRIDE))
+        SPIRV_CROSS_THROW("Struct member does not have MatrixStride set.");
+
+    /* Matrices are tightly packed and aligned up for vec3 accesses. */
+    if (flags & MEMBER_ROW_MAJOR)
+        return size_t(members[index].matrix_stride) * type.vecsize;
+    if (flags & MEMBER_COL_MAJOR)
+        return size_t(members[index].matrix_stride) * type.columns;
+
+    SPIRV_CROSS_THROW("Either row-major or column-major must be declared for matrices.");
+}
+
+bool slang_spirv_scanner::collect_buffer_ranges(uint32_t func, uint32_t id,
+    std::vector<uint32_t>& seen, SmallVector<BufferRange>& ranges,
+    unsigned depth) const
+{
+    uint32_t i;
+    const function& f = functions[func];
+
+    if (depth > SLANG_SPIRV_MAX_CALL_DEPTH)
+        SPIRV_CROSS_THROW("Function call depth exceeded.");
+
+    for (i = 0; i < f.num_events; i++)
+    {
+        uint32_t index;
+        size_t offset, range;
+        const function_event& ev = events[f.first_event + i];
+
+        if (!ev.base)
+        {
+            collect_buffer_ranges(ids[ev.index].index, id,
+                seen, ranges, depth + 1);
+            continue;
+        }
+
+        if (ev.base != id)
+            continue;
+
+        /* A struct member counts as fully used once it is indexed. */
+        index = get_constant(ev.index);
+        if (find(seen.begin(), seen.end(), index) != seen.end())
+            continue;
+        seen.push_back(index);
+
+        const SPIRType& type = get_type(variables[ids[id].index].type);
+        const std::vector<member_meta>& members = ids[type.self].members;
+
+        if (index >= members.size() || !(members[index].flags & MEMBER_OFFSET))
+            SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+        offset = members[index].offset;
+
+        /* Offsets increase monotonically, so the next member bounds
+         * the range, padding included. */
+        if (index + 1 < type.member_types.size())
+        {
+            if (index + 1 >= members.size()
+                || !(members[index + 1].flags & MEMBER_OFFSET))
+                SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+            range = members[index + 1].offset - offset;
+        }
+        else
+            range = get_declared_struct_member_size(type, index);
+
+        ranges.push_back({ index, offset, range });
+    }
+
+    return true;
+}
+
+SmallVector<BufferRange> slang_spirv_scanner::get_active_buffer_ranges(
+    uint32_t id) const
+{
+    std::vector<uint32_t> seen;
+    SmallVector<BufferRange> ranges;
+
+    collect_buffer_ranges(ids[entry_point].index, id, seen, ranges, 0);
+    return ranges;
+}
+
+bool slang_spirv_scanner::is_builtin_variable(const variable& var) const
+{
+    const SPIRType& type = get_type(var.type);
+
+    if (ids[var.self].flags & DECORATION_BUILTIN)
+        return true;
+
+    for (auto& member : ids[type.self].members)
+    {
+        if (member.flags & MEMBER_BUILTIN)
+            return true;
+    }
+
+    return false;
+}
+
+bool slang_spirv_scanner::interface_variable_exists_in_entry_point(
+    uint32_t id) const
+{
+    /* Very old glslang did not list interfaces, single entry point
+     * modules are assumed to use everything. */
+    if (num_entry_points <= 1)
+        return true;
+
+    return find(entry_interface.begin(), entry_interface.end(), id)
+        != entry_interface.end();
+}
+
+std::string slang_spirv_scanner::get_block_name(const variable& var) const
+{
+    const SPIRType& type = get_type(var.type);
+
+    std::string name;
+
+    if (!ids[type.self].name.empty())
+        return ids[type.self].name;
+    if (!ids[var.self].name.empty())
+        return ids[var.self].name;
+
+    /* Appended piece by piece, prepending to a temporary trips -Wrestrict. */
+    name.append("_").append(to_string(type.self));
+    name.append("_").append(to_string(var.self));
+    return name;
+}
+
+ShaderResources slang_spirv_scanner::get_shader_resources() const
+{
+    ShaderResources res;
+
+    for (auto& var : variables)
+    {
+        const SPIRType& type = get_type(var.type);
+        bool block = (ids[type.self].flags & DECORATION_BLOCK) != 0;
+        Resource resource = { var.self, var.type, type.self, ids[var.self].name };
+
+        if (!type.pointer || is_builtin_variable(var))
+            continue;
+
+        if (var.storage == spv::StorageClassInput
+            && interface_variable_exists_in_entry_point(var.self))
+        {
+            if (block)
+                resource.name = get_block_name(var);
+            res.stage_inputs.push_back(resource);
+        }
+        else if (var.storage == spv::StorageClassUniformConstant
+            && type.image.dim == spv::DimSubpassData)
+            res.subpass_inputs.push_back(resource);
+        else if (var.storage == spv::StorageClassOutput
+            && interface_variable_exists_in_entry_point(var.self))
+        {
+            if (block)
+                resource.name = get_block_name(var);
+            res.stage_outputs.push_back(resource);
+        }
+        else if (type.storage == spv::StorageClassUniform && block)
+        {
+            resource.name = get_block_name(var);
+            res.uniform_buffers.push_back(resource);
+        }
+        else if ((type.storage == spv::StorageClassUniform
+            && (ids[type.self].flags & DECORATION_BUFFER_BLOCK))
+            || type.storage == spv::StorageClassStorageBuffer)
+        {
+            resource.name = get_block_name(var);
+            res.storage_buffers.push_back(resource);
+        }
+        else if (type.storage == spv::StorageClassPushConstant)
+            res.push_constant_buffers.push_back(resource);
+        else if (type.storage == spv::StorageClassUniformConstant
+            && type.basetype == SPIRType::Image && type.image.sampled == 2)
+            res.storage_images.push_back(resource);
+        else if (type.storage == spv::StorageClassUniformConstant
+            && type.basetype == SPIRType::Image && type.image.sampled == 1)
+            res.separate_images.push_back(resource);
+        else if (type.storage == spv::StorageClassUniformConstant
+            && type.basetype == SPIRType::Sampler)
+            res.separate_samplers.push_back(resource);
+        else if (type.storage == spv::StorageClassUniformConstant
+            && type.basetype == SPIRType::SampledImage)
+            res.sampled_images.push_back(resource);
+        else if (type.storage == spv::StorageClassAtomicCounter)
+            res.atomic_counters.push_back(resource);
+        else if (type.storage == spv::StorageClassUniformConstant
+            && type.basetype == SPIRType::AccelerationStructureNV)
+            res.acceleration_structures.push_back(resource);
+    }
+
+    return res;
+}
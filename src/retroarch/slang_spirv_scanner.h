@@ -0,0 +1,153 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "../spirv-cross/spirv_cross.hpp"
+
+/* Single pass, reflection-only SPIR-V reader.
+ *
+ * spirv_cross::Compiler builds the full IR including every block and
+ * the CFG before it can answer a single query. Reflection only needs
+ * names, decorations, types, global variables, the entry point interface
+ * and which struct members each function indexes, so this walks the
+ * module once, keeps per-ID data in flat arrays and reduces function
+ * bodies to a list of access chains and calls.
+ *
+ * The query methods mirror the subset of spirv_cross::Compiler used by
+ * slang_reflect() and give the same answers, including throwing
+ * spirv_cross::CompilerError where the Compiler would. */
+class slang_spirv_scanner
+{
+public:
+    /* Returns false for malformed modules and for constructs the scanner
+     * does not model (decoration groups, specialization constant ops as
+     * array sizes, ...). Callers should fall back to spirv_cross::Compiler. */
+    bool scan(const uint32_t* words, size_t num_words);
+
+    spirv_cross::ShaderResources get_shader_resources() const;
+    spirv_cross::SmallVector<spirv_cross::BufferRange>
+        get_active_buffer_ranges(uint32_t id) const;
+
+    /* Only Location, Binding, DescriptorSet, BuiltIn and ArrayStride
+     * are tracked, anything else reads as 0. */
+    uint32_t get_decoration(uint32_t id, spv::Decoration decoration) const;
+    const std::string& get_name(uint32_t id) const;
+    const std::string& get_member_name(uint32_t id, uint32_t index) const;
+    const spirv_cross::SPIRType& get_type(uint32_t id) const;
+
+    size_t get_declared_struct_size(const spirv_cross::SPIRType& type) const;
+    size_t get_declared_struct_member_size(
+        const spirv_cross::SPIRType& struct_type, uint32_t index) const;
+
+private:
+    enum
+    {
+        DECORATION_LOCATION = 1 << 0,
+        DECORATION_BINDING = 1 << 1,
+        DECORATION_SET = 1 << 2,
+        DECORATION_BUILTIN = 1 << 3,
+        DECORATION_ARRAY_STRIDE = 1 << 4,
+        DECORATION_BLOCK = 1 << 5,
+        DECORATION_BUFFER_BLOCK = 1 << 6
+    };
+
+    enum
+    {
+        MEMBER_OFFSET = 1 << 0,
+        MEMBER_MATRIX_STRIDE = 1 << 1,
+        MEMBER_ROW_MAJOR = 1 << 2,
+        MEMBER_COL_MAJOR = 1 << 3,
+        MEMBER_BUILTIN = 1 << 4
+    };
+
+    enum id_kind
+    {
+        ID_NONE = 0,
+        ID_TYPE,
+        ID_CONSTANT,
+        ID_VARIABLE,
+        ID_FUNCTION
+    };
+
+    struct member_meta
+    {
+        std::string name;
+        uint32_t offset = 0;
+        uint32_t matrix_stride = 0;
+        uint32_t flags = 0;
+    };
+
+    /* One slot per SPIR-V ID, sized from the module bound up front. */
+    struct id_meta
+    {
+        id_kind kind = ID_NONE;
+        /* Index into types, variables or functions, or the constant value. */
+        uint32_t index = 0;
+        uint32_t flags = 0;
+        uint32_t location = 0;
+        uint32_t binding = 0;
+        uint32_t set = 0;
+        uint32_t builtin = 0;
+        uint32_t array_stride = 0;
+        std::string name;
+        std::vector<member_meta> members;
+    };
+
+    struct variable
+    {
+        uint32_t self;
+        uint32_t type;
+        spv::StorageClass storage;
+    };
+
+    /* An access chain into a global variable, or a call when base is 0. */
+    struct function_event
+    {
+        uint32_t base;
+        uint32_t index;
+    };
+
+    struct function
+    {
+        uint32_t first_event = 0;
+        uint32_t num_events = 0;
+    };
+
+    std::vector<id_meta> ids;
+    std::vector<spirv_cross::SPIRType> types;
+    std::vector<variable> variables;
+    std::vector<function> functions;
+    std::vector<function_event> events;
+    std::vector<uint32_t> entry_interface;
+    uint32_t entry_point = 0;
+    unsigned num_entry_points = 0;
+
+    bool valid_id(uint32_t id) const { return id != 0 && id < ids.size(); }
+    bool add_type(uint32_t id, const spirv_cross::SPIRType& type);
+    bool is_builtin_variable(const variable& var) const;
+    bool interface_variable_exists_in_entry_point(uint32_t id) const;
+    std::string get_block_name(const variable& var) const;
+    uint32_t get_constant(uint32_t id) const;
+    bool collect_buffer_ranges(uint32_t func, uint32_t id,
+        std::vector<uint32_t>& seen,
+        spirv_cross::SmallVector<spirv_cross::BufferRange>& ranges,
+        unsigned depth) const;
+};
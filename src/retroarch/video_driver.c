@@ -562,6 +562,15 @@ retro_proc_address_t video_driver_get_proc_address(const char* sym)
     return NULL;
 }
 
+unsigned video_driver_get_history_size(void)
+{
+    video_driver_state_t* video_st = &video_driver_st;
+    if (video_st->poke
+        && video_st->poke->get_history_size)
+        return video_st->poke->get_history_size(video_st->data);
+    return 0;
+}
+
 void video_driver_frame(const void* data, unsigned width,
     unsigned height, size_t pitch)
 {
@@ -220,6 +220,10 @@ typedef struct video_poke_interface
     void (*set_hdr_paper_white_nits)(void* data, float paper_white_nits);
     void (*set_hdr_contrast)(void* data, float contrast);
     void (*set_hdr_expand_gamut)(void* data, bool expand_gamut);
+
+    /* Frames after its own an input image must stay alive,
+     * the shader history binds earlier inputs directly. */
+    unsigned (*get_history_size)(void* data);
 } video_poke_interface_t;
 
 typedef struct video_viewport
@@ -549,7 +553,9 @@ struct video_shader_parameter
     char desc[64];
 };
 
-#define PATH_MAX_LENGTH 4096
+#define RARCH_FILTER_UNSPEC 0
+#define RARCH_FILTER_LINEAR 1
+#define RARCH_FILTER_NEAREST 2
 
 enum gfx_scale_type
 {
@@ -598,6 +604,8 @@ struct video_shader_pass
         char path[PATH_MAX_LENGTH];
     } source;
     char alias[64];
+    /* Render target format requested by #pragma format, empty if unset. */
+    char format[64];
     bool mipmap;
     bool feedback;
 };
@@ -709,6 +717,8 @@ uintptr_t video_driver_get_current_framebuffer(void);
 
 retro_proc_address_t video_driver_get_proc_address(const char* sym);
 
+unsigned video_driver_get_history_size(void);
+
 void video_driver_frame(const void* data, unsigned width,
     unsigned height, size_t pitch);
 
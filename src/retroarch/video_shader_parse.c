@@ -0,0 +1,651 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "video_shader_parse.h"
+#include "compat_strl.h"
+
+/* Files one preset may read, itself and every #reference it pulls in. */
+#define VIDEO_SHADER_MAX_REFERENCES 16
+/* Slang sources pulling in shared headers. */
+#define VIDEO_SHADER_MAX_INCLUDE_DEPTH 8
+
+struct video_shader_conf_entry
+{
+    char key[128];
+    char* value;
+    /* Index of the file that set this value, paths are relative to it. */
+    unsigned file;
+};
+
+struct video_shader_conf
+{
+    struct video_shader_conf_entry* entries;
+    size_t count;
+    size_t capacity;
+    char dirs[VIDEO_SHADER_MAX_REFERENCES][PATH_MAX_LENGTH];
+    unsigned num_dirs;
+};
+
+static char* video_shader_read_file(const char* path)
+{
+    long size;
+    char* data = NULL;
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+        return NULL;
+
+    if (fseek(file, 0, SEEK_END) != 0
+        || (size = ftell(file)) < 0
+        || fseek(file, 0, SEEK_SET) != 0)
+        goto end;
+
+    if (!(data = (char*)malloc((size_t)size + 1)))
+        goto end;
+
+    if (size && fread(data, (size_t)size, 1, file) != 1)
+    {
+        free(data);
+        data = NULL;
+        goto end;
+    }
+
+    data[size] = '\0';
+
+end:
+    fclose(file);
+    return data;
+}
+
+static void video_shader_base_dir(char* dir, size_t size, const char* path)
+{
+    char* slash;
+    char* backslash;
+
+    strlcpy(dir, path, size);
+
+    slash = strrchr(dir, '/');
+    backslash = strrchr(dir, '\\');
+    if (backslash > slash)
+        slash = backslash;
+
+    if (slash)
+        *slash = '\0';
+    else
+        *dir = '\0';
+}
+
+static bool video_shader_path_is_absolute(const char* path)
+{
+    if (path[0] == '/' || path[0] == '\\')
+        return true;
+    /* Drive letter */
+    return isalpha((unsigned char)path[0]) && path[1] == ':';
+}
+
+static void video_shader_resolve_path(char* out, size_t size,
+    const char* dir, const char* path)
+{
+    if (!*dir || video_shader_path_is_absolute(path))
+        strlcpy(out, path, size);
+    else
+        snprintf(out, size, "%s/%s", dir, path);
+}
+
+/* Trims leading and trailing whitespace in place. */
+static char* video_shader_trim(char* str)
+{
+    char* end;
+
+    while (isspace((unsigned char)*str))
+        str++;
+
+    end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+
+    return str;
+}
+
+/* Strips quotes from a value, or a trailing comment if unquoted. */
+static char* video_shader_unquote(char* value)
+{
+    char* end;
+
+    if (*value == '"')
+    {
+        value++;
+        if ((end = strchr(value, '"')))
+            *end = '\0';
+        return value;
+    }
+
+    if ((end = strchr(value, '#')))
+        *end = '\0';
+
+    return video_shader_trim(value);
+}
+
+static struct video_shader_conf_entry* video_shader_conf_find(
+    const struct video_shader_conf* conf, const char* key)
+{
+    size_t i;
+    for (i = 0; i < conf->count; i++)
+        if (string_is_equal(conf->entries[i].key, key))
+            return &conf->entries[i];
+    return NULL;
+}
+
+static bool video_shader_conf_set(struct video_shader_conf* conf,
+    const char* key, const char* value, unsigned file)
+{
+    struct video_shader_conf_entry* entry = video_shader_conf_find(conf, key);
+    char* copy = strldup(value, strlen(value) + 1);
+
+    if (!copy)
+        return false;
+
+    if (!entry)
+    {
+        if (conf->count == conf->capacity)
+        {
+            size_t capacity = conf->capacity ? conf->capacity * 2 : 64;
+            struct video_shader_conf_entry* entries =
+                (struct video_shader_conf_entry*)realloc(conf->entries,
+                    capacity * sizeof(*entries));
+
+            if (!entries)
+            {
+                free(copy);
+                return false;
+            }
+
+            conf->entries = entries;
+            conf->capacity = capacity;
+        }
+
+        entry = &conf->entries[conf->count++];
+        strlcpy(entry->key, key, sizeof(entry->key));
+    }
+    else
+        free(entry->value);
+
+    entry->value = copy;
+    entry->file = file;
+    return true;
+}
+
+static void video_shader_conf_free(struct video_shader_conf* conf)
+{
+    size_t i;
+    for (i = 0; i < conf->count; i++)
+        free(conf->entries[i].value);
+    free(conf->entries);
+    free(conf);
+}
+
+static bool video_shader_conf_parse(struct video_shader_conf* conf,
+    const char* path)
+{
+    char* line;
+    char* next;
+    unsigned file;
+    char* data;
+
+    if (conf->num_dirs >= VIDEO_SHADER_MAX_REFERENCES)
+    {
+        RARCH_LOG("[Shaders]: Too many #reference files at \"%s\".\n", path);
+        return false;
+    }
+
+    if (!(data = video_shader_read_file(path)))
+    {
+        RARCH_LOG("[Shaders]: Failed to read preset \"%s\".\n", path);
+        return false;
+    }
+
+    file = conf->num_dirs++;
+    video_shader_base_dir(conf->dirs[file], sizeof(conf->dirs[file]), path);
+
+    for (line = data; line; line = next)
+    {
+        char* eq;
+        char* key;
+
+        if ((next = strchr(line, '\n')))
+            *next++ = '\0';
+
+        line = video_shader_trim(line);
+
+        if (!strncmp(line, "#reference", STRLEN_CONST("#reference")))
+        {
+            char ref_path[PATH_MAX_LENGTH];
+            char* ref = video_shader_unquote(
+                video_shader_trim(line + STRLEN_CONST("#reference")));
+
+            video_shader_resolve_path(ref_path, sizeof(ref_path),
+                conf->dirs[file], ref);
+
+            if (!video_shader_conf_parse(conf, ref_path))
+            {
+                free(data);
+                return false;
+            }
+            continue;
+        }
+
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        if (!(eq = strchr(line, '=')))
+            continue;
+
+        *eq = '\0';
+        key = video_shader_trim(line);
+
+        if (!video_shader_conf_set(conf, key,
+            video_shader_unquote(video_shader_trim(eq + 1)), file))
+        {
+            free(data);
+            return false;
+        }
+    }
+
+    free(data);
+    return true;
+}
+
+static const char* video_shader_conf_get(const struct video_shader_conf* conf,
+    const char* key)
+{
+    const struct video_shader_conf_entry* entry = video_shader_conf_find(conf, key);
+    return entry ? entry->value : NULL;
+}
+
+static bool video_shader_conf_get_path(const struct video_shader_conf* conf,
+    const char* key, char* out, size_t size)
+{
+    const struct video_shader_conf_entry* entry = video_shader_conf_find(conf, key);
+
+    if (!entry || !*entry->value)
+        return false;
+
+    video_shader_resolve_path(out, size, conf->dirs[entry->file], entry->value);
+    return true;
+}
+
+static bool video_shader_conf_get_bool(const struct video_shader_conf* conf,
+    const char* key, bool* value)
+{
+    const char* str = video_shader_conf_get(conf, key);
+
+    if (!str)
+        return false;
+
+    *value = string_is_equal(str, "true") || string_is_equal(str, "1");
+    return true;
+}
+
+static enum gfx_wrap_type video_shader_wrap_str_to_mode(const char* wrap)
+{
+    if (string_is_equal(wrap, "clamp_to_border"))
+        return RARCH_WRAP_BORDER;
+    if (string_is_equal(wrap, "clamp_to_edge"))
+        return RARCH_WRAP_EDGE;
+    if (string_is_equal(wrap, "repeat"))
+        return RARCH_WRAP_REPEAT;
+    if (string_is_equal(wrap, "mirrored_repeat"))
+        return RARCH_WRAP_MIRRORED_REPEAT;
+
+    RARCH_LOG("[Shaders]: Invalid wrapping type \"%s\". Valid ones are: "
+        "clamp_to_border (default), clamp_to_edge, repeat and mirrored_repeat.\n", wrap);
+    return RARCH_WRAP_DEFAULT;
+}
+
+static bool video_shader_parse_scale_type(const char* str,
+    enum gfx_scale_type* type)
+{
+    if (string_is_equal(str, "source"))
+        *type = RARCH_SCALE_INPUT;
+    else if (string_is_equal(str, "viewport"))
+        *type = RARCH_SCALE_VIEWPORT;
+    else if (string_is_equal(str, "absolute"))
+        *type = RARCH_SCALE_ABSOLUTE;
+    else
+    {
+        RARCH_LOG("[Shaders]: Invalid scale type \"%s\".\n", str);
+        return false;
+    }
+
+    return true;
+}
+
+static bool video_shader_parse_fbo(const struct video_shader_conf* conf,
+    unsigned i, struct gfx_fbo_scale* fbo)
+{
+    char key[64];
+    const char* scale_type;
+    const char* scale_type_x;
+    const char* scale_type_y;
+    const char* value;
+
+    snprintf(key, sizeof(key), "float_framebuffer%u", i);
+    video_shader_conf_get_bool(conf, key, &fbo->fp_fbo);
+    snprintf(key, sizeof(key), "srgb_framebuffer%u", i);
+    video_shader_conf_get_bool(conf, key, &fbo->srgb_fbo);
+
+    fbo->type_x = fbo->type_y = RARCH_SCALE_INPUT;
+    fbo->scale_x = fbo->scale_y = 1.0f;
+
+    snprintf(key, sizeof(key), "scale_type%u", i);
+    scale_type = video_shader_conf_get(conf, key);
+    snprintf(key, sizeof(key), "scale_type_x%u", i);
+    scale_type_x = video_shader_conf_get(conf, key);
+    snprintf(key, sizeof(key), "scale_type_y%u", i);
+    scale_type_y = video_shader_conf_get(conf, key);
+
+    /* No scaling specified, the chain picks a default. */
+    if (!scale_type && !scale_type_x && !scale_type_y)
+        return true;
+
+    if (scale_type)
+    {
+        if (!video_shader_parse_scale_type(scale_type, &fbo->type_x))
+            return false;
+        fbo->type_y = fbo->type_x;
+    }
+
+    if (scale_type_x && !video_shader_parse_scale_type(scale_type_x, &fbo->type_x))
+        return false;
+    if (scale_type_y && !video_shader_parse_scale_type(scale_type_y, &fbo->type_y))
+        return false;
+
+    fbo->valid = true;
+
+    snprintf(key, sizeof(key), "scale%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+    {
+        fbo->abs_x = fbo->abs_y = (unsigned)strtoul(value, NULL, 0);
+        fbo->scale_x = fbo->scale_y = (float)atof(value);
+    }
+
+    snprintf(key, sizeof(key), "scale_x%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+    {
+        fbo->abs_x = (unsigned)strtoul(value, NULL, 0);
+        fbo->scale_x = (float)atof(value);
+    }
+
+    snprintf(key, sizeof(key), "scale_y%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+    {
+        fbo->abs_y = (unsigned)strtoul(value, NULL, 0);
+        fbo->scale_y = (float)atof(value);
+    }
+
+    return true;
+}
+
+static bool video_shader_parse_pass(const struct video_shader_conf* conf,
+    unsigned i, struct video_shader_pass* pass)
+{
+    char key[64];
+    const char* value;
+    bool linear;
+
+    snprintf(key, sizeof(key), "shader%u", i);
+    if (!video_shader_conf_get_path(conf, key,
+        pass->source.path, sizeof(pass->source.path)))
+    {
+        RARCH_LOG("[Shaders]: Couldn't parse shader source \"%s\".\n", key);
+        return false;
+    }
+
+    snprintf(key, sizeof(key), "filter_linear%u", i);
+    if (video_shader_conf_get_bool(conf, key, &linear))
+        pass->filter = linear ? RARCH_FILTER_LINEAR : RARCH_FILTER_NEAREST;
+    else
+        pass->filter = RARCH_FILTER_UNSPEC;
+
+    snprintf(key, sizeof(key), "wrap_mode%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+        pass->wrap = video_shader_wrap_str_to_mode(value);
+
+    snprintf(key, sizeof(key), "frame_count_mod%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+        pass->frame_count_mod = (unsigned)strtoul(value, NULL, 0);
+
+    snprintf(key, sizeof(key), "alias%u", i);
+    if ((value = video_shader_conf_get(conf, key)))
+        strlcpy(pass->alias, value, sizeof(pass->alias));
+
+    snprintf(key, sizeof(key), "mipmap_input%u", i);
+    video_shader_conf_get_bool(conf, key, &pass->mipmap);
+
+    return video_shader_parse_fbo(conf, i, &pass->fbo);
+}
+
+static bool video_shader_parse_textures(const struct video_shader_conf* conf,
+    struct video_shader* shader)
+{
+    char textures[1024];
+    char* id;
+    char* next;
+    const char* value = video_shader_conf_get(conf, "textures");
+
+    if (!value)
+        return true;
+
+    strlcpy(textures, value, sizeof(textures));
+
+    for (id = textures; id; id = next)
+    {
+        char key[128];
+        bool linear;
+        struct video_shader_lut* lut;
+
+        if ((next = strchr(id, ';')))
+            *next++ = '\0';
+
+        id = video_shader_trim(id);
+        if (!*id)
+            continue;
+
+        if (shader->luts >= GFX_MAX_TEXTURES)
+        {
+            RARCH_LOG("[Shaders]: Too many textures in preset.\n");
+            break;
+        }
+
+        lut = &shader->lut[shader->luts];
+        strlcpy(lut->id, id, sizeof(lut->id));
+
+        if (!video_shader_conf_get_path(conf, id, lut->path, sizeof(lut->path)))
+        {
+            RARCH_LOG("[Shaders]: Cannot find path to texture \"%s\".\n", id);
+            return false;
+        }
+
+        snprintf(key, sizeof(key), "%s_linear", id);
+        if (video_shader_conf_get_bool(conf, key, &linear))
+            lut->filter = linear ? RARCH_FILTER_LINEAR : RARCH_FILTER_NEAREST;
+        else
+            lut->filter = RARCH_FILTER_UNSPEC;
+
+        snprintf(key, sizeof(key), "%s_wrap_mode", id);
+        if ((value = video_shader_conf_get(conf, key)))
+            lut->wrap = video_shader_wrap_str_to_mode(value);
+
+        snprintf(key, sizeof(key), "%s_mipmap", id);
+        video_shader_conf_get_bool(conf, key, &lut->mipmap);
+
+        shader->luts++;
+    }
+
+    return true;
+}
+
+static void video_shader_add_parameter(struct video_shader* shader,
+    unsigned pass, const char* line)
+{
+    unsigned i;
+    struct video_shader_parameter param = { 0 };
+    int matched = sscanf(line, "#pragma parameter %63s \"%63[^\"]\" %f %f %f %f",
+        param.id, param.desc, &param.initial, &param.minimum,
+        &param.maximum, &param.step);
+
+    if (matched < 5)
+    {
+        RARCH_LOG("[Shaders]: Malformed parameter \"%s\".\n", line);
+        return;
+    }
+
+    if (matched < 6)
+        param.step = 0.1f * (param.maximum - param.minimum);
+
+    /* The same parameter is usually declared by every pass sharing it. */
+    for (i = 0; i < shader->num_parameters; i++)
+        if (string_is_equal(shader->parameters[i].id, param.id))
+            return;
+
+    if (shader->num_parameters >= GFX_MAX_PARAMETERS)
+        return;
+
+    param.pass = (int)pass;
+    param.current = param.initial;
+    shader->parameters[shader->num_parameters++] = param;
+}
+
+/* Collects #pragma metadata from a slang source and the files it includes.
+ * The source itself is compiled offline, a missing file only loses metadata. */
+static void video_shader_scan_source(struct video_shader* shader,
+    unsigned pass, const char* path, unsigned depth)
+{
+    char dir[PATH_MAX_LENGTH];
+    char* line;
+    char* next;
+    char* data;
+
+    if (depth >= VIDEO_SHADER_MAX_INCLUDE_DEPTH)
+        return;
+
+    if (!(data = video_shader_read_file(path)))
+    {
+        if (depth == 0)
+            RARCH_LOG("[Shaders]: No source for \"%s\", skipping #pragma metadata.\n", path);
+        return;
+    }
+
+    video_shader_base_dir(dir, sizeof(dir), path);
+
+    for (line = data; line; line = next)
+    {
+        if ((next = strchr(line, '\n')))
+            *next++ = '\0';
+
+        line = video_shader_trim(line);
+
+        if (!strncmp(line, "#pragma parameter", STRLEN_CONST("#pragma parameter")))
+            video_shader_add_parameter(shader, pass, line);
+        else if (!strncmp(line, "#pragma name", STRLEN_CONST("#pragma name")))
+        {
+            /* An alias from the preset wins over the one in the source. */
+            if (!*shader->pass[pass].alias)
+                strlcpy(shader->pass[pass].alias,
+                    video_shader_trim(line + STRLEN_CONST("#pragma name")),
+                    sizeof(shader->pass[pass].alias));
+        }
+        else if (!strncmp(line, "#pragma format", STRLEN_CONST("#pragma format")))
+            strlcpy(shader->pass[pass].format,
+                video_shader_trim(line + STRLEN_CONST("#pragma format")),
+                sizeof(shader->pass[pass].format));
+        else if (!strncmp(line, "#include", STRLEN_CONST("#include")))
+        {
+            char include_path[PATH_MAX_LENGTH];
+            char* include = video_shader_unquote(
+                video_shader_trim(line + STRLEN_CONST("#include")));
+
+            video_shader_resolve_path(include_path, sizeof(include_path), dir, include);
+            video_shader_scan_source(shader, pass, include_path, depth + 1);
+        }
+    }
+
+    free(data);
+}
+
+bool video_shader_load_preset_into_shader(const char* path,
+    struct video_shader* shader)
+{
+    unsigned i;
+    const char* value;
+    bool ret = false;
+    struct video_shader_conf* conf =
+        (struct video_shader_conf*)calloc(1, sizeof(*conf));
+
+    if (!conf)
+        return false;
+
+    memset(shader, 0, sizeof(*shader));
+    shader->feedback_pass = -1;
+    shader->modern = true;
+    strlcpy(shader->path, path, sizeof(shader->path));
+    strlcpy(shader->loaded_preset_path, path, sizeof(shader->loaded_preset_path));
+
+    if (!video_shader_conf_parse(conf, path))
+        goto end;
+
+    if (!(value = video_shader_conf_get(conf, "shaders")))
+    {
+        RARCH_LOG("[Shaders]: Cannot find \"shaders\" in \"%s\".\n", path);
+        goto end;
+    }
+
+    shader->passes = (unsigned)strtoul(value, NULL, 0);
+    if (shader->passes == 0 || shader->passes > GFX_MAX_SHADERS)
+    {
+        RARCH_LOG("[Shaders]: Invalid number of passes (%u) in \"%s\".\n",
+            shader->passes, path);
+        goto end;
+    }
+
+    for (i = 0; i < shader->passes; i++)
+        if (!video_shader_parse_pass(conf, i, &shader->pass[i]))
+            goto end;
+
+    if (!video_shader_parse_textures(conf, shader))
+        goto end;
+
+    for (i = 0; i < shader->passes; i++)
+        video_shader_scan_source(shader, i, shader->pass[i].source.path, 0);
+
+    /* Preset values override the defaults declared in the sources. */
+    for (i = 0; i < shader->num_parameters; i++)
+        if ((value = video_shader_conf_get(conf, shader->parameters[i].id)))
+            shader->parameters[i].current = (float)atof(value);
+
+    RARCH_LOG("[Shaders]: Loaded preset \"%s\": %u pass(es), %u texture(s), %u parameter(s).\n",
+        path, shader->passes, shader->luts, shader->num_parameters);
+    ret = true;
+
+end:
+    video_shader_conf_free(conf);
+    return ret;
+}
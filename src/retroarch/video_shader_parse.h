@@ -0,0 +1,47 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_SHADER_PARSE_H
+#define __VIDEO_SHADER_PARSE_H
+
+#include <stdbool.h>
+
+#include "video_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * video_shader_load_preset_into_shader:
+     * @path                : path to a .slangp preset
+     * @shader              : shader structure to fill in
+     *
+     * Parses a .slangp preset, following #reference directives.
+     * Pass and LUT paths are resolved relative to the preset that named them.
+     * Parameters, names and render target formats are then collected from the
+     * #pragma lines of each pass source and overridden by preset values.
+     *
+     * Returns: true if the preset describes at least one pass.
+     **/
+    bool video_shader_load_preset_into_shader(const char* path,
+        struct video_shader* shader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -358,6 +358,9 @@ static unsigned vulkan_num_miplevels(unsigned width, unsigned height)
     return levels;
 }
 
+/* Textures are only created on the video thread. */
+static uint64_t vulkan_texture_next_id;
+
 struct vk_texture vulkan_create_texture(vk_t* vk,
     struct vk_texture* old,
     unsigned width, unsigned height,
@@ -381,6 +384,7 @@ struct vk_texture vulkan_create_texture(vk_t* vk,
     VkCommandBufferBeginInfo begin_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
 
     memset(&tex, 0, sizeof(tex));
+    tex.id = ++vulkan_texture_next_id;
 
     info.imageType = VK_IMAGE_TYPE_2D;
     info.format = format;
@@ -828,6 +832,7 @@ void vulkan_destroy_texture(
     tex->default_smooth = false;
     tex->need_manual_cache_management = false;
     tex->mipmap = false;
+    tex->id = 0;
     tex->memory_type = 0;
     tex->width = 0;
     tex->height = 0;
@@ -963,28 +968,37 @@ void vulkan_draw_triangles(vk_t* vk, const struct vk_draw_triangles* call)
     /* Upload descriptors */
     {
         VkDescriptorSet set;
-        /* Upload UBO */
-        struct vk_buffer_range range;
         float* mvp_data_ptr = NULL;
 
-        if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->ubo,
-            call->uniform_size, &range))
-            return;
+        set = vulkan_descriptor_cache_get(
+            vk->context->device,
+            &vk->chain->descriptor_cache,
+            call->uniform, call->uniform_size,
+            call->texture, call->sampler);
 
-        memcpy(range.data, call->uniform, call->uniform_size);
+        if (set == VK_NULL_HANDLE)
+        {
+            /* Upload UBO */
+            struct vk_buffer_range range;
 
-        set = vulkan_descriptor_manager_alloc(
-            vk->context->device,
-            &vk->chain->descriptor_manager);
+            if (!VULKAN_RING_ALLOC_UBO(vk, call->uniform_size, &range))
+                return;
 
-        vulkan_write_quad_descriptors(
-            vk->context->device,
-            set,
-            range.buffer,
-            range.offset,
-            call->uniform_size,
-            call->texture,
-            call->sampler);
+            memcpy(range.data, call->uniform, call->uniform_size);
+
+            set = vulkan_descriptor_manager_alloc(
+                vk->context->device,
+                &vk->chain->descriptor_manager);
+
+            vulkan_write_quad_descriptors(
+                vk->context->device,
+                set,
+                range.buffer,
+                range.offset,
+                call->uniform_size,
+                call->texture,
+                call->sampler);
+        }
 
         vkCmdBindDescriptorSets(vk->cmd,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -1028,39 +1042,42 @@ void vulkan_draw_quad(vk_t* vk, const struct vk_draw_quad* quad)
     /* Upload descriptors */
     {
         VkDescriptorSet set;
-        struct vk_buffer_range range;
-
-        if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->ubo,
-            sizeof(*quad->mvp), &range))
-            return;
 
         if (
-            string_is_equal_fast(quad->mvp,
+            !string_is_equal_fast(quad->mvp,
                 &vk->tracker.mvp, sizeof(*quad->mvp))
             || quad->texture->view != vk->tracker.view
             || quad->sampler != vk->tracker.sampler)
         {
-            /* Upload UBO */
-            struct vk_buffer_range range;
-
-            if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->ubo,
-                sizeof(*quad->mvp), &range))
-                return;
-
-            memcpy(range.data, quad->mvp, sizeof(*quad->mvp));
-
-            set = vulkan_descriptor_manager_alloc(
+            set = vulkan_descriptor_cache_get(
                 vk->context->device,
-                &vk->chain->descriptor_manager);
+                &vk->chain->descriptor_cache,
+                quad->mvp, sizeof(*quad->mvp),
+                quad->texture, quad->sampler);
 
-            vulkan_write_quad_descriptors(
-                vk->context->device,
-                set,
-                range.buffer,
-                range.offset,
-                sizeof(*quad->mvp),
-                quad->texture,
-                quad->sampler);
+            if (set == VK_NULL_HANDLE)
+            {
+                /* Upload UBO */
+                struct vk_buffer_range range;
+
+                if (!VULKAN_RING_ALLOC_UBO(vk, sizeof(*quad->mvp), &range))
+                    return;
+
+                memcpy(range.data, quad->mvp, sizeof(*quad->mvp));
+
+                set = vulkan_descriptor_manager_alloc(
+                    vk->context->device,
+                    &vk->chain->descriptor_manager);
+
+                vulkan_write_quad_descriptors(
+                    vk->context->device,
+                    set,
+                    range.buffer,
+                    range.offset,
+                    sizeof(*quad->mvp),
+                    quad->texture,
+                    quad->sampler);
+            }
 
             vkCmdBindDescriptorSets(vk->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                 vk->pipelines.layout, 0,
@@ -1075,8 +1092,7 @@ void vulkan_draw_quad(vk_t* vk, const struct vk_draw_quad* quad)
     /* Upload VBO */
     {
         struct vk_buffer_range range;
-        if (!vulkan_buffer_chain_alloc(vk->context, &vk->chain->vbo,
-            6 * sizeof(struct vk_vertex), &range))
+        if (!VULKAN_RING_ALLOC_VBO(vk, 6 * sizeof(struct vk_vertex), &range))
             return;
 
         {
@@ -1254,111 +1270,152 @@ void vulkan_destroy_descriptor_manager(
     memset(manager, 0, sizeof(*manager));
 }
 
-static void vulkan_buffer_chain_step(struct vk_buffer_chain* chain)
+void vulkan_create_descriptor_cache(
+    const struct vulkan_context* context,
+    struct vk_descriptor_cache* cache,
+    const VkDescriptorPoolSize* sizes,
+    unsigned num_sizes,
+    VkDescriptorSetLayout set_layout)
 {
-    chain->current = chain->current->next;
-    chain->offset = 0;
-}
+    VkDeviceSize alignment =
+        context->gpu_properties.limits.minUniformBufferOffsetAlignment;
 
-static bool vulkan_buffer_chain_suballoc(struct vk_buffer_chain* chain,
-    size_t size, struct vk_buffer_range* range)
-{
-    VkDeviceSize next_offset = chain->offset + size;
-    if (next_offset <= chain->current->buffer.size)
-    {
-        range->data = (uint8_t*)chain->current->buffer.mapped + chain->offset;
-        range->buffer = chain->current->buffer.buffer;
-        range->offset = chain->offset;
-        chain->offset = (next_offset + chain->alignment - 1)
-            & ~(chain->alignment - 1);
+    memset(cache, 0, sizeof(*cache));
 
-        return true;
-    }
+    if (alignment < 1)
+        alignment = 1;
 
-    return false;
+    cache->ubo_stride = (VULKAN_DESCRIPTOR_CACHE_UBO_SIZE + alignment - 1)
+        & ~(alignment - 1);
+    cache->ubo = vulkan_create_buffer(context,
+        VULKAN_DESCRIPTOR_CACHE_SIZE * cache->ubo_stride,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    cache->manager = vulkan_create_descriptor_manager(
+        context->device, sizes, num_sizes, set_layout);
 }
 
-static struct vk_buffer_node* vulkan_buffer_chain_alloc_node(
-    const struct vulkan_context* context,
-    size_t size, VkBufferUsageFlags usage)
+void vulkan_destroy_descriptor_cache(
+    VkDevice device,
+    struct vk_descriptor_cache* cache)
 {
-    struct vk_buffer_node* node = (struct vk_buffer_node*)
-        malloc(sizeof(*node));
-    if (!node)
-        return NULL;
+    if (cache->hits + cache->misses)
+        RARCH_LOG("[Vulkan]: Descriptor cache: %llu hits, %llu misses (%.1f%% hit rate).\n",
+            (unsigned long long)cache->hits,
+            (unsigned long long)cache->misses,
+            100.0 * cache->hits / (cache->hits + cache->misses));
+
+    if (cache->ubo.buffer != VK_NULL_HANDLE)
+        vulkan_destroy_buffer(device, &cache->ubo);
+    vulkan_destroy_descriptor_manager(device, &cache->manager);
 
-    node->buffer = vulkan_create_buffer(
-        context, size, usage);
-    node->next = NULL;
-    return node;
+    memset(cache, 0, sizeof(*cache));
 }
 
-struct vk_buffer_chain vulkan_buffer_chain_init(
-    VkDeviceSize block_size,
-    VkDeviceSize alignment,
-    VkBufferUsageFlags usage)
+static uint64_t vulkan_descriptor_cache_hash(
+    const struct vk_descriptor_cache_key* key)
 {
-    struct vk_buffer_chain chain;
+    size_t i;
+    const uint8_t* data = (const uint8_t*)key;
+    uint64_t hash = 0xcbf29ce484222325ull;
 
-    chain.block_size = block_size;
-    chain.alignment = alignment;
-    chain.offset = 0;
-    chain.usage = usage;
-    chain.head = NULL;
-    chain.current = NULL;
+    for (i = 0; i < sizeof(*key); i++)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
 
-    return chain;
+    return hash;
 }
 
-bool vulkan_buffer_chain_alloc(const struct vulkan_context* context,
-    struct vk_buffer_chain* chain,
-    size_t size, struct vk_buffer_range* range)
+/* Returns VK_NULL_HANDLE if the draw can't be cached,
+ * in which case the caller writes a fresh set itself. */
+VkDescriptorSet vulkan_descriptor_cache_get(
+    VkDevice device,
+    struct vk_descriptor_cache* cache,
+    const void* uniform, size_t uniform_size,
+    const struct vk_texture* texture,
+    VkSampler sampler)
 {
-    if (!chain->head)
+    unsigned i;
+    unsigned index;
+    struct vk_descriptor_cache_key key;
+    struct vk_descriptor_cache_entry* victim = NULL;
+
+    /* Textures not made by vulkan_create_texture have no id
+     * telling them apart from whatever reuses their view. */
+    if (cache->ubo.buffer == VK_NULL_HANDLE
+        || uniform_size > VULKAN_DESCRIPTOR_CACHE_UBO_SIZE
+        || (texture && !texture->id))
     {
-        chain->head = vulkan_buffer_chain_alloc_node(context,
-            chain->block_size, chain->usage);
-        if (!chain->head)
-            return false;
+        cache->misses++;
+        return VK_NULL_HANDLE;
+    }
 
-        chain->current = chain->head;
-        chain->offset = 0;
+    /* Zero the whole key so padding hashes and compares consistently. */
+    memset(&key, 0, sizeof(key));
+    memcpy(key.uniform, uniform, uniform_size);
+    key.uniform_size = uniform_size;
+    if (texture)
+    {
+        key.texture_id = texture->id;
+        key.view = texture->view;
+        key.layout = texture->layout;
+        key.sampler = sampler;
     }
 
-    if (vulkan_buffer_chain_suballoc(chain, size, range))
-        return true;
+    index = (unsigned)vulkan_descriptor_cache_hash(&key);
 
-    /* We've exhausted the current chain, traverse list until we
-     * can find a block we can use. Usually, we just step once. */
-    while (chain->current->next)
+    for (i = 0; i < VULKAN_DESCRIPTOR_CACHE_PROBES; i++)
     {
-        vulkan_buffer_chain_step(chain);
-        if (vulkan_buffer_chain_suballoc(chain, size, range))
-            return true;
+        struct vk_descriptor_cache_entry* entry = &cache->entries[
+            (index + i) & (VULKAN_DESCRIPTOR_CACHE_SIZE - 1)];
+
+        /* Entries are replaced in place and never emptied,
+         * so an empty slot ends the probe sequence. */
+        if (!entry->valid)
+        {
+            victim = entry;
+            break;
+        }
+
+        if (string_is_equal_fast(&entry->key, &key, sizeof(key)))
+        {
+            entry->last_used = cache->frame;
+            cache->hits++;
+            return entry->set;
+        }
+
+        /* Sets bound earlier in this frame must not be rewritten. */
+        if (entry->last_used != cache->frame &&
+            (!victim || entry->last_used < victim->last_used))
+            victim = entry;
     }
 
-    /* We have to allocate a new node, might allocate larger
-     * buffer here than block_size in case we have
-     * a very large allocation. */
-    if (size < chain->block_size)
-        size = chain->block_size;
+    cache->misses++;
 
-    chain->current->next = vulkan_buffer_chain_alloc_node(
-        context, size, chain->usage);
-    if (!chain->current->next)
-        return false;
+    if (!victim)
+        return VK_NULL_HANDLE;
 
-    vulkan_buffer_chain_step(chain);
-    /* This cannot possibly fail. */
-    retro_assert(vulkan_buffer_chain_suballoc(chain, size, range));
-    return true;
+    if (victim->set == VK_NULL_HANDLE)
+        victim->set = vulkan_descriptor_manager_alloc(device,
+            &cache->manager);
+
+    {
+        VkDeviceSize offset = (victim - cache->entries) * cache->ubo_stride;
+
+        memcpy((uint8_t*)cache->ubo.mapped + offset, uniform, uniform_size);
+
+        vulkan_write_quad_descriptors(device, victim->set,
+            cache->ubo.buffer, offset, uniform_size,
+            texture, sampler);
+    }
+
+    victim->key = key;
+    victim->last_used = cache->frame;
+    victim->valid = true;
+    return victim->set;
 }
 
-void vulkan_buffer_chain_free(
-    VkDevice device,
-    struct vk_buffer_chain* chain)
+static void vulkan_buffer_ring_release(VkDevice device,
+    struct vk_buffer_node* node)
 {
-    struct vk_buffer_node* node = chain->head;
     while (node)
     {
         struct vk_buffer_node* next = node->next;
@@ -1367,7 +1424,151 @@ void vulkan_buffer_chain_free(
         free(node);
         node = next;
     }
-    memset(chain, 0, sizeof(*chain));
+}
+
+static VkDeviceSize vulkan_buffer_ring_size_for(VkDeviceSize size)
+{
+    VkDeviceSize ring_size = VULKAN_BUFFER_BLOCK_SIZE;
+    while (ring_size < size)
+        ring_size <<= 1;
+    return ring_size;
+}
+
+/* Replaces the ring buffer with a larger one. The old buffer can
+ * still be referenced by every frame in flight, including the one
+ * being recorded, so it is kept around until this frame index
+ * comes back around. Frames are retired in submission order,
+ * so by then every older user has completed too. */
+static bool vulkan_buffer_ring_grow(const struct vulkan_context* context,
+    struct vk_buffer_ring* ring, VkDeviceSize required)
+{
+    unsigned i;
+    VkDeviceSize size = vulkan_buffer_ring_size_for(
+        MAX(2 * ring->buffer.size, required));
+
+    if (ring->buffer.buffer != VK_NULL_HANDLE)
+    {
+        struct vk_buffer_node* node = (struct vk_buffer_node*)
+            malloc(sizeof(*node));
+        if (!node)
+            return false;
+
+        node->buffer = ring->buffer;
+        node->next = ring->retired[ring->frame_index];
+        ring->retired[ring->frame_index] = node;
+
+        RARCH_LOG("[Vulkan]: Growing buffer ring from %u KiB to %u KiB (frame needs %u KiB).\n",
+            (unsigned)(ring->buffer.size >> 10), (unsigned)(size >> 10),
+            (unsigned)(required >> 10));
+    }
+
+    ring->buffer = vulkan_create_buffer(context, size, ring->usage);
+    if (!ring->buffer.mapped)
+        return false;
+
+    /* Nothing in flight references the new buffer yet. */
+    for (i = 0; i < VULKAN_MAX_SWAPCHAIN_IMAGES; i++)
+        ring->in_flight[i] = false;
+
+    ring->head = 0;
+    ring->frame_begin[ring->frame_index] = 0;
+    ring->in_flight[ring->frame_index] = true;
+    return true;
+}
+
+void vulkan_buffer_ring_init(
+    struct vk_buffer_ring* ring,
+    VkBufferUsageFlags usage)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->usage = usage;
+}
+
+void vulkan_buffer_ring_begin_frame(
+    VkDevice device,
+    struct vk_buffer_ring* ring,
+    unsigned frame_index)
+{
+    /* The fence for this frame index has been waited on,
+     * so its old range and retired buffers are free again. */
+    vulkan_buffer_ring_release(device, ring->retired[frame_index]);
+    ring->retired[frame_index] = NULL;
+
+    ring->frame_index = frame_index;
+    ring->frame_begin[frame_index] = ring->head;
+    ring->in_flight[frame_index] = true;
+    ring->frame_used = 0;
+}
+
+bool vulkan_buffer_ring_alloc(const struct vulkan_context* context,
+    struct vk_buffer_ring* ring,
+    size_t size, VkDeviceSize alignment,
+    struct vk_buffer_range* range)
+{
+    unsigned i;
+    VkDeviceSize pos;
+    VkDeviceSize phys;
+    VkDeviceSize tail = ring->head;
+
+    if (alignment < VULKAN_BUFFER_RING_ALIGNMENT)
+        alignment = VULKAN_BUFFER_RING_ALIGNMENT;
+
+    for (i = 0; i < VULKAN_MAX_SWAPCHAIN_IMAGES; i++)
+        if (ring->in_flight[i] && ring->frame_begin[i] < tail)
+            tail = ring->frame_begin[i];
+
+    pos = (ring->head + alignment - 1) & ~(alignment - 1);
+    phys = ring->buffer.size ? pos & (ring->buffer.size - 1) : 0;
+
+    /* Allocations never straddle the end of the ring. */
+    if (phys + size > ring->buffer.size)
+    {
+        pos += ring->buffer.size - phys;
+        phys = 0;
+    }
+
+    if (ring->buffer.buffer == VK_NULL_HANDLE
+        || pos + size - tail > ring->buffer.size)
+    {
+        if (!vulkan_buffer_ring_grow(context, ring,
+            2 * (ring->frame_used + size + alignment)))
+            return false;
+
+        pos = 0;
+        phys = 0;
+    }
+
+    range->data = (uint8_t*)ring->buffer.mapped + phys;
+    range->buffer = ring->buffer.buffer;
+    range->offset = phys;
+
+    ring->frame_used += pos + size - ring->head;
+    ring->head = pos + size;
+
+    if (ring->frame_used > ring->peak)
+        ring->peak = ring->frame_used;
+
+    return true;
+}
+
+void vulkan_buffer_ring_free(
+    VkDevice device,
+    struct vk_buffer_ring* ring)
+{
+    unsigned i;
+
+    if (ring->peak)
+        RARCH_LOG("[Vulkan]: Buffer ring peak usage per frame: %u KiB of %u KiB.\n",
+            (unsigned)((ring->peak + 1023) >> 10),
+            (unsigned)(ring->buffer.size >> 10));
+
+    for (i = 0; i < VULKAN_MAX_SWAPCHAIN_IMAGES; i++)
+        vulkan_buffer_ring_release(device, ring->retired[i]);
+
+    if (ring->buffer.buffer != VK_NULL_HANDLE)
+        vulkan_destroy_buffer(device, &ring->buffer);
+
+    memset(ring, 0, sizeof(*ring));
 }
 
 static bool vulkan_find_extensions(const char** exts, unsigned num_exts,
@@ -17,7 +17,12 @@
 
 #define VULKAN_DESCRIPTOR_MANAGER_BLOCK_SETS    16
 #define VULKAN_MAX_DESCRIPTOR_POOL_SIZES        16
+#define VULKAN_DESCRIPTOR_CACHE_SIZE            64
+#define VULKAN_DESCRIPTOR_CACHE_PROBES          8
+/* Largest UBO the descriptor cache keeps a copy of, enough for an MVP. */
+#define VULKAN_DESCRIPTOR_CACHE_UBO_SIZE        64
 #define VULKAN_BUFFER_BLOCK_SIZE                (64 * 1024)
+#define VULKAN_BUFFER_RING_ALIGNMENT            16
 
 #define VULKAN_MAX_SWAPCHAIN_IMAGES             8
 
@@ -230,6 +235,9 @@ struct vk_texture
     bool default_smooth;
     bool need_manual_cache_management;
     bool mipmap;
+    /* Unique per vulkan_create_texture call, 0 once destroyed. Handle
+     * values can be reused, so caches key on this instead. */
+    uint64_t id;
 };
 
 struct vk_buffer
@@ -246,14 +254,24 @@ struct vk_buffer_node
     struct vk_buffer_node* next;
 };
 
-struct vk_buffer_chain
+/* Persistently mapped host-visible ring shared by all streamed
+ * VBO and UBO data. Positions are virtual and only ever increase,
+ * the physical offset is the position modulo the (power of two) size.
+ * Each frame index owns the range it allocated until its fence
+ * has signalled, which is when the next frame with that index begins. */
+struct vk_buffer_ring
 {
-    VkDeviceSize block_size; /* uint64_t alignment */
-    VkDeviceSize alignment;  /* uint64_t alignment */
-    VkDeviceSize offset;     /* uint64_t alignment */
-    struct vk_buffer_node* head;
-    struct vk_buffer_node* current;
+    struct vk_buffer buffer;  /* uint64_t alignment */
+    VkDeviceSize head;        /* uint64_t alignment */
+    VkDeviceSize frame_begin[VULKAN_MAX_SWAPCHAIN_IMAGES];
+    VkDeviceSize frame_used;
+    VkDeviceSize peak;
+    /* Buffers replaced by growth, freed once the frame
+     * which outgrew them has completed. */
+    struct vk_buffer_node* retired[VULKAN_MAX_SWAPCHAIN_IMAGES];
     VkBufferUsageFlags usage; /* uint32_t alignment */
+    unsigned frame_index;
+    bool in_flight[VULKAN_MAX_SWAPCHAIN_IMAGES];
 };
 
 struct vk_buffer_range
@@ -280,13 +298,45 @@ struct vk_descriptor_manager
     unsigned num_sizes;
 };
 
+struct vk_descriptor_cache_key
+{
+    uint8_t uniform[VULKAN_DESCRIPTOR_CACHE_UBO_SIZE];
+    VkDeviceSize uniform_size; /* uint64_t alignment */
+    uint64_t texture_id;       /* uint64_t alignment */
+    VkImageView view;          /* ptr alignment */
+    VkSampler sampler;         /* ptr alignment */
+    VkImageLayout layout;      /* enum alignment */
+};
+
+struct vk_descriptor_cache_entry
+{
+    struct vk_descriptor_cache_key key;
+    uint64_t last_used;        /* uint64_t alignment */
+    VkDescriptorSet set;       /* ptr alignment */
+    bool valid;
+};
+
+/* Already written quad descriptor sets, reused by draws binding the
+ * same UBO contents, view and sampler. Each entry owns a slot in ubo,
+ * so a hit needs neither a UBO upload nor vkUpdateDescriptorSets.
+ * Sets come from a manager which is never restarted. */
+struct vk_descriptor_cache
+{
+    struct vk_descriptor_cache_entry entries[VULKAN_DESCRIPTOR_CACHE_SIZE];
+    struct vk_buffer ubo;                 /* uint64_t alignment */
+    struct vk_descriptor_manager manager;
+    VkDeviceSize ubo_stride;
+    uint64_t frame;
+    uint64_t hits;
+    uint64_t misses;
+};
+
 struct vk_per_frame
 {
     struct vk_texture texture;          /* uint64_t alignment */
     struct vk_texture texture_optimal;
-    struct vk_buffer_chain vbo;         /* uint64_t alignment */
-    struct vk_buffer_chain ubo;
     struct vk_descriptor_manager descriptor_manager;
+    struct vk_descriptor_cache descriptor_cache;
 
     VkCommandPool cmd_pool; /* ptr alignment */
     VkCommandBuffer cmd;    /* ptr alignment */
@@ -342,6 +392,8 @@ typedef struct vk
     struct video_viewport vp;
     struct vk_per_frame swapchain[VULKAN_MAX_SWAPCHAIN_IMAGES];
     struct vk_image backbuffers[VULKAN_MAX_SWAPCHAIN_IMAGES];
+    /* Streamed VBO and UBO memory for every frame in flight. */
+    struct vk_buffer_ring ring;
     struct vk_texture default_texture;
 
     /* Currently active command buffer. */
@@ -449,6 +501,24 @@ typedef struct vk
         bool use_scissor;
     } tracker;
 
+    struct
+    {
+        VkQueryPool pool;    /* ptr alignment */
+        uint64_t total_ns[2];
+        unsigned frames[2];
+        float period;
+        bool pending[VULKAN_MAX_SWAPCHAIN_IMAGES];
+        bool direct[VULKAN_MAX_SWAPCHAIN_IMAGES];
+    } timing;
+
+    struct
+    {
+        VkFormat src_format;
+        VkFormat dst_format;
+        bool src_supported;
+        bool dst_supported;
+    } blit;
+
     bool vsync;
     bool keep_aspect;
     bool fullscreen;
@@ -457,11 +527,14 @@ typedef struct vk
 
 } vk_t;
 
-#define VK_BUFFER_CHAIN_DISCARD(chain) \
-{ \
-   chain->current = chain->head; \
-   chain->offset  = 0; \
-}
+#define VULKAN_RING_ALLOC_VBO(vk, size, range) \
+   vulkan_buffer_ring_alloc((vk)->context, &(vk)->ring, size, \
+         VULKAN_BUFFER_RING_ALIGNMENT, range)
+
+#define VULKAN_RING_ALLOC_UBO(vk, size, range) \
+   vulkan_buffer_ring_alloc((vk)->context, &(vk)->ring, size, \
+         (vk)->context->gpu_properties.limits.minUniformBufferOffsetAlignment, \
+         range)
 
 #define VULKAN_SYNC_TEXTURE_TO_GPU(device, tex_memory) \
 { \
@@ -515,6 +588,11 @@ typedef struct vk
    manager->count = 0; \
 }
 
+#define VK_DESCRIPTOR_CACHE_BEGIN_FRAME(cache) \
+{ \
+   cache->frame++; \
+}
+
 #define VK_MAP_PERSISTENT_TEXTURE(device, texture) \
 { \
    vkMapMemory(device, texture->memory, texture->offset, texture->size, 0, &texture->mapped); \
@@ -664,7 +742,7 @@ typedef struct vk
 void vulkan_draw_quad(vk_t* vk, const struct vk_draw_quad* quad);
 
 /* The VBO needs to be written to before calling this.
- * Use vulkan_buffer_chain_alloc.
+ * Use VULKAN_RING_ALLOC_VBO.
  */
 void vulkan_draw_triangles(vk_t* vk, const struct vk_draw_triangles* call);
 
@@ -692,18 +770,23 @@ static unsigned vulkan_format_to_bpp(VkFormat format)
 extern "C" {
 #endif
 
-    struct vk_buffer_chain vulkan_buffer_chain_init(
-        VkDeviceSize block_size,
-        VkDeviceSize alignment,
+    void vulkan_buffer_ring_init(
+        struct vk_buffer_ring* ring,
         VkBufferUsageFlags usage);
 
-    bool vulkan_buffer_chain_alloc(const struct vulkan_context* context,
-        struct vk_buffer_chain* chain, size_t size,
+    void vulkan_buffer_ring_begin_frame(
+        VkDevice device,
+        struct vk_buffer_ring* ring,
+        unsigned frame_index);
+
+    bool vulkan_buffer_ring_alloc(const struct vulkan_context* context,
+        struct vk_buffer_ring* ring, size_t size,
+        VkDeviceSize alignment,
         struct vk_buffer_range* range);
 
-    void vulkan_buffer_chain_free(
+    void vulkan_buffer_ring_free(
         VkDevice device,
-        struct vk_buffer_chain* chain);
+        struct vk_buffer_ring* ring);
 
     uint32_t vulkan_find_memory_type(
         const VkPhysicalDeviceMemoryProperties* mem_props,
@@ -748,6 +831,24 @@ extern "C" {
         VkDevice device,
         struct vk_descriptor_manager* manager);
 
+    void vulkan_create_descriptor_cache(
+        const struct vulkan_context* context,
+        struct vk_descriptor_cache* cache,
+        const VkDescriptorPoolSize* sizes,
+        unsigned num_sizes,
+        VkDescriptorSetLayout set_layout);
+
+    void vulkan_destroy_descriptor_cache(
+        VkDevice device,
+        struct vk_descriptor_cache* cache);
+
+    VkDescriptorSet vulkan_descriptor_cache_get(
+        VkDevice device,
+        struct vk_descriptor_cache* cache,
+        const void* uniform, size_t uniform_size,
+        const struct vk_texture* texture,
+        VkSampler sampler);
+
     bool vulkan_context_init(gfx_ctx_vulkan_data_t* vk,
         enum vulkan_wsi_type type);
 
@@ -0,0 +1,273 @@
+#include "png_writer.h"
+
+/* The bundled headers are configured for the Windows libraries the plugin
+ * links, the tools build against the system zlib. */
+#ifdef PNG_WRITER_SYSTEM_ZLIB
+#include <zlib.h>
+#else
+#include "inc/zlib.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../parallel_for.h"
+
+/* Uncompressed bytes per band. Each band is a separate deflate stream, the
+ * same split pigz makes, primed with the 32 KiB before it so the ratio
+ * barely suffers from the cut. */
+#define PNG_WRITER_BAND_BYTES (256 * 1024)
+#define PNG_WRITER_WINDOW (32 * 1024)
+
+struct png_band
+{
+	int first_row;
+	int end_row;
+	std::vector<uint8_t> data; /* Raw deflate, a zlib header in front of the first. */
+	uLong adler;
+	uLong length;
+	bool ok;
+};
+
+static void png_bgr_to_rgb(uint8_t* out, const uint8_t* in, int width)
+{
+	for (int x = 0; x < width; x++, in += 3, out += 3) {
+		out[0] = in[2];
+		out[1] = in[1];
+		out[2] = in[0];
+	}
+}
+
+static uint8_t png_paeth(int a, int b, int c)
+{
+	int pa = abs(b - c);
+	int pb = abs(a - c);
+	int pc = abs(a + b - 2 * c);
+
+	/* Selects rather than branches, so the loops vectorize. */
+	return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+/* Writes the filter type byte and the filtered row to @out. */
+static void png_filter_row(uint8_t* out, const uint8_t* cur, const uint8_t* prev, int row_bytes, int filter)
+{
+	const int bpp = 3;
+	int i;
+
+	*out++ = (uint8_t)filter;
+
+	switch (filter) {
+	case PNG_WRITER_FILTER_SUB:
+		for (i = 0; i < bpp; i++) out[i] = cur[i];
+		for (; i < row_bytes; i++) out[i] = cur[i] - cur[i - bpp];
+		break;
+	case PNG_WRITER_FILTER_UP:
+		for (i = 0; i < row_bytes; i++) out[i] = cur[i] - prev[i];
+		break;
+	case PNG_WRITER_FILTER_AVERAGE:
+		for (i = 0; i < bpp; i++) out[i] = cur[i] - (prev[i] >> 1);
+		for (; i < row_bytes; i++) out[i] = cur[i] - ((cur[i - bpp] + prev[i]) >> 1);
+		break;
+	case PNG_WRITER_FILTER_PAETH:
+		for (i = 0; i < bpp; i++) out[i] = cur[i] - prev[i];
+		for (; i < row_bytes; i++) out[i] = cur[i] - png_paeth(cur[i - bpp], prev[i], prev[i - bpp]);
+		break;
+	default:
+		memcpy(out, cur, row_bytes);
+		break;
+	}
+}
+
+/* The heuristic libpng uses: the filter whose output bytes, taken as
+ * signed, sum to the least. @best and @candidate hold a filtered row. */
+static void png_filter_row_adaptive(uint8_t* out, uint8_t* best, uint8_t* candidate,
+	const uint8_t* cur, const uint8_t* prev, int row_bytes)
+{
+	unsigned best_sum = ~0u;
+
+	for (int filter = PNG_WRITER_FILTER_NONE; filter <= PNG_WRITER_FILTER_PAETH; filter++) {
+		unsigned sum = 0;
+
+		png_filter_row(candidate, cur, prev, row_bytes, filter);
+		for (int i = 1; i <= row_bytes; i++)
+			sum += abs((int8_t)candidate[i]);
+
+		if (sum < best_sum) {
+			best_sum = sum;
+			std::swap(best, candidate);
+		}
+	}
+
+	memcpy(out, best, row_bytes + 1);
+}
+
+static bool png_deflate_band(png_band& band, const uint8_t* dict, uInt dict_len, uint8_t* in, uLong in_len, int level, bool last)
+{
+	z_stream strm;
+	size_t start = band.data.size();
+	int ret;
+
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+
+	if (dict_len && deflateSetDictionary(&strm, dict, dict_len) != Z_OK) {
+		deflateEnd(&strm);
+		return false;
+	}
+
+	/* Bands other than the last end on a byte boundary with a sync
+	 * flush, so the next one can simply follow. */
+	band.data.resize(start + deflateBound(&strm, in_len) + 64);
+	strm.next_in = in;
+	strm.avail_in = (uInt)in_len;
+	strm.next_out = band.data.data() + start;
+	strm.avail_out = (uInt)(band.data.size() - start);
+
+	ret = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+	band.data.resize(start + strm.total_out);
+	deflateEnd(&strm);
+
+	return last ? ret == Z_STREAM_END : (ret == Z_OK && strm.avail_in == 0 && strm.avail_out != 0);
+}
+
+static void png_encode_band(png_band& band, int width, int height, const uint8_t* rows, int stride, int level, int filter)
+{
+	const int row_bytes = width * 3;
+	const size_t filtered_bytes = (size_t)row_bytes + 1;
+	/* Rows before the band, filtered again to prime the dictionary. */
+	int dict_rows = std::min(band.first_row, (int)((PNG_WRITER_WINDOW + filtered_bytes - 1) / filtered_bytes));
+	int first = band.first_row - dict_rows;
+	std::vector<uint8_t> raw((size_t)(band.end_row - first) * filtered_bytes);
+	std::vector<uint8_t> prev(row_bytes), cur(row_bytes), scratch(2 * filtered_bytes);
+	size_t dict_len = (size_t)dict_rows * filtered_bytes;
+	size_t dict_used = std::min<size_t>(dict_len, PNG_WRITER_WINDOW);
+
+	if (first > 0)
+		png_bgr_to_rgb(prev.data(), rows + (ptrdiff_t)(first - 1) * stride, width);
+
+	for (int y = first; y < band.end_row; y++) {
+		uint8_t* out = raw.data() + (size_t)(y - first) * filtered_bytes;
+
+		png_bgr_to_rgb(cur.data(), rows + (ptrdiff_t)y * stride, width);
+		if (filter == PNG_WRITER_FILTER_ADAPTIVE)
+			png_filter_row_adaptive(out, scratch.data(), scratch.data() + filtered_bytes,
+				cur.data(), prev.data(), row_bytes);
+		else
+			png_filter_row(out, cur.data(), prev.data(), row_bytes, filter);
+		std::swap(prev, cur);
+	}
+
+	band.length = (uLong)(raw.size() - dict_len);
+	band.adler = adler32(adler32(0L, Z_NULL, 0), raw.data() + dict_len, (uInt)band.length);
+
+	if (band.first_row == 0) {
+		/* 32 KiB window, FLEVEL as zlib sets it, FCHECK last. */
+		int flevel = level < 0 || level == 6 ? 2 : level < 2 ? 0 : level < 6 ? 1 : 3;
+		uint8_t cmf = 0x78;
+		uint8_t flg = (uint8_t)(flevel << 6);
+
+		flg += 31 - ((cmf << 8) + flg) % 31;
+		band.data.push_back(cmf);
+		band.data.push_back(flg);
+	}
+
+	band.ok = png_deflate_band(band, raw.data() + dict_len - dict_used, (uInt)dict_used,
+		raw.data() + dict_len, band.length, level, band.end_row == height);
+}
+
+static void png_put_u32(uint8_t* out, uint32_t value)
+{
+	out[0] = (uint8_t)(value >> 24);
+	out[1] = (uint8_t)(value >> 16);
+	out[2] = (uint8_t)(value >> 8);
+	out[3] = (uint8_t)value;
+}
+
+static bool png_write_chunk(FILE* fp, const char* type, const uint8_t* data, size_t len)
+{
+	uint8_t header[8], crc[4];
+	uLong sum;
+
+	png_put_u32(header, (uint32_t)len);
+	memcpy(header + 4, type, 4);
+
+	sum = crc32(crc32(0L, Z_NULL, 0), header + 4, 4);
+	if (len)
+		sum = crc32(sum, data, (uInt)len);
+	png_put_u32(crc, (uint32_t)sum);
+
+	return fwrite(header, 1, 8, fp) == 8
+		&& (!len || fwrite(data, 1, len, fp) == len)
+		&& fwrite(crc, 1, 4, fp) == 4;
+}
+
+bool png_writer_save_bgr24(const char* file_name, int width, int height,
+	const uint8_t* rows, int stride, int level, int filter)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	const size_t filtered_bytes = (size_t)width * 3 + 1;
+	int rows_per_band, i;
+	uLong adler = adler32(0L, Z_NULL, 0);
+	uint8_t ihdr[13];
+	bool ok;
+
+	if (width <= 0 || height <= 0)
+		return false;
+	if (level > Z_BEST_COMPRESSION)
+		level = Z_BEST_COMPRESSION;
+	if (level < 0)
+		level = Z_DEFAULT_COMPRESSION;
+	if (filter < PNG_WRITER_FILTER_NONE || filter > PNG_WRITER_FILTER_ADAPTIVE)
+		filter = PNG_WRITER_FILTER_ADAPTIVE;
+
+	rows_per_band = std::max(1, (int)(PNG_WRITER_BAND_BYTES / filtered_bytes));
+	std::vector<png_band> bands((height + rows_per_band - 1) / rows_per_band);
+	for (i = 0; i < (int)bands.size(); i++) {
+		bands[i].first_row = i * rows_per_band;
+		bands[i].end_row = std::min(height, (i + 1) * rows_per_band);
+		bands[i].ok = false;
+	}
+
+	parallel_for(unsigned(bands.size()), [&](unsigned index) {
+		png_encode_band(bands[index], width, height, rows, stride, level, filter);
+	});
+
+	for (auto& band : bands) {
+		if (!band.ok)
+			return false;
+		adler = adler32_combine(adler, band.adler, band.length);
+	}
+
+	png_put_u32(ihdr, (uint32_t)width);
+	png_put_u32(ihdr + 4, (uint32_t)height);
+	ihdr[8] = 8;  /* Bit depth */
+	ihdr[9] = 2;  /* RGB */
+	ihdr[10] = 0; /* Deflate */
+	ihdr[11] = 0; /* Adaptive filtering */
+	ihdr[12] = 0; /* No interlace */
+
+	bands.back().data.resize(bands.back().data.size() + 4);
+	png_put_u32(bands.back().data.data() + bands.back().data.size() - 4, (uint32_t)adler);
+
+	FILE* fp = fopen(file_name, "wb");
+	if (!fp) return false;
+
+	ok = fwrite(signature, 1, sizeof(signature), fp) == sizeof(signature)
+		&& png_write_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+
+	/* One IDAT per band, together they hold a single zlib stream. */
+	for (i = 0; ok && i < (int)bands.size(); i++)
+		ok = png_write_chunk(fp, "IDAT", bands[i].data.data(), bands[i].data.size());
+
+	ok = ok && png_write_chunk(fp, "IEND", NULL, 0);
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok)
+		remove(file_name);
+	return ok;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Per row filter, the values of KEY_PNG_FILTER. */
+enum png_writer_filter
+{
+	PNG_WRITER_FILTER_NONE = 0,
+	PNG_WRITER_FILTER_SUB,
+	PNG_WRITER_FILTER_UP,
+	PNG_WRITER_FILTER_AVERAGE,
+	PNG_WRITER_FILTER_PAETH,
+	PNG_WRITER_FILTER_ADAPTIVE /* Whichever of the above fits each row best. */
+};
+
+/* Writes a BGR24 image as an 8-bit RGB PNG. Rows are @stride bytes apart
+ * starting at @rows, a negative stride writes a bottom-up image. Bands of
+ * rows are filtered and deflated on all cores, @level is the zlib one. */
+bool png_writer_save_bgr24(const char* file_name, int width, int height,
+	const uint8_t* rows, int stride, int level, int filter);
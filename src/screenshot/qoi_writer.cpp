@@ -0,0 +1,138 @@
+#include "qoi_writer.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+
+/* Runs longer than this would collide with the RGB and RGBA tags. */
+#define QOI_MAX_RUN 62
+
+/* Encoded bytes gathered before each fwrite. */
+#define QOI_WRITER_BUFFER_BYTES (256 * 1024)
+
+static void qoi_put_u32(uint8_t* out, uint32_t value)
+{
+	out[0] = (uint8_t)(value >> 24);
+	out[1] = (uint8_t)(value >> 16);
+	out[2] = (uint8_t)(value >> 8);
+	out[3] = (uint8_t)value;
+}
+
+/* Encodes one row onto @out, carrying the previous pixel, the index and
+ * the pending run across rows. Pixels are packed 0xAARRGGBB, alpha always
+ * opaque, so the cleared index can never match. Returns the new end. */
+static uint8_t* qoi_encode_row(uint8_t* out, const uint8_t* in, int width,
+	uint32_t* index, uint32_t& prev, int& run)
+{
+	for (int x = 0; x < width; x++, in += 3) {
+		uint32_t px = 0xff000000u | ((uint32_t)in[2] << 16) | ((uint32_t)in[1] << 8) | in[0];
+
+		if (px == prev) {
+			if (++run == QOI_MAX_RUN) {
+				*out++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run) {
+			*out++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+			run = 0;
+		}
+
+		int r = in[2], g = in[1], b = in[0];
+		int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+
+		if (index[hash] == px) {
+			*out++ = (uint8_t)(QOI_OP_INDEX | hash);
+		}
+		else {
+			int vr = (int8_t)(r - (int)((prev >> 16) & 0xff));
+			int vg = (int8_t)(g - (int)((prev >> 8) & 0xff));
+			int vb = (int8_t)(b - (int)(prev & 0xff));
+			int vg_r = vr - vg;
+			int vg_b = vb - vg;
+
+			index[hash] = px;
+
+			if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1) {
+				*out++ = (uint8_t)(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+			}
+			else if (vg >= -32 && vg <= 31 && vg_r >= -8 && vg_r <= 7 && vg_b >= -8 && vg_b <= 7) {
+				*out++ = (uint8_t)(QOI_OP_LUMA | (vg + 32));
+				*out++ = (uint8_t)((vg_r + 8) << 4 | (vg_b + 8));
+			}
+			else {
+				*out++ = QOI_OP_RGB;
+				*out++ = (uint8_t)r;
+				*out++ = (uint8_t)g;
+				*out++ = (uint8_t)b;
+			}
+		}
+
+		prev = px;
+	}
+
+	return out;
+}
+
+bool qoi_writer_save_bgr24(const char* file_name, int width, int height,
+	const uint8_t* rows, int stride)
+{
+	static const uint8_t end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	/* A pixel never takes more than 4 bytes, plus the run left from the
+	 * row before and the one closing the image. The buffer is flushed
+	 * before a row could overflow it. */
+	const size_t row_max = (size_t)width * 4 + 2;
+	std::vector<uint8_t> buffer(std::max<size_t>(QOI_WRITER_BUFFER_BYTES, row_max + 14));
+	uint8_t* out = buffer.data();
+	uint32_t index[64] = { 0 };
+	uint32_t prev = 0xff000000u;
+	int run = 0;
+	bool ok = true;
+
+	if (width <= 0 || height <= 0)
+		return false;
+
+	FILE* fp = fopen(file_name, "wb");
+	if (!fp) return false;
+
+	memcpy(out, "qoif", 4);
+	qoi_put_u32(out + 4, (uint32_t)width);
+	qoi_put_u32(out + 8, (uint32_t)height);
+	out[12] = 3; /* RGB */
+	out[13] = 0; /* sRGB */
+	out += 14;
+
+	for (int y = 0; ok && y < height; y++) {
+		if ((size_t)(buffer.data() + buffer.size() - out) < row_max) {
+			size_t len = out - buffer.data();
+			ok = fwrite(buffer.data(), 1, len, fp) == len;
+			out = buffer.data();
+		}
+		out = qoi_encode_row(out, rows + (ptrdiff_t)y * stride, width, index, prev, run);
+	}
+
+	if (run)
+		*out++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+
+	if (ok) {
+		size_t len = out - buffer.data();
+		ok = fwrite(buffer.data(), 1, len, fp) == len
+			&& fwrite(end_marker, 1, sizeof(end_marker), fp) == sizeof(end_marker);
+	}
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok)
+		remove(file_name);
+	return ok;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Writes a BGR24 image as a 3 channel QOI file, see https://qoiformat.org.
+ * Rows are @stride bytes apart starting at @rows, a negative stride writes
+ * a bottom-up image. Rows are encoded as they are read, in one pass. */
+bool qoi_writer_save_bgr24(const char* file_name, int width, int height,
+	const uint8_t* rows, int stride);
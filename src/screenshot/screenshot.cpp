@@ -1,122 +1,255 @@
 #include "screenshot.h"
 
-#include "inc/png.h"
+#include "png_writer.h"
+#include "qoi_writer.h"
+#include "../retroarch/retroarch.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <Windows.h>
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
-static void write_png_file(const char* file_name, int width, int height, const uint8_t* buffer)
+/* Captures that can wait for the writer at once. When all are queued a new
+ * capture is dropped instead of stalling the render thread. */
+#define SCREENSHOT_POOL_SIZE 4
+
+struct ScreenshotBuffer
 {
-	FILE* fp = fopen(file_name, "wb");
-	if (!fp) return;
+	std::unique_ptr<unsigned char[]> data;
+	size_t size = 0;
+	bool busy = false;
+};
 
-	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (png_ptr == NULL) {
-		fclose(fp);
-		return;
+struct ScreenshotJob
+{
+	std::string folder;
+	std::string name;
+	int width;
+	int height;
+	int format;
+	int level;
+	int filter;
+	unsigned char* data;
+};
+
+static std::mutex sMutex;
+static std::condition_variable sCond;
+static std::thread sWriter;
+static std::deque<ScreenshotJob> sJobs;
+static ScreenshotBuffer sBuffers[SCREENSHOT_POOL_SIZE];
+static bool sQuit = false;
+
+/* Next free index per file name prefix, only touched by the writer. */
+static std::unordered_map<std::string, int> sNextIndex;
+
+static bool write_png_file(const char* file_name, int width, int height, const uint8_t* buffer, int level, int filter)
+{
+	/* The buffer is BGR24, bottom row first. */
+	int stride = width * 3;
+	return png_writer_save_bgr24(file_name, width, height, buffer + (ptrdiff_t)(height - 1) * stride, -stride, level, filter);
+}
+
+static bool write_qoi_file(const char* file_name, int width, int height, const uint8_t* buffer)
+{
+	int stride = width * 3;
+	return qoi_writer_save_bgr24(file_name, width, height, buffer + (ptrdiff_t)(height - 1) * stride, -stride);
+}
+
+static bool ScreenshotExists(const char* fileName)
+{
+	WIN32_FIND_DATAA FindData;
+	HANDLE hFindFile = FindFirstFileA(fileName, &FindData);
+	if (hFindFile == INVALID_HANDLE_VALUE)
+		return false;
+	FindClose(hFindFile);
+	return true;
+}
+
+/* Makes sure @folder exists and returns the first index without a file
+ * in either format, 1000 when they are all taken. */
+static int ScanScreenshotFolder(const std::string& folder, const std::string& prefix)
+{
+	WIN32_FIND_DATAA FindData = { 0 };
+	HANDLE hFindFile = FindFirstFileA(folder.c_str(), &FindData); // Find anything
+	if (hFindFile == INVALID_HANDLE_VALUE) {
+		::CreateDirectoryA(folder.c_str(), NULL);
+		hFindFile = FindFirstFileA(folder.c_str(), &FindData);
 	}
+	if (hFindFile != INVALID_HANDLE_VALUE)
+		FindClose(hFindFile);
 
-	png_infop info_ptr = png_create_info_struct(png_ptr);
-	if (info_ptr == NULL) {
-		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		fclose(fp);
-		return;
+	if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+		return 1000;
+
+	char fileName[MAX_PATH];
+	int i;
+	for (i = 0; i < 1000; ++i) {
+		snprintf(fileName, sizeof(fileName), "%s%03i.png", prefix.c_str(), i);
+		if (ScreenshotExists(fileName))
+			continue;
+		snprintf(fileName, sizeof(fileName), "%s%03i.qoi", prefix.c_str(), i);
+		if (!ScreenshotExists(fileName))
+			break;
 	}
+	return i;
+}
+
+static void SaveScreenshot(const ScreenshotJob& job)
+{
+	const char* fileExt = job.format == SCREENSHOT_FORMAT_QOI ? "qoi" : "png";
 
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		fclose(fp);
+	std::string folder = job.folder;
+	if (folder.size() > 1 && folder[folder.size() - 1] == '\\') folder.resize(folder.size() - 1);
+
+	std::string romName = job.name;
+	ScreenshotSanitizeName(&romName[0]);
+
+	/* The folder is only scanned for the first capture of a ROM, later
+	 * ones carry on from the cached index. */
+	std::string prefix = folder + "\\ParaLLEl_" + romName + "_";
+	auto it = sNextIndex.find(prefix);
+	if (it == sNextIndex.end())
+		it = sNextIndex.emplace(prefix, ScanScreenshotFolder(folder, prefix)).first;
+	if (it->second >= 1000) {
+		RARCH_LOG("[Screenshot]: Dropped, \"%s\" already holds 1000 captures of this ROM.\n", folder.c_str());
 		return;
 	}
 
-	png_init_io(png_ptr, fp);
+	char fileName[MAX_PATH];
+	snprintf(fileName, sizeof(fileName), "%s%03i.%s", prefix.c_str(), it->second, fileExt);
+
+	bool written;
+	if (job.format == SCREENSHOT_FORMAT_QOI)
+		written = write_qoi_file(fileName, job.width, job.height, job.data);
+	else
+		written = write_png_file(fileName, job.width, job.height, job.data, job.level, job.filter);
+
+	/* The writers remove what they could not finish, so a failed index is free again. */
+	if (written)
+		it->second++;
+	else
+		RARCH_LOG("[Screenshot]: Failed to write \"%s\".\n", fileName);
+}
 
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		fclose(fp);
-		return;
+void ScreenshotSanitizeName(char* _name)
+{
+	for (; *_name; _name++) {
+		if (*_name == ' ') *_name = '_';
+		else if (*_name == ':') *_name = ';';
+		else if (*_name == '/') *_name = '-';
+		else if (strchr("\\*?\"<>|", *_name) || (unsigned char)*_name < 0x20) *_name = '_';
 	}
+}
 
-	png_byte bit_depth = 8;
-	png_byte color_type = PNG_COLOR_TYPE_RGB;
-	png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+static void ReleaseBufferLocked(unsigned char* buffer)
+{
+	for (auto& pooled : sBuffers) {
+		if (pooled.data.get() == buffer) {
+			pooled.busy = false;
+			break;
+		}
+	}
+}
+
+static void ScreenshotWriter()
+{
+	std::unique_lock<std::mutex> lock(sMutex);
+	for (;;) {
+		sCond.wait(lock, [] { return sQuit || !sJobs.empty(); });
+		if (sJobs.empty())
+			break;
 
-	png_write_info(png_ptr, info_ptr);
+		ScreenshotJob job = std::move(sJobs.front());
+		sJobs.pop_front();
 
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		fclose(fp);
-		return;
+		lock.unlock();
+		SaveScreenshot(job);
+		lock.lock();
+
+		ReleaseBufferLocked(job.data);
 	}
+}
 
-	int pixel_size = 3;
-	int p = 0;
-	png_bytep* row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
-	for (int y = height - 1; y >= 0; y--) {
-		row_pointers[y] = (png_byte*)malloc(width * pixel_size);
-		for (int x = 0; x < width; x++) {
-			row_pointers[y][x * pixel_size + 2] = buffer[p++];
-			row_pointers[y][x * pixel_size + 1] = buffer[p++];
-			row_pointers[y][x * pixel_size + 0] = buffer[p++];
+unsigned char* ScreenshotAcquireBuffer(size_t size, bool* busy)
+{
+	std::lock_guard<std::mutex> lock(sMutex);
+	ScreenshotBuffer* free_buffer = nullptr;
+
+	*busy = false;
+
+	/* Prefer a buffer that is already large enough. */
+	for (auto& pooled : sBuffers) {
+		if (pooled.busy)
+			continue;
+		if (pooled.size >= size) {
+			free_buffer = &pooled;
+			break;
 		}
+		if (!free_buffer)
+			free_buffer = &pooled;
 	}
-	png_write_image(png_ptr, row_pointers);
-
-	for (int y = 0; y < height; y++) {
-		free(row_pointers[y]);
+	if (!free_buffer) {
+		*busy = true;
+		return NULL;
 	}
-	free(row_pointers);
 
-	if (setjmp(png_jmpbuf(png_ptr))) {
-		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-		fclose(fp);
-		return;
+	if (free_buffer->size < size) {
+		free_buffer->data.reset(new (std::nothrow) unsigned char[size]);
+		free_buffer->size = free_buffer->data ? size : 0;
+		if (!free_buffer->data)
+			return NULL;
 	}
-	png_write_end(png_ptr, NULL);
-	fclose(fp);
+
+	free_buffer->busy = true;
+	return free_buffer->data.get();
 }
 
-void SaveScreenshot(const char* _folder, const char* _name, int _width, int _height, const unsigned char* _data)
+void ScreenshotReleaseBuffer(unsigned char* _buffer)
 {
-	const char fileExt[] = "png";
+	std::lock_guard<std::mutex> lock(sMutex);
+	ReleaseBufferLocked(_buffer);
+}
 
-	std::string folder = _folder;
-	if (folder.size() > 1 && folder[folder.size() - 1] == '\\') folder.resize(folder.size() - 1);
+void ScreenshotSubmit(const char* _folder, const char* _name, int _width, int _height, unsigned char* _data, int _format, int _level, int _filter)
+{
+	std::lock_guard<std::mutex> lock(sMutex);
 
-	WIN32_FIND_DATAA FindData = { 0 };
-	HANDLE hFindFile = FindFirstFileA(folder.c_str(), &FindData); // Find anything
-	if (hFindFile == INVALID_HANDLE_VALUE) {
-		::CreateDirectoryA(folder.c_str(), NULL);
-		hFindFile = FindFirstFileA(folder.c_str(), &FindData);
+	/* Started on the first capture, most sessions never take one. */
+	if (!sWriter.joinable()) {
+		sQuit = false;
+		sWriter = std::thread(ScreenshotWriter);
 	}
-	if (hFindFile != INVALID_HANDLE_VALUE)
-		FindClose(hFindFile);
 
-	if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
-		return;
+	sJobs.push_back({ _folder, _name, _width, _height, _format, _level, _filter, _data });
+	sCond.notify_one();
+}
 
-	std::string romName = _name;
-	for (size_t i = 0, n = romName.size(); i < n; i++) {
-		if (romName[i] == ' ') romName[i] = '_';
-		else if (romName[i] == ':') romName[i] = ';';
-		else if (romName[i] == '/') romName[i] = '-';
+void ScreenshotShutdown(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(sMutex);
+		sQuit = true;
 	}
+	sCond.notify_all();
 
-	char fileName[MAX_PATH];
-	int i;
-	for (i = 0; i < 1000; ++i) {
-		sprintf(fileName, "%s\\ParaLLEl_%s_%03i.%s", folder.c_str(), romName.c_str(), i, fileExt);
-		hFindFile = FindFirstFileA(fileName, &FindData);
-		if (hFindFile == INVALID_HANDLE_VALUE)
-		{
-			break;
-		}
-		FindClose(hFindFile);
+	/* The writer drains the queue before it leaves. */
+	if (sWriter.joinable())
+		sWriter.join();
+
+	for (auto& pooled : sBuffers) {
+		pooled.data.reset();
+		pooled.size = 0;
+		pooled.busy = false;
 	}
-	if (i == 1000)
-		return;
 
-	write_png_file(fileName, _width, _height, _data);
+	/* Files may be moved or deleted before the next ROM, scan again. */
+	sNextIndex.clear();
 }
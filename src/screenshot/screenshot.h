@@ -1,10 +1,38 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void SaveScreenshot(const char* _folder, const char* _name, int _width, int _height, const unsigned char* _data);
+/* File formats, the values of KEY_SCREENSHOT_FORMAT. */
+enum screenshot_format
+{
+	SCREENSHOT_FORMAT_PNG = 0,
+	SCREENSHOT_FORMAT_QOI /* Lossless too, larger but many times faster to write. */
+};
+
+/* Replaces the characters of a ROM header name that a file name can't
+ * hold, in place. */
+void ScreenshotSanitizeName(char* _name);
+
+/* Returns a pooled buffer of at least @_size bytes, or NULL. @_busy tells
+ * whether that was because every buffer is still waiting for the writer,
+ * otherwise the buffer could not be allocated. */
+unsigned char* ScreenshotAcquireBuffer(size_t _size, bool* _busy);
+
+/* Hands an acquired buffer back without writing it. */
+void ScreenshotReleaseBuffer(unsigned char* _buffer);
+
+/* Queues a BGR24 bottom-up image acquired above for the background writer,
+ * which releases the buffer once the file is written. @_level and @_filter
+ * only apply to PNG. */
+void ScreenshotSubmit(const char* _folder, const char* _name, int _width, int _height, unsigned char* _data, int _format, int _level, int _filter);
+
+/* Writes whatever is queued, stops the writer and frees the pool. */
+void ScreenshotShutdown(void);
 
 #ifdef __cplusplus
 }
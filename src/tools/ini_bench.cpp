@@ -0,0 +1,158 @@
+/*  ini_bench - checks and times the INI engine behind config.c.
+ *
+ *  Usage: ini_bench [-t milliseconds] [-d directory]
+ *
+ *  Writes a cfg.ini with comments, a foreign section and every setting
+ *  into <directory>/LParallel (the current one by default), then checks
+ *  that config_load() reads the values, that config_save() keeps the rest
+ *  of the file intact and that ini_save() without changes skips the write.
+ *
+ *  Then config_load() and config_save() are each run for at least the
+ *  given time (100 ms by default), the way the plugin calls them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+extern "C" {
+#include "../config.h"
+#include "../ini.h"
+
+char gPluginConfigDir[INI_PATH_MAX];
+}
+
+template <typename F>
+static double measure_us(F run, double min_ms)
+{
+    std::chrono::steady_clock::time_point start;
+    double elapsed_us = 0.0;
+    unsigned iterations = 0;
+
+    run();
+
+    start = std::chrono::steady_clock::now();
+    do
+    {
+        run();
+        iterations++;
+        elapsed_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+    } while (elapsed_us < min_ms * 1000.0);
+
+    return elapsed_us / iterations;
+}
+
+static std::string read_text(const char* path)
+{
+    std::string text;
+    FILE* fp = fopen(path, "rb");
+    if (fp)
+    {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            text.append(buf, n);
+        fclose(fp);
+    }
+    return text;
+}
+
+static bool check(bool ok, const char* what, unsigned& failures)
+{
+    if (!ok)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* dir = ".";
+    double min_ms = 100.0;
+    unsigned failures = 0;
+    int i;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "-t"))
+            min_ms = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-d"))
+            dir = argv[i + 1];
+        else
+            break;
+    }
+
+    if (i != argc || min_ms <= 0.0)
+    {
+        fprintf(stderr, "Usage: %s [-t milliseconds] [-d directory]\n", argv[0]);
+        return 1;
+    }
+
+    snprintf(gPluginConfigDir, sizeof(gPluginConfigDir), "%s", dir);
+    ini_init();
+
+    FILE* fp = fopen(ini_file, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Failed to open %s.\n", ini_file);
+        return 1;
+    }
+
+    fprintf(fp, "; written by ini_bench\r\n[Other]\r\nKEY_UPSCALING=7\r\n\r\n[settings]\r\n");
+    for (int k = 0; k < NUM_CONFIGVARS; k++)
+        fprintf(fp, "%s = %d\r\n", settings[k].name, 100 + k);
+    fprintf(fp, "KEY_SHADER_PRESET=\"C:\\shaders\\crt.slangp\"\r\n[Tail]\r\nKEEP=me\r\n");
+    fclose(fp);
+
+    printf("Config: %s\n", ini_file);
+
+    config_init();
+    bool values_ok = true;
+    for (int k = 0; k < NUM_CONFIGVARS; k++)
+        values_ok = values_ok && settings[k].val == 100 + k;
+    check(values_ok, "config_init reads every setting from [settings]", failures);
+    check(!strcmp(string_settings[SKEY_SHADER_PRESET].val, "C:\\shaders\\crt.slangp"),
+        "quoted string values lose their quotes", failures);
+
+    settings[KEY_UPSCALING].val = 2;
+    config_save();
+    std::string text = read_text(ini_file);
+    check(text.find("; written by ini_bench\r\n[Other]\r\nKEY_UPSCALING=7\r\n") == 0,
+        "config_save keeps comments and other sections", failures);
+    check(text.find("KEY_UPSCALING=2\r\n") != std::string::npos
+        && text.find("KEY_SCREEN_WIDTH = 102\r\n") != std::string::npos,
+        "config_save rewrites changed keys only", failures);
+    check(text.find("[Tail]\r\nKEEP=me\r\n") != std::string::npos,
+        "config_save keeps sections after [Settings]", failures);
+
+    settings[KEY_UPSCALING].val = 0;
+    config_load();
+    check(settings[KEY_UPSCALING].val == 2, "config_load rereads the saved file", failures);
+
+    remove(ini_file);
+    check(!ini_load(), "ini_load reports a missing file", failures);
+    check(ini_set_value("KEY_NEW", 5) && ini_save(), "ini_save creates the file", failures);
+    check(read_text(ini_file) == "[Settings]\r\nKEY_NEW=5\r\n", "new keys start a [Settings] section", failures);
+
+    int value = -1;
+    check(ini_load() && !ini_get_value("KEY_MISSING", &value), "missing keys are reported", failures);
+
+    config_save();
+    printf("config_load: %8.2f us\n", measure_us([] { config_load(); }, min_ms));
+    printf("config_save: %8.2f us (unchanged, no write)\n", measure_us([] { config_save(); }, min_ms));
+    printf("config_save: %8.2f us (one key changed)\n", measure_us([] {
+        settings[KEY_SCREEN_WIDTH].val ^= 1;
+        config_save();
+    }, min_ms));
+
+    if (failures)
+        printf("%u check(s) failed.\n", failures);
+
+    return failures ? 1 : 0;
+}
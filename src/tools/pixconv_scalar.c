@@ -0,0 +1,30 @@
+/*  pixconv.c once more without SSE2 and MMX, every exported function
+ *  renamed to scalar_*. pixel_bench checks each kernel the plugin can run
+ *  against these, byte for byte.
+ */
+
+#define SCALER_NO_SIMD
+#undef __MMX__
+
+#define conv_rgb565_0rgb1555   scalar_conv_rgb565_0rgb1555
+#define conv_0rgb1555_rgb565   scalar_conv_0rgb1555_rgb565
+#define conv_0rgb1555_argb8888 scalar_conv_0rgb1555_argb8888
+#define conv_rgb565_argb8888   scalar_conv_rgb565_argb8888
+#define conv_rgb565_abgr8888   scalar_conv_rgb565_abgr8888
+#define conv_argb8888_rgba4444 scalar_conv_argb8888_rgba4444
+#define conv_rgba4444_argb8888 scalar_conv_rgba4444_argb8888
+#define conv_rgba4444_rgb565   scalar_conv_rgba4444_rgb565
+#define conv_0rgb1555_bgr24    scalar_conv_0rgb1555_bgr24
+#define conv_rgb565_bgr24      scalar_conv_rgb565_bgr24
+#define conv_bgr24_argb8888    scalar_conv_bgr24_argb8888
+#define conv_bgr24_rgb565      scalar_conv_bgr24_rgb565
+#define conv_argb8888_0rgb1555 scalar_conv_argb8888_0rgb1555
+#define conv_argb8888_bgr24    scalar_conv_argb8888_bgr24
+#define conv_abgr8888_bgr24    scalar_conv_abgr8888_bgr24
+#define conv_argb8888_abgr8888 scalar_conv_argb8888_abgr8888
+#define conv_yuyv_argb8888     scalar_conv_yuyv_argb8888
+#define conv_copy              scalar_conv_copy
+#define pixconv_has_avx2       scalar_pixconv_has_avx2
+#define pixconv_select         scalar_pixconv_select
+
+#include "../retroarch/pixconv.c"
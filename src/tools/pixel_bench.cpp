@@ -0,0 +1,478 @@
+/*  pixel_bench - benchmarks the CPU pixel pipeline, pixconv and the scaler.
+ *
+ *  Usage: pixel_bench [-t milliseconds] [-f filter] [-o results.csv]
+ *
+ *  Every pixconv conversion is first run at a range of odd widths with
+ *  the kernel pixconv.c builds to (SSE2 on most x86 compilers), the one
+ *  picked by pixconv_select() and a scalar build of pixconv.c, into
+ *  buffers filled with the same canary. Both must match the scalar one
+ *  over the whole buffer.
+ *
+ *  Then every conversion is timed at the N64 resolutions and their
+ *  upscales up to 2560x1920, followed by scaler_ctx_scale() for each
+ *  scaler type and every input and output format it accepts. Each case
+ *  runs for at least the given time (100 ms by default). Only cases whose
+ *  name contains the filter string are timed.
+ *
+ *  Rates are in megapixels per second of output, cycles are TSC ticks per
+ *  output pixel (x86 only). Results can also be written as CSV.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define PIXEL_BENCH_TSC
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define PIXEL_BENCH_TSC
+#endif
+
+extern "C" {
+#include "../retroarch/pixconv.h"
+#include "../retroarch/scaler.h"
+}
+
+/* pixconv_scalar.c, pixconv.c without SIMD. */
+#define PIXEL_BENCH_SCALAR(name) \
+    extern "C" void scalar_##name(void* output, const void* input, \
+        int width, int height, int out_stride, int in_stride);
+PIXEL_BENCH_SCALAR(conv_0rgb1555_argb8888)
+PIXEL_BENCH_SCALAR(conv_0rgb1555_rgb565)
+PIXEL_BENCH_SCALAR(conv_0rgb1555_bgr24)
+PIXEL_BENCH_SCALAR(conv_rgb565_0rgb1555)
+PIXEL_BENCH_SCALAR(conv_rgb565_argb8888)
+PIXEL_BENCH_SCALAR(conv_rgb565_abgr8888)
+PIXEL_BENCH_SCALAR(conv_rgb565_bgr24)
+PIXEL_BENCH_SCALAR(conv_rgba4444_argb8888)
+PIXEL_BENCH_SCALAR(conv_rgba4444_rgb565)
+PIXEL_BENCH_SCALAR(conv_bgr24_argb8888)
+PIXEL_BENCH_SCALAR(conv_bgr24_rgb565)
+PIXEL_BENCH_SCALAR(conv_argb8888_0rgb1555)
+PIXEL_BENCH_SCALAR(conv_argb8888_rgba4444)
+PIXEL_BENCH_SCALAR(conv_argb8888_bgr24)
+PIXEL_BENCH_SCALAR(conv_argb8888_abgr8888)
+PIXEL_BENCH_SCALAR(conv_abgr8888_bgr24)
+PIXEL_BENCH_SCALAR(conv_yuyv_argb8888)
+
+struct conversion
+{
+    const char* name;
+    pixconv_fn conv;
+    pixconv_fn scalar;
+    scaler_pix_fmt in_fmt;
+    scaler_pix_fmt out_fmt;
+};
+
+/* Every conversion scaler_ctx_gen_filter() binds. */
+static const conversion conversions[] = {
+    { "0rgb1555_argb8888", conv_0rgb1555_argb8888, scalar_conv_0rgb1555_argb8888, SCALER_FMT_0RGB1555, SCALER_FMT_ARGB8888 },
+    { "0rgb1555_rgb565",   conv_0rgb1555_rgb565,   scalar_conv_0rgb1555_rgb565,   SCALER_FMT_0RGB1555, SCALER_FMT_RGB565 },
+    { "0rgb1555_bgr24",    conv_0rgb1555_bgr24,    scalar_conv_0rgb1555_bgr24,    SCALER_FMT_0RGB1555, SCALER_FMT_BGR24 },
+    { "rgb565_0rgb1555",   conv_rgb565_0rgb1555,   scalar_conv_rgb565_0rgb1555,   SCALER_FMT_RGB565,   SCALER_FMT_0RGB1555 },
+    { "rgb565_argb8888",   conv_rgb565_argb8888,   scalar_conv_rgb565_argb8888,   SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888 },
+    { "rgb565_abgr8888",   conv_rgb565_abgr8888,   scalar_conv_rgb565_abgr8888,   SCALER_FMT_RGB565,   SCALER_FMT_ABGR8888 },
+    { "rgb565_bgr24",      conv_rgb565_bgr24,      scalar_conv_rgb565_bgr24,      SCALER_FMT_RGB565,   SCALER_FMT_BGR24 },
+    { "rgba4444_argb8888", conv_rgba4444_argb8888, scalar_conv_rgba4444_argb8888, SCALER_FMT_RGBA4444, SCALER_FMT_ARGB8888 },
+    { "rgba4444_rgb565",   conv_rgba4444_rgb565,   scalar_conv_rgba4444_rgb565,   SCALER_FMT_RGBA4444, SCALER_FMT_RGB565 },
+    { "bgr24_argb8888",    conv_bgr24_argb8888,    scalar_conv_bgr24_argb8888,    SCALER_FMT_BGR24,    SCALER_FMT_ARGB8888 },
+    { "bgr24_rgb565",      conv_bgr24_rgb565,      scalar_conv_bgr24_rgb565,      SCALER_FMT_BGR24,    SCALER_FMT_RGB565 },
+    { "argb8888_0rgb1555", conv_argb8888_0rgb1555, scalar_conv_argb8888_0rgb1555, SCALER_FMT_ARGB8888, SCALER_FMT_0RGB1555 },
+    { "argb8888_rgba4444", conv_argb8888_rgba4444, scalar_conv_argb8888_rgba4444, SCALER_FMT_ARGB8888, SCALER_FMT_RGBA4444 },
+    { "argb8888_bgr24",    conv_argb8888_bgr24,    scalar_conv_argb8888_bgr24,    SCALER_FMT_ARGB8888, SCALER_FMT_BGR24 },
+    { "argb8888_abgr8888", conv_argb8888_abgr8888, scalar_conv_argb8888_abgr8888, SCALER_FMT_ARGB8888, SCALER_FMT_ABGR8888 },
+    { "abgr8888_bgr24",    conv_abgr8888_bgr24,    scalar_conv_abgr8888_bgr24,    SCALER_FMT_ABGR8888, SCALER_FMT_BGR24 },
+    { "yuyv_argb8888",     conv_yuyv_argb8888,     scalar_conv_yuyv_argb8888,     SCALER_FMT_YUYV,     SCALER_FMT_ARGB8888 },
+};
+
+/* The scaler works in ARGB8888, so it takes these in and out.
+ * ABGR8888 is scaled as it is and then converted. */
+static const scaler_pix_fmt scaler_in_fmts[] = {
+    SCALER_FMT_ARGB8888, SCALER_FMT_ABGR8888, SCALER_FMT_0RGB1555,
+    SCALER_FMT_RGB565, SCALER_FMT_BGR24, SCALER_FMT_RGBA4444,
+};
+
+static const scaler_pix_fmt scaler_out_fmts[] = {
+    SCALER_FMT_ARGB8888, SCALER_FMT_ABGR8888, SCALER_FMT_0RGB1555,
+    SCALER_FMT_BGR24, SCALER_FMT_RGBA4444,
+};
+
+struct size
+{
+    int width;
+    int height;
+};
+
+/* N64 output, the 2x and 4x upscales the plugin renders at. */
+static const size conversion_sizes[] = {
+    { 320, 240 }, { 640, 480 }, { 1280, 960 }, { 2560, 1920 },
+};
+
+struct scale
+{
+    size in;
+    size out;
+};
+
+static const scale scaler_sizes[] = {
+    { { 320, 240 }, { 640, 480 } },
+    { { 320, 240 }, { 1280, 960 } },
+    { { 640, 480 }, { 2560, 1920 } },
+    { { 2560, 1920 }, { 640, 480 } },
+    { { 2560, 1920 }, { 320, 240 } },
+};
+
+struct result
+{
+    double mpix_per_s;
+    double cycles_per_pixel;
+};
+
+static const char* fmt_name(scaler_pix_fmt fmt)
+{
+    switch (fmt)
+    {
+    case SCALER_FMT_ARGB8888: return "argb8888";
+    case SCALER_FMT_ABGR8888: return "abgr8888";
+    case SCALER_FMT_0RGB1555: return "0rgb1555";
+    case SCALER_FMT_RGB565:   return "rgb565";
+    case SCALER_FMT_BGR24:    return "bgr24";
+    case SCALER_FMT_YUYV:     return "yuyv";
+    case SCALER_FMT_RGBA4444: return "rgba4444";
+    }
+    return "?";
+}
+
+static int fmt_bpp(scaler_pix_fmt fmt)
+{
+    switch (fmt)
+    {
+    case SCALER_FMT_ARGB8888:
+    case SCALER_FMT_ABGR8888:
+        return 4;
+    case SCALER_FMT_BGR24:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+static const char* type_name(scaler_type type)
+{
+    switch (type)
+    {
+    case SCALER_TYPE_POINT:    return "point";
+    case SCALER_TYPE_BILINEAR: return "bilinear";
+    case SCALER_TYPE_SINC:     return "sinc";
+    default:                   return "?";
+    }
+}
+
+static uint64_t read_tsc()
+{
+#ifdef PIXEL_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Leaves room behind the last row for overruns. */
+static size_t buffer_size(int height, int stride)
+{
+    return size_t(height) * size_t(stride) + 256;
+}
+
+static void fill_random(std::vector<uint8_t>& data, uint32_t seed)
+{
+    size_t i;
+
+    for (i = 0; i < data.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        data[i] = uint8_t(seed >> 24);
+    }
+}
+
+/* Checks @kernel, called @kind in messages, against the scalar build. */
+static bool compare(const conversion& c, pixconv_fn kernel, const char* kind,
+    int width, int height)
+{
+    int in_bpp = fmt_bpp(c.in_fmt);
+    int out_bpp = fmt_bpp(c.out_fmt);
+    /* Odd strides on purpose, nothing may assume aligned rows. */
+    int in_stride = width * in_bpp + 4 + (width & 1) * 4;
+    int out_stride = width * out_bpp + 8 + (width & 1) * 4;
+    std::vector<uint8_t> input(buffer_size(height, in_stride));
+    std::vector<uint8_t> expected(buffer_size(height, out_stride), 0xa5);
+    std::vector<uint8_t> actual(expected);
+
+    fill_random(input, uint32_t(width * 131 + height));
+
+    c.scalar(expected.data(), input.data(), width, height, out_stride, in_stride);
+    kernel(actual.data(), input.data(), width, height, out_stride, in_stride);
+
+    if (expected != actual)
+    {
+        size_t i = 0;
+        while (expected[i] == actual[i])
+            i++;
+        fprintf(stderr, "%s (%s): %dx%d differs from scalar at byte %u\n",
+            c.name, kind, width, height, unsigned(i));
+        return false;
+    }
+
+    return true;
+}
+
+/* Runs @run until @min_ms have passed, after one untimed call to warm
+ * the caches. @pixels is what one call produces. */
+template <typename F>
+static result measure(F run, double pixels, double min_ms)
+{
+    std::chrono::steady_clock::time_point start;
+    double elapsed_us = 0.0;
+    uint64_t tsc_start;
+    unsigned iterations = 0;
+    result r;
+
+    run();
+
+    start = std::chrono::steady_clock::now();
+    tsc_start = read_tsc();
+    do
+    {
+        run();
+        iterations++;
+        elapsed_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+    } while (elapsed_us < min_ms * 1000.0);
+
+    r.mpix_per_s = pixels * iterations / elapsed_us;
+    r.cycles_per_pixel = double(read_tsc() - tsc_start) / (pixels * iterations);
+    return r;
+}
+
+class report
+{
+public:
+    explicit report(FILE* csv) : csv(csv)
+    {
+        if (csv)
+            fprintf(csv, "group,case,variant,in_width,in_height,out_width,out_height,mpix_per_s,cycles_per_pixel\n");
+    }
+
+    void header(const char* group)
+    {
+        printf("\n%-32s %-6s %21s %11s %10s\n",
+            group, "", "size", "MPix/s", "cycles/pix");
+    }
+
+    void add(const char* group, const std::string& name, const char* variant,
+        size in, size out, const result& r)
+    {
+        char dims[32];
+
+        if (in.width == out.width && in.height == out.height)
+            snprintf(dims, sizeof(dims), "%dx%d", out.width, out.height);
+        else
+            snprintf(dims, sizeof(dims), "%dx%d->%dx%d",
+                in.width, in.height, out.width, out.height);
+        printf("%-32s %-6s %21s %11.1f", name.c_str(), variant, dims, r.mpix_per_s);
+#ifdef PIXEL_BENCH_TSC
+        printf(" %10.2f\n", r.cycles_per_pixel);
+#else
+        printf(" %10s\n", "-");
+#endif
+
+        if (csv)
+        {
+            fprintf(csv, "%s,%s,%s,%d,%d,%d,%d,%.3f,", group, name.c_str(), variant,
+                in.width, in.height, out.width, out.height, r.mpix_per_s);
+#ifdef PIXEL_BENCH_TSC
+            fprintf(csv, "%.3f\n", r.cycles_per_pixel);
+#else
+            fprintf(csv, "\n");
+#endif
+        }
+    }
+
+private:
+    FILE* csv;
+};
+
+static void bench_conversion(report& out, const conversion& c, pixconv_fn fast,
+    size dims, double min_ms)
+{
+    int in_stride = dims.width * fmt_bpp(c.in_fmt);
+    int out_stride = dims.width * fmt_bpp(c.out_fmt);
+    std::vector<uint8_t> input(buffer_size(dims.height, in_stride));
+    std::vector<uint8_t> output(buffer_size(dims.height, out_stride));
+    double pixels = double(dims.width) * dims.height;
+    result r;
+
+    fill_random(input, 1);
+
+    r = measure([&] {
+        c.conv(output.data(), input.data(), dims.width, dims.height, out_stride, in_stride);
+    }, pixels, min_ms);
+    out.add("pixconv", c.name, "base", dims, dims, r);
+
+    if (fast == c.conv)
+        return;
+
+    r = measure([&] {
+        fast(output.data(), input.data(), dims.width, dims.height, out_stride, in_stride);
+    }, pixels, min_ms);
+    out.add("pixconv", c.name, "fast", dims, dims, r);
+}
+
+static bool bench_scaler(report& out, scaler_type type,
+    scaler_pix_fmt in_fmt, scaler_pix_fmt out_fmt, const scale& s, double min_ms)
+{
+    scaler_ctx ctx;
+    std::vector<uint8_t> input, output;
+    std::string name = std::string(type_name(type)) + " "
+        + fmt_name(in_fmt) + "_" + fmt_name(out_fmt);
+    result r;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.in_width = s.in.width;
+    ctx.in_height = s.in.height;
+    ctx.in_stride = s.in.width * fmt_bpp(in_fmt);
+    ctx.in_fmt = in_fmt;
+    ctx.out_width = s.out.width;
+    ctx.out_height = s.out.height;
+    ctx.out_stride = s.out.width * fmt_bpp(out_fmt);
+    ctx.out_fmt = out_fmt;
+    ctx.scaler_type = type;
+
+    if (!scaler_ctx_gen_filter(&ctx))
+    {
+        fprintf(stderr, "%s: %dx%d to %dx%d not supported\n", name.c_str(),
+            s.in.width, s.in.height, s.out.width, s.out.height);
+        scaler_ctx_gen_reset(&ctx);
+        return false;
+    }
+
+    input.resize(buffer_size(ctx.in_height, ctx.in_stride));
+    output.resize(buffer_size(ctx.out_height, ctx.out_stride));
+    fill_random(input, 2);
+
+    r = measure([&] {
+        scaler_ctx_scale(&ctx, output.data(), input.data());
+    }, double(s.out.width) * s.out.height, min_ms);
+    out.add("scaler", name, "", s.in, s.out, r);
+
+    scaler_ctx_gen_reset(&ctx);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    static const int widths[] = { 1, 2, 7, 9, 15, 16, 17, 31, 32, 33, 63, 65, 100, 321 };
+    static const scaler_type types[] = {
+        SCALER_TYPE_POINT, SCALER_TYPE_BILINEAR, SCALER_TYPE_SINC,
+    };
+    const char* filter = "";
+    const char* csv_path = NULL;
+    FILE* csv = NULL;
+    double min_ms = 100.0;
+    unsigned failures = 0;
+    int i;
+
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "-t"))
+            min_ms = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            filter = argv[i + 1];
+        else if (!strcmp(argv[i], "-o"))
+            csv_path = argv[i + 1];
+        else
+            break;
+    }
+
+    if (i != argc || min_ms <= 0.0)
+    {
+        fprintf(stderr, "Usage: %s [-t milliseconds] [-f filter] [-o results.csv]\n", argv[0]);
+        return 1;
+    }
+
+    if (csv_path && !(csv = fopen(csv_path, "w")))
+    {
+        fprintf(stderr, "Failed to open %s.\n", csv_path);
+        return 1;
+    }
+
+    printf("AVX2 kernels: %s\n", pixconv_has_avx2() ? "yes" : "no");
+
+    report out(csv);
+
+    out.header("pixconv");
+    for (const conversion& c : conversions)
+    {
+        pixconv_fn fast = pixconv_select(c.conv);
+        bool exact = true;
+
+        for (int w : widths)
+        {
+            exact = compare(c, c.conv, "baseline", w, 3) && exact;
+            if (fast != c.conv)
+                exact = compare(c, fast, "selected", w, 3) && exact;
+        }
+        if (!exact)
+        {
+            failures++;
+            continue;
+        }
+
+        if (!strstr(c.name, filter))
+            continue;
+
+        for (const size& dims : conversion_sizes)
+            bench_conversion(out, c, fast, dims, min_ms);
+    }
+
+    out.header("scaler");
+    for (scaler_type type : types)
+    {
+        for (scaler_pix_fmt in_fmt : scaler_in_fmts)
+        {
+            for (scaler_pix_fmt out_fmt : scaler_out_fmts)
+            {
+                std::string name = std::string(type_name(type)) + " "
+                    + fmt_name(in_fmt) + "_" + fmt_name(out_fmt);
+
+                /* The format conversions are covered above, only
+                 * pair them with ARGB8888 on the other side. */
+                if (in_fmt != SCALER_FMT_ARGB8888 && out_fmt != SCALER_FMT_ARGB8888
+                    && !(in_fmt == SCALER_FMT_ABGR8888 && out_fmt == SCALER_FMT_BGR24))
+                    continue;
+                if (!strstr(name.c_str(), filter))
+                    continue;
+
+                for (const scale& s : scaler_sizes)
+                {
+                    if (!bench_scaler(out, type, in_fmt, out_fmt, s, min_ms))
+                        failures++;
+                }
+            }
+        }
+    }
+
+    if (csv)
+        fclose(csv);
+
+    if (failures)
+        printf("%u case(s) failed.\n", failures);
+
+    return failures ? 1 : 0;
+}
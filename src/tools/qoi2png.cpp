@@ -0,0 +1,188 @@
+/*  qoi2png - converts QOI screenshots to PNG.
+ *
+ *  Usage: qoi2png [-l level] [-f filter] file.qoi...
+ *
+ *  Each file is written next to the input with a .png extension, using the
+ *  same encoder as the plugin. Level is the zlib level (6 by default) and
+ *  filter one of the KEY_PNG_FILTER values (5, adaptive, by default).
+ *  Only 3 channel files, the ones the plugin writes, are accepted.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "../screenshot/png_writer.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_MASK_2 0xc0
+
+static uint32_t read_u32(const uint8_t* in)
+{
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>& data)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    bool ok = size >= 0;
+    if (ok)
+    {
+        data.resize((size_t)size);
+        ok = fread(data.data(), 1, data.size(), fp) == data.size();
+    }
+    fclose(fp);
+    return ok;
+}
+
+/* Decodes @data into BGR24 rows, top row first. */
+static bool decode_qoi(const std::vector<uint8_t>& data, int& width, int& height, std::vector<uint8_t>& bgr)
+{
+    if (data.size() < 14 + 8 || memcmp(data.data(), "qoif", 4))
+        return false;
+
+    uint32_t w = read_u32(data.data() + 4);
+    uint32_t h = read_u32(data.data() + 8);
+    if (!w || !h || data[12] != 3 || (uint64_t)w * h > (uint64_t)400000000)
+        return false;
+
+    width = (int)w;
+    height = (int)h;
+    bgr.resize((size_t)w * h * 3);
+
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    size_t pos = 14, end = data.size() - 8;
+    int run = 0;
+
+    for (size_t out = 0; out < bgr.size(); out += 3)
+    {
+        if (run)
+            run--;
+        else if (pos < end)
+        {
+            int b1 = data[pos++];
+
+            if (b1 == QOI_OP_RGB)
+            {
+                if (pos + 3 > end)
+                    return false;
+                px[0] = data[pos++];
+                px[1] = data[pos++];
+                px[2] = data[pos++];
+            }
+            else if (b1 == QOI_OP_RGBA)
+            {
+                if (pos + 4 > end)
+                    return false;
+                px[0] = data[pos++];
+                px[1] = data[pos++];
+                px[2] = data[pos++];
+                px[3] = data[pos++];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+                memcpy(px, index[b1], 4);
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                px[0] += ((b1 >> 4) & 3) - 2;
+                px[1] += ((b1 >> 2) & 3) - 2;
+                px[2] += (b1 & 3) - 2;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                if (pos >= end)
+                    return false;
+                int b2 = data[pos++];
+                int vg = (b1 & 0x3f) - 32;
+                px[0] += vg - 8 + ((b2 >> 4) & 0x0f);
+                px[1] += vg;
+                px[2] += vg - 8 + (b2 & 0x0f);
+            }
+            else
+                run = b1 & 0x3f;
+
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) & 63], px, 4);
+        }
+        else
+            return false;
+
+        bgr[out + 0] = px[2];
+        bgr[out + 1] = px[1];
+        bgr[out + 2] = px[0];
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int level = 6;
+    int filter = PNG_WRITER_FILTER_ADAPTIVE;
+    int failed = 0;
+    int i;
+
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+    {
+        if (!strcmp(argv[i], "-l"))
+            level = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            filter = atoi(argv[i + 1]);
+        else
+            break;
+    }
+
+    if (i >= argc || argv[i][0] == '-')
+    {
+        fprintf(stderr, "Usage: %s [-l level] [-f filter] file.qoi...\n", argv[0]);
+        return 1;
+    }
+
+    for (; i < argc; i++)
+    {
+        std::vector<uint8_t> data, bgr;
+        int width, height;
+
+        std::string out_path = argv[i];
+        size_t dot = out_path.find_last_of('.');
+        size_t sep = out_path.find_last_of("/\\");
+        if (dot != std::string::npos && (sep == std::string::npos || dot > sep))
+            out_path.resize(dot);
+        out_path += ".png";
+
+        if (!read_file(argv[i], data))
+        {
+            fprintf(stderr, "Failed to read %s.\n", argv[i]);
+            failed++;
+        }
+        else if (!decode_qoi(data, width, height, bgr))
+        {
+            fprintf(stderr, "%s is not a valid 3 channel QOI file.\n", argv[i]);
+            failed++;
+        }
+        else if (!png_writer_save_bgr24(out_path.c_str(), width, height, bgr.data(), width * 3, level, filter))
+        {
+            fprintf(stderr, "Failed to write %s.\n", out_path.c_str());
+            failed++;
+        }
+        else
+            printf("%s -> %s\n", argv[i], out_path.c_str());
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/*  slang_reflect_bench - compares slang_spirv_scanner against spirv_cross::Compiler.
+ *
+ *  Usage: slang_reflect_bench [-n iterations] shader.spv [shader.spv ...]
+ *
+ *  Every module is reflected with both implementations. The resources,
+ *  their decorations and the active buffer ranges of every uniform and
+ *  push constant block must match, then both are timed over the given
+ *  number of iterations. Accepts binary SPIR-V as well as the C array
+ *  text written by glslc -mfmt=c (the .inc files in vulkan_shaders).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../retroarch/slang_spirv_scanner.h"
+
+using namespace spirv_cross;
+
+static const char* path_basename(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    const char* backslash = strrchr(path, '\\');
+
+    if (backslash > slash)
+        slash = backslash;
+    return slash ? slash + 1 : path;
+}
+
+static bool read_module(const char* path, std::vector<uint32_t>& words)
+{
+    std::vector<char> data;
+    FILE* file = fopen(path, "rb");
+    long size;
+
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size <= 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    data.resize(size_t(size) + 1);
+    if (fread(data.data(), 1, size_t(size), file) != size_t(size))
+    {
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    data[size_t(size)] = '\0';
+
+    words.clear();
+
+    if (size >= 4 && (size % 4) == 0)
+    {
+        uint32_t magic;
+        memcpy(&magic, data.data(), sizeof(magic));
+        if (magic == spv::MagicNumber)
+        {
+            words.resize(size_t(size) / 4);
+            memcpy(words.data(), data.data(), size_t(size));
+            return true;
+        }
+    }
+
+    /* glslc -mfmt=c: {0x07230203,0x00010000,...} */
+    {
+        const char* p = data.data();
+        while ((p = strstr(p, "0x")) != NULL)
+        {
+            char* end = NULL;
+            words.push_back(uint32_t(strtoul(p, &end, 16)));
+            p = end;
+        }
+    }
+
+    return !words.empty() && words[0] == spv::MagicNumber;
+}
+
+static bool same_resources(const char* kind,
+    const SmallVector<Resource>& a, const SmallVector<Resource>& b,
+    const Compiler& compiler, const slang_spirv_scanner& scanner)
+{
+    size_t i;
+    static const spv::Decoration decorations[] = {
+        spv::DecorationLocation,
+        spv::DecorationBinding,
+        spv::DecorationDescriptorSet,
+    };
+
+    if (a.size() != b.size())
+    {
+        fprintf(stderr, "  %s: %u vs. %u resources\n", kind,
+            unsigned(a.size()), unsigned(b.size()));
+        return false;
+    }
+
+    for (i = 0; i < a.size(); i++)
+    {
+        if (a[i].id != b[i].id
+            || a[i].type_id != b[i].type_id
+            || a[i].base_type_id != b[i].base_type_id
+            || a[i].name != b[i].name)
+        {
+            fprintf(stderr, "  %s #%u: \"%s\" (%u) vs. \"%s\" (%u)\n", kind,
+                unsigned(i), a[i].name.c_str(), a[i].id,
+                b[i].name.c_str(), b[i].id);
+            return false;
+        }
+
+        for (auto decoration : decorations)
+        {
+            if (compiler.get_decoration(a[i].id, decoration)
+                != scanner.get_decoration(b[i].id, decoration))
+            {
+                fprintf(stderr, "  %s \"%s\": decoration %u differs\n",
+                    kind, a[i].name.c_str(), unsigned(decoration));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool same_ranges(const SmallVector<Resource>& blocks,
+    const Compiler& compiler, const slang_spirv_scanner& scanner)
+{
+    size_t i;
+
+    for (auto& block : blocks)
+    {
+        auto a = compiler.get_active_buffer_ranges(block.id);
+        auto b = scanner.get_active_buffer_ranges(block.id);
+        size_t size_a = compiler.get_declared_struct_size(
+            compiler.get_type(block.base_type_id));
+        size_t size_b = scanner.get_declared_struct_size(
+            scanner.get_type(block.base_type_id));
+
+        if (size_a != size_b)
+        {
+            fprintf(stderr, "  block \"%s\": size %u vs. %u\n",
+                block.name.c_str(), unsigned(size_a), unsigned(size_b));
+            return false;
+        }
+
+        if (a.size() != b.size())
+        {
+            fprintf(stderr, "  block \"%s\": %u vs. %u active ranges\n",
+                block.name.c_str(), unsigned(a.size()), unsigned(b.size()));
+            return false;
+        }
+
+        for (i = 0; i < a.size(); i++)
+        {
+            if (a[i].index != b[i].index
+                || a[i].offset != b[i].offset
+                || a[i].range != b[i].range
+                || compiler.get_member_name(block.base_type_id, a[i].index)
+                != scanner.get_member_name(block.base_type_id, b[i].index))
+            {
+                fprintf(stderr, "  block \"%s\": range #%u differs\n",
+                    block.name.c_str(), unsigned(i));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool compare(const std::vector<uint32_t>& words)
+{
+    Compiler compiler(words);
+    slang_spirv_scanner scanner;
+    ShaderResources a, b;
+
+    if (!scanner.scan(words.data(), words.size()))
+    {
+        fprintf(stderr, "  scanner declined the module\n");
+        return false;
+    }
+
+    a = compiler.get_shader_resources();
+    b = scanner.get_shader_resources();
+
+    return same_resources("uniform_buffers", a.uniform_buffers, b.uniform_buffers, compiler, scanner)
+        && same_resources("storage_buffers", a.storage_buffers, b.storage_buffers, compiler, scanner)
+        && same_resources("stage_inputs", a.stage_inputs, b.stage_inputs, compiler, scanner)
+        && same_resources("stage_outputs", a.stage_outputs, b.stage_outputs, compiler, scanner)
+        && same_resources("subpass_inputs", a.subpass_inputs, b.subpass_inputs, compiler, scanner)
+        && same_resources("storage_images", a.storage_images, b.storage_images, compiler, scanner)
+        && same_resources("sampled_images", a.sampled_images, b.sampled_images, compiler, scanner)
+        && same_resources("atomic_counters", a.atomic_counters, b.atomic_counters, compiler, scanner)
+        && same_resources("push_constant_buffers", a.push_constant_buffers, b.push_constant_buffers, compiler, scanner)
+        && same_resources("separate_images", a.separate_images, b.separate_images, compiler, scanner)
+        && same_resources("separate_samplers", a.separate_samplers, b.separate_samplers, compiler, scanner)
+        && same_ranges(a.uniform_buffers, compiler, scanner)
+        && same_ranges(a.push_constant_buffers, compiler, scanner);
+}
+
+/* What slang_reflect() asks of a module: resources plus the
+ * active ranges of its uniform and push constant blocks. */
+template <typename C>
+static size_t reflect(const C& compiler)
+{
+    size_t count = 0;
+    ShaderResources res = compiler.get_shader_resources();
+
+    for (auto& block : res.uniform_buffers)
+        count += compiler.get_active_buffer_ranges(block.id).size();
+    for (auto& block : res.push_constant_buffers)
+        count += compiler.get_active_buffer_ranges(block.id).size();
+
+    return count + res.sampled_images.size();
+}
+
+int main(int argc, char* argv[])
+{
+    int i;
+    unsigned iterations = 100;
+    unsigned mismatches = 0;
+    double total_full = 0.0;
+    double total_scan = 0.0;
+    volatile size_t sink = 0;
+
+    if (argc > 2 && !strcmp(argv[1], "-n"))
+    {
+        iterations = unsigned(strtoul(argv[2], NULL, 0));
+        argv += 2;
+        argc -= 2;
+    }
+
+    if (argc < 2 || iterations == 0)
+    {
+        fprintf(stderr, "Usage: %s [-n iterations] shader.spv [shader.spv ...]\n",
+            argv[0]);
+        return 1;
+    }
+
+    printf("%-40s %8s %12s %12s %8s\n",
+        "module", "words", "full (us)", "scan (us)", "speedup");
+
+    for (i = 1; i < argc; i++)
+    {
+        unsigned j;
+        double full_us, scan_us;
+        std::vector<uint32_t> words;
+        std::chrono::steady_clock::time_point start;
+
+        if (!read_module(argv[i], words))
+        {
+            fprintf(stderr, "%s: not a SPIR-V module\n", argv[i]);
+            mismatches++;
+            continue;
+        }
+
+        try
+        {
+            if (!compare(words))
+            {
+                fprintf(stderr, "%s: scanner output differs\n", argv[i]);
+                mismatches++;
+                continue;
+            }
+
+            start = std::chrono::steady_clock::now();
+            for (j = 0; j < iterations; j++)
+            {
+                Compiler compiler(words);
+                sink = sink + reflect(compiler);
+            }
+            full_us = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count() / iterations;
+
+            start = std::chrono::steady_clock::now();
+            for (j = 0; j < iterations; j++)
+            {
+                slang_spirv_scanner scanner;
+                scanner.scan(words.data(), words.size());
+                sink = sink + reflect(scanner);
+            }
+            scan_us = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count() / iterations;
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], e.what());
+            mismatches++;
+            continue;
+        }
+
+        total_full += full_us;
+        total_scan += scan_us;
+        printf("%-40s %8u %12.2f %12.2f %7.2fx\n", path_basename(argv[i]),
+            unsigned(words.size()), full_us, scan_us, full_us / scan_us);
+    }
+
+    if (total_scan > 0.0)
+        printf("%-40s %8s %12.2f %12.2f %7.2fx\n", "total", "",
+            total_full, total_scan, total_full / total_scan);
+
+    if (mismatches)
+        printf("%u module(s) failed.\n", mismatches);
+
+    return mismatches ? 1 : 0;
+}